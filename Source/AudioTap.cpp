@@ -0,0 +1,47 @@
+#include "AudioTap.h"
+
+AudioTap::AudioTap()
+    : ring((size_t)capacity)
+{
+}
+
+void AudioTap::push(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+{
+    if (!enabled.load(std::memory_order_relaxed) || buffer.getNumChannels() == 0)
+        return;
+
+    const int numChannels = juce::jmin(2, buffer.getNumChannels());
+    const float gain = 1.0f / (float)numChannels;
+    const auto scope = fifo.write(numSamples);
+
+    auto fold = [&](int ringStart, int count, int offset)
+    {
+        if (count <= 0)
+            return;
+
+        float* dest = ring.data() + ringStart;
+        juce::FloatVectorOperations::copyWithMultiply(dest, buffer.getReadPointer(0, startSample + offset), gain, count);
+
+        if (numChannels > 1)
+            juce::FloatVectorOperations::addWithMultiply(dest, buffer.getReadPointer(1, startSample + offset), gain, count);
+    };
+
+    fold(scope.startIndex1, scope.blockSize1, 0);
+    fold(scope.startIndex2, scope.blockSize2, scope.blockSize1);
+}
+
+void AudioTap::read(float* dest, int numSamples) noexcept
+{
+    const auto scope = fifo.read(numSamples);
+
+    if (scope.blockSize1 > 0)
+        std::copy_n(ring.data() + scope.startIndex1, scope.blockSize1, dest);
+
+    if (scope.blockSize2 > 0)
+        std::copy_n(ring.data() + scope.startIndex2, scope.blockSize2, dest + scope.blockSize1);
+}
+
+void AudioTap::discard(int numSamples) noexcept
+{
+    fifo.finishedRead(juce::jmin(numSamples, fifo.getNumReady()));
+}
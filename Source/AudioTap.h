@@ -0,0 +1,36 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+// Copies audio out of a real-time callback for analysis on another thread.
+// push() is wait-free: while disabled it is a single atomic load, and when
+// enabled it folds the first two channels to mono straight into a
+// single-producer/single-consumer ring. A reader that falls behind loses
+// the newest audio rather than holding the callback up.
+class AudioTap
+{
+public:
+    static constexpr int capacity = 1 << 16;
+
+    AudioTap();
+
+    // Message thread. A tap starts disabled; enable it only while something
+    // reads it.
+    void setEnabled(bool shouldBeEnabled) { enabled.store(shouldBeEnabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // Audio thread.
+    void push(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept;
+
+    // Reader thread.
+    int getNumReady() const { return fifo.getNumReady(); }
+    void read(float* dest, int numSamples) noexcept;
+    void discard(int numSamples) noexcept;
+
+private:
+    juce::AbstractFifo fifo{ capacity };
+    std::vector<float> ring;
+    std::atomic<bool> enabled{ false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioTap)
+};
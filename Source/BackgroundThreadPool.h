@@ -0,0 +1,52 @@
+#pragma once
+#include <JuceHeader.h>
+#include "DeckRenderPool.h"
+
+// Worker pool shared by every deck for file loading and other jobs that must
+// stay off both the message thread and the audio thread.
+class BackgroundThreadPool : public juce::ThreadPool
+{
+public:
+    BackgroundThreadPool()
+        : juce::ThreadPool(juce::ThreadPoolOptions{}
+            .withThreadName("Background jobs")
+            .withNumberOfThreads(juce::jmax(2, juce::SystemStats::getNumCpus() - 1)))
+    {
+    }
+};
+
+// Whole-track analysis (onsets, tempo, loudness, the waveform overview) runs here
+// rather than on the BackgroundThreadPool, so a batch of it can never hold up
+// the next track loading. The threads run at low priority and leave a core
+// free for decoding the decks.
+class AnalysisThreadPool : public juce::ThreadPool
+{
+public:
+    AnalysisThreadPool()
+        : juce::ThreadPool(juce::ThreadPoolOptions{}
+            .withThreadName("Analysis jobs")
+            .withNumberOfThreads(juce::jmax(1, juce::SystemStats::getNumCpus() / 2))
+            .withDesiredThreadPriority(juce::Thread::Priority::low))
+    {
+    }
+};
+
+// Exports get a pool of their own: they are long and arrive in batches, and
+// queued behind them a load or an analysis pass would wait for every region
+// to finish. Most of them decode and re-encode, so the pool takes every core
+// that the audio callback and the deck render workers don't.
+class ExportThreadPool : public juce::ThreadPool
+{
+public:
+    ExportThreadPool()
+        : juce::ThreadPool(juce::ThreadPoolOptions{}
+            .withThreadName("Export jobs")
+            .withNumberOfThreads(getDefaultNumThreads()))
+    {
+    }
+
+    static int getDefaultNumThreads()
+    {
+        return juce::jmax(1, juce::SystemStats::getNumCpus() - 1 - DeckRenderPool::getDefaultNumWorkers());
+    }
+};
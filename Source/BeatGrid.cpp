@@ -0,0 +1,225 @@
+#include "BeatGrid.h"
+#include "SidecarCache.h"
+#include "SimdKernels.h"
+
+namespace
+{
+    // Bump when the estimator changes, so old results get re-analysed.
+    constexpr int cacheVersion = 1;
+
+    constexpr double minBpm = 60.0;
+    constexpr double maxBpm = 200.0;
+
+    // Octave errors are the usual failure, so the autocorrelation is weighted
+    // towards the range most music sits in before picking a peak.
+    constexpr double preferredBpm = 120.0;
+    constexpr double preferenceOctaves = 0.5;
+
+    // Subtracting the local average leaves the attacks and drops sustained
+    // energy, which would otherwise flatten the autocorrelation.
+    constexpr int averageRadius = 8;
+
+    // Sub-frame resolution of the phase search.
+    constexpr int phaseSteps = 4;
+
+    constexpr int minBeats = 16;
+
+    // Noise and free-time material score around 0.25.
+    constexpr float minConfidence = 0.4f;
+
+    // Sums the envelope folded at the given period into bins of phase, each
+    // 1 / phaseSteps of a frame wide, spreading every value over two bins.
+    void foldEnvelope(const std::vector<float>& envelope, double period, std::vector<float>& bins)
+    {
+        const int numBins = juce::jmax(1, (int)std::ceil(period * phaseSteps));
+        const double binsPerFrame = numBins / period;
+        bins.assign((size_t)numBins, 0.0f);
+
+        double phase = 0.0;
+
+        for (auto value : envelope)
+        {
+            const double position = phase * binsPerFrame;
+            const int bin = juce::jmin(numBins - 1, (int)position);
+            const float fraction = (float)(position - bin);
+
+            bins[(size_t)bin] += value * (1.0f - fraction);
+            bins[(size_t)((bin + 1) % numBins)] += value * fraction;
+
+            phase += 1.0;
+            if (phase >= period)
+                phase -= period;
+        }
+    }
+
+    // The strongest phase, with a little smoothing so onsets that wander by
+    // a frame either side still count together.
+    int findBestPhase(const std::vector<float>& bins, float& bestSum)
+    {
+        const int numBins = (int)bins.size();
+        int bestBin = 0;
+        bestSum = -1.0f;
+
+        for (int b = 0; b < numBins; ++b)
+        {
+            float sum = 0.0f;
+
+            for (int k = -phaseSteps / 2; k <= phaseSteps / 2; ++k)
+                sum += bins[(size_t)((b + k + numBins) % numBins)];
+
+            if (sum > bestSum)
+            {
+                bestSum = sum;
+                bestBin = b;
+            }
+        }
+
+        return bestBin;
+    }
+}
+
+int BeatGrid::getBeatIndexAtOrAfter(double time) const
+{
+    if (!isValid() || time <= firstBeat)
+        return 0;
+
+    return (int)std::ceil((time - firstBeat) / getBeatLength() - 1.0e-9);
+}
+
+BeatGrid BeatGrid::estimate(const float* input, int numFrames, double frameRate)
+{
+    BeatGrid grid;
+
+    const int minLag = juce::jmax(2, (int)std::floor(60.0 * frameRate / maxBpm));
+    const int maxLag = (int)std::ceil(60.0 * frameRate / minBpm);
+
+    if (frameRate <= 0.0 || numFrames < maxLag * minBeats)
+        return grid;
+
+    std::vector<float> envelope((size_t)numFrames);
+    double runningSum = 0.0;
+    int windowStart = 0, windowEnd = 0;
+
+    for (int n = 0; n < numFrames; ++n)
+    {
+        for (; windowEnd < juce::jmin(numFrames, n + averageRadius + 1); ++windowEnd)
+            runningSum += input[windowEnd];
+
+        for (; windowStart < n - averageRadius; ++windowStart)
+            runningSum -= input[windowStart];
+
+        const double average = runningSum / (windowEnd - windowStart);
+        envelope[(size_t)n] = juce::jmax(0.0f, input[n] - (float)average);
+    }
+
+    double envelopeMean = 0.0;
+    for (auto value : envelope)
+        envelopeMean += value;
+
+    envelopeMean /= numFrames;
+
+    if (envelopeMean <= 0.0)
+        return grid;
+
+    // Coarse period from the weighted autocorrelation.
+    std::vector<double> correlation((size_t)maxLag + 2, 0.0);
+    const float* data = envelope.data();
+
+    for (int lag = minLag - 1; lag <= maxLag + 1; ++lag)
+        correlation[(size_t)lag] = SimdKernels::dotProduct(data, data + lag, numFrames - lag) / (double)(numFrames - lag);
+
+    int bestLag = 0;
+    double bestWeighted = 0.0;
+
+    for (int lag = minLag; lag <= maxLag; ++lag)
+    {
+        const double octaves = std::log2(60.0 * frameRate / lag / preferredBpm) / preferenceOctaves;
+        const double weighted = correlation[(size_t)lag] * std::exp(-0.5 * octaves * octaves);
+
+        if (weighted > bestWeighted)
+        {
+            bestWeighted = weighted;
+            bestLag = lag;
+        }
+    }
+
+    if (bestLag == 0)
+        return grid;
+
+    double period = bestLag;
+    const double below = correlation[(size_t)bestLag - 1];
+    const double centre = correlation[(size_t)bestLag];
+    const double above = correlation[(size_t)bestLag + 1];
+    const double curvature = below - 2.0 * centre + above;
+
+    if (curvature < 0.0)
+        period += juce::jlimit(-0.5, 0.5, 0.5 * (below - above) / curvature);
+
+    // Refine period and phase together: across the whole track, a period off
+    // by a hundredth of a frame smears the fold and loses to the right one.
+    std::vector<float> bins;
+    double bestPeriod = period;
+    double bestScore = -1.0;
+    int bestBin = 0;
+
+    for (double candidate = period - 0.6; candidate <= period + 0.6; candidate += 0.01)
+    {
+        foldEnvelope(envelope, candidate, bins);
+
+        float sum = 0.0f;
+        const int bin = findBestPhase(bins, sum);
+        const double score = sum * candidate / numFrames;
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestPeriod = candidate;
+            bestBin = bin;
+        }
+    }
+
+    const double phaseFrames = bestBin * bestPeriod / std::ceil(bestPeriod * phaseSteps);
+
+    // bestScore is the envelope collected per beat; with no pulse at all it
+    // is about (phaseSteps + 1) / phaseSteps frames' worth of the mean.
+    const double ratio = bestScore / (envelopeMean * (phaseSteps + 1) / phaseSteps);
+    grid.confidence = (float)juce::jlimit(0.0, 1.0, (ratio - 1.0) / (ratio + 1.0));
+
+    if (grid.confidence < minConfidence)
+    {
+        grid.confidence = 0.0f;
+        return grid;
+    }
+
+    grid.bpm = 60.0 * frameRate / bestPeriod;
+    grid.firstBeat = phaseFrames / frameRate;
+    return grid;
+}
+
+bool BeatGrid::loadFromCache(const juce::File& file, BeatGrid& grid)
+{
+    juce::MemoryBlock data;
+    if (!SidecarCache::loadByFingerprint(file, "beatgrid", data))
+        return false;
+
+    juce::MemoryInputStream in(data, false);
+
+    if (in.readInt() != cacheVersion || in.getNumBytesRemaining() < 20)
+        return false;
+
+    grid.bpm = in.readDouble();
+    grid.firstBeat = in.readDouble();
+    grid.confidence = in.readFloat();
+    return true;
+}
+
+void BeatGrid::saveToCache(const juce::File& file, const BeatGrid& grid)
+{
+    juce::MemoryOutputStream out;
+    out.writeInt(cacheVersion);
+    out.writeDouble(grid.bpm);
+    out.writeDouble(grid.firstBeat);
+    out.writeFloat(grid.confidence);
+
+    SidecarCache::saveByFingerprint(file, "beatgrid", out.getMemoryBlock());
+}
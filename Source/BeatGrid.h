@@ -0,0 +1,34 @@
+#pragma once
+#include <JuceHeader.h>
+
+// A constant-tempo beat grid: where the beats fall. Estimated from an onset
+// strength envelope (see OnsetDetector), so it suits music with a steady
+// pulse; anything else comes out invalid.
+struct BeatGrid
+{
+    static constexpr int beatsPerBar = 4;
+
+    double bpm = 0.0;
+    double firstBeat = 0.0;     // seconds; the earliest beat at or after the start
+    float confidence = 0.0f;    // 0 to 1, how strongly the onsets follow the grid
+
+    bool isValid() const { return bpm > 0.0; }
+    double getBeatLength() const { return 60.0 / bpm; }
+    double getBeatTime(int beat) const { return firstBeat + beat * getBeatLength(); }
+
+    // Bars are counted from the first beat; onset strength alone can't tell
+    // a downbeat from a backbeat reliably enough to do better.
+    bool isBarStart(int beat) const { return beat % beatsPerBar == 0; }
+
+    // The first beat at or after time, never less than 0.
+    int getBeatIndexAtOrAfter(double time) const;
+
+    // Tempo between 60 and 200 BPM and the phase that best fit the envelope,
+    // which has frameRate values per second starting at time 0.
+    static BeatGrid estimate(const float* envelope, int numFrames, double frameRate);
+
+    // Results are kept by content fingerprint, so they follow a file that is
+    // moved or renamed. A track without a clear tempo is cached as invalid.
+    static bool loadFromCache(const juce::File& file, BeatGrid& grid);
+    static void saveToCache(const juce::File& file, const BeatGrid& grid);
+};
@@ -0,0 +1,394 @@
+#include "Benchmarks.h"
+
+#if AUDIO_BENCHMARKS
+
+#include "DeckManager.h"
+#include "MainComponent.h"
+#include "MappedPcmSource.h"
+#include "TimeStretchSource.h"
+
+namespace
+{
+    constexpr int blockSize = 512;
+
+    double ticksToMicroseconds(juce::int64 ticks)
+    {
+        return juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6;
+    }
+
+    double getMean(const std::vector<double>& values)
+    {
+        double total = 0.0;
+        for (auto value : values)
+            total += value;
+
+        return values.empty() ? 0.0 : total / (double)values.size();
+    }
+
+    // Median, 99th percentile and worst, in microseconds.
+    juce::String summarise(std::vector<double> micros)
+    {
+        if (micros.empty())
+            return "-";
+
+        std::sort(micros.begin(), micros.end());
+        const auto at = [&micros](double fraction) { return micros[(size_t)(fraction * (double)(micros.size() - 1))]; };
+
+        return juce::String(at(0.5), 1) + " / " + juce::String(at(0.99), 1) + " / " + juce::String(micros.back(), 1);
+    }
+
+    // Reads the whole file once, so both paths start with it in the OS cache
+    // and the comparison is of CPU and system calls rather than the disk.
+    void warmFileCache(const juce::File& file)
+    {
+        juce::FileInputStream in(file);
+        juce::HeapBlock<char> chunk(1 << 20);
+
+        while (in.openedOk() && in.read(chunk, 1 << 20) > 0)
+        {
+        }
+    }
+
+    juce::String timeSource(const juce::String& name, juce::PositionableAudioSource& source, double sampleRate)
+    {
+        constexpr int numBlocks = 2000;
+        constexpr int numSeeks = 500;
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        const juce::AudioSourceChannelInfo info(&buffer, 0, blockSize);
+        source.prepareToPlay(blockSize, sampleRate);
+
+        std::vector<double> blocks;
+        source.setNextReadPosition(0);
+
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+            source.getNextAudioBlock(info);
+            blocks.push_back(ticksToMicroseconds(juce::Time::getHighResolutionTicks() - start));
+        }
+
+        // A seek is only done once the block after it has been read.
+        std::vector<double> seeks;
+        juce::Random random(1);
+        const auto range = juce::jmax((juce::int64)1, source.getTotalLength() - blockSize);
+
+        for (int i = 0; i < numSeeks; ++i)
+        {
+            const auto position = (juce::int64)(random.nextDouble() * (double)range);
+            const auto start = juce::Time::getHighResolutionTicks();
+            source.setNextReadPosition(position);
+            source.getNextAudioBlock(info);
+            seeks.push_back(ticksToMicroseconds(juce::Time::getHighResolutionTicks() - start));
+        }
+
+        source.releaseResources();
+
+        const double blockMicros = 1.0e6 * blockSize / sampleRate;
+
+        return name.paddedRight(' ', 8)
+            + "block " + summarise(blocks) + " us (" + juce::String(100.0 * getMean(blocks) / blockMicros, 3) + "% of real time)"
+            + ", seek + block " + summarise(seeks) + " us\n";
+    }
+
+    // Plays the same file on 2, 4 and 8 decks, each from its own position so
+    // they don't share decoded blocks, and times DeckManager's mix with the
+    // render pool off and on. Blocks are paced in real time, so the read-ahead
+    // threads keep up as they would behind a device.
+    class MixBenchmark
+    {
+    public:
+        MixBenchmark(const juce::File& fileToPlay, std::function<void(const juce::String&)> callback)
+            : file(fileToPlay),
+            onFinished(std::move(callback))
+        {
+        }
+
+        void start()
+        {
+            manager.setNumDecks(deckCounts.back());
+            manager.prepareToPlay(blockSize, sampleRate);
+
+            for (int i = 0; i < manager.getNumDecks(); ++i)
+            {
+                manager.getDeck(i).loadFileAsync(file, [this](bool loaded)
+                    {
+                        failed = failed || !loaded;
+
+                        // Not from inside the deck's own callback, since this deletes the decks.
+                        if (++numLoaded == manager.getNumDecks())
+                            juce::MessageManager::callAsync([this] { finish(); });
+                    });
+            }
+        }
+
+    private:
+        static constexpr double sampleRate = 48000.0;
+        static constexpr int numWarmUpBlocks = 50;
+        static constexpr int numBlocks = 500;
+        const std::array<int, 3> deckCounts{ 2, 4, 8 };
+
+        const juce::File file;
+        std::function<void(const juce::String&)> onFinished;
+        DeckManager manager;
+        int numLoaded = 0;
+        bool failed = false;
+
+        void finish()
+        {
+            const auto report = failed ? "The mix benchmark couldn't load " + file.getFullPathName() : run();
+            auto callback = std::move(onFinished);
+            delete this;
+            callback(report);
+        }
+
+        juce::String run()
+        {
+            juce::String report = "Mix benchmark: " + file.getFileName() + ", " + juce::String(blockSize) + " samples at "
+                + juce::String((int)sampleRate) + " Hz, " + juce::String(DeckRenderPool::getDefaultNumWorkers())
+                + " render workers; median / 99th percentile / worst per block\n";
+
+            for (auto numDecks : deckCounts)
+            {
+                for (int i = 0; i < manager.getNumDecks(); ++i)
+                {
+                    auto& deck = manager.getDeck(i);
+                    deck.setPosition(juce::jmax(0.0, deck.getLengthInSeconds() * i / manager.getNumDecks()));
+
+                    if (i < numDecks)
+                        deck.play();
+                    else
+                        deck.stop();
+                }
+
+                for (const bool parallel : { false, true })
+                {
+                    manager.setParallelRendering(parallel);
+                    const auto times = renderBlocks();
+
+                    report += juce::String(numDecks).paddedLeft(' ', 2) + " decks, " + (parallel ? "parallel" : "serial  ")
+                        + ": " + summarise(times) + " us ("
+                        + juce::String(100.0 * getMean(times) / (1.0e6 * blockSize / sampleRate), 2) + "% of the block)\n";
+                }
+            }
+
+            manager.releaseResources();
+            return report;
+        }
+
+        std::vector<double> renderBlocks()
+        {
+            juce::AudioBuffer<float> output(2, blockSize);
+            const juce::AudioSourceChannelInfo info(&output, 0, blockSize);
+            const double blockMs = 1000.0 * blockSize / sampleRate;
+            auto nextBlockMs = juce::Time::getMillisecondCounterHiRes();
+            std::vector<double> times;
+
+            for (int i = 0; i < numWarmUpBlocks + numBlocks; ++i)
+            {
+                const auto start = juce::Time::getHighResolutionTicks();
+                manager.getNextAudioBlock(info);
+
+                if (i >= numWarmUpBlocks)
+                    times.push_back(ticksToMicroseconds(juce::Time::getHighResolutionTicks() - start));
+
+                nextBlockMs += blockMs;
+                juce::Time::waitForMillisecondCounter((juce::uint32)nextBlockMs);
+            }
+
+            return times;
+        }
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MixBenchmark)
+    };
+
+    // Seeded white noise, so every tier gets the same input and the frame
+    // search can't settle on an easy periodic match.
+    class NoiseSource : public juce::AudioSource
+    {
+    public:
+        void prepareToPlay(int, double) override { random.setSeed(1); }
+        void releaseResources() override {}
+
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override
+        {
+            for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+            {
+                auto* samples = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample);
+
+                for (int i = 0; i < bufferToFill.numSamples; ++i)
+                    samples[i] = random.nextFloat() - 0.5f;
+            }
+        }
+
+    private:
+        juce::Random random;
+    };
+
+    // Seconds of CPU per second of output for one deck, unpaced.
+    double timeStretch(bool enabled, TimeStretchSource::Quality quality, double ratio, double sampleRate)
+    {
+        constexpr double secondsToRender = 30.0;
+
+        NoiseSource noise;
+        TimeStretchSource stretch(&noise);
+        stretch.setEnabled(enabled);
+        stretch.setQuality(quality);
+        stretch.setSourceSampleRate(sampleRate);
+        stretch.setStretchRatio(ratio);
+        stretch.prepareToPlay(blockSize, sampleRate);
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        const juce::AudioSourceChannelInfo info(&buffer, 0, blockSize);
+        const int numBlocks = (int)(secondsToRender * sampleRate / blockSize);
+
+        const auto start = juce::Time::getHighResolutionTicks();
+
+        for (int i = 0; i < numBlocks; ++i)
+            stretch.getNextAudioBlock(info);
+
+        const double elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        stretch.releaseResources();
+
+        return elapsed / (numBlocks * blockSize / sampleRate);
+    }
+}
+
+bool Benchmarks::runFromCommandLine(const juce::String& commandLine, std::function<void(const juce::String&)> onFinished)
+{
+    juce::String kind;
+    juce::File file;
+
+    for (auto argument : juce::StringArray::fromTokens(commandLine, true))
+    {
+        argument = argument.unquoted();
+
+        if (argument.startsWith("--benchmark="))
+            kind = argument.fromFirstOccurrenceOf("=", false, false);
+        else if (!argument.startsWith("-"))
+            file = juce::File::getCurrentWorkingDirectory().getChildFile(argument);
+    }
+
+    if (kind.isEmpty())
+        return false;
+
+    if (kind == "seek")
+        onFinished(measureSeeks(file));
+    else if (kind == "mix")
+        measureMix(file, std::move(onFinished));
+    else if (kind == "stretch")
+        onFinished(measureStretch());
+    else if (kind == "paint")
+        onFinished(measurePaint());
+    else
+        onFinished("Unknown benchmark: " + kind);
+
+    return true;
+}
+
+juce::String Benchmarks::measureSeeks(const juce::File& file)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    juce::TimeSliceThread thread("Benchmark page toucher");
+    thread.startThread();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    auto mapped = MappedPcmSource::create(formatManager, file, thread);
+
+    if (reader == nullptr || mapped == nullptr)
+        return "The seek benchmark needs a WAV or AIFF file that can be mapped.";
+
+    const double sampleRate = reader->sampleRate;
+    juce::String report = "Seek benchmark: " + file.getFileName() + ", " + juce::String(blockSize)
+        + "-sample blocks, median / 99th percentile / worst\n";
+
+    warmFileCache(file);
+
+    juce::AudioFormatReaderSource streamed(reader.release(), true);
+    report += timeSource("Reader", streamed, sampleRate);
+    report += timeSource("Mapped", *mapped, sampleRate);
+
+    thread.stopThread(1000);
+    return report;
+}
+
+void Benchmarks::measureMix(const juce::File& file, std::function<void(const juce::String&)> onFinished)
+{
+    // Deletes itself once it has reported.
+    (new MixBenchmark(file, std::move(onFinished)))->start();
+}
+
+juce::String Benchmarks::measureStretch()
+{
+    constexpr double sampleRate = 48000.0;
+
+    struct Tier
+    {
+        const char* name;
+        bool enabled;
+        TimeStretchSource::Quality quality;
+    };
+
+    const Tier tiers[] = {
+        { "Off", false, TimeStretchSource::Quality::normal },
+        { "Fast", true, TimeStretchSource::Quality::fast },
+        { "Normal", true, TimeStretchSource::Quality::normal },
+        { "High", true, TimeStretchSource::Quality::high },
+    };
+
+    juce::String report = "Stretch benchmark: noise at " + juce::String((int)sampleRate) + " Hz, "
+        + juce::String(blockSize) + "-sample blocks; share of one core per deck, and decks per core\n";
+
+    for (const auto& tier : tiers)
+    {
+        report += juce::String(tier.name).paddedRight(' ', 8);
+
+        for (const double ratio : { 0.8, 1.25 })
+        {
+            const double load = timeStretch(tier.enabled, tier.quality, ratio, sampleRate);
+            report += "x" + juce::String(ratio, 2) + ": " + juce::String(100.0 * load, 2) + "% ("
+                + juce::String(load > 0.0 ? 1.0 / load : 0.0, 0) + " decks)   ";
+        }
+
+        report = report.trimEnd() + "\n";
+    }
+
+    return report;
+}
+
+juce::String Benchmarks::measurePaint()
+{
+    constexpr int numFrames = 300;
+    constexpr int width = 1000;
+    constexpr int height = 870;
+
+    MainComponent component;
+    component.setSize(width, height);
+    juce::Image frame(juce::Image::RGB, width, height, false);
+
+    juce::String report = "Paint benchmark: MainComponent::paint at " + juce::String(width) + "x" + juce::String(height)
+        + ", " + juce::String(numFrames) + " frames, median / 99th percentile / worst\n";
+
+    for (const bool cached : { false, true })
+    {
+        component.setBackgroundCached(cached);
+        std::vector<double> times;
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            juce::Graphics g(frame);
+            const auto start = juce::Time::getHighResolutionTicks();
+            component.paint(g);
+            times.push_back(ticksToMicroseconds(juce::Time::getHighResolutionTicks() - start));
+        }
+
+        report += juce::String(cached ? "Cached" : "Redrawn").paddedRight(' ', 8)
+            + summarise(times) + " us per frame, mean " + juce::String(getMean(times), 1) + " us\n";
+    }
+
+    return report;
+}
+
+#endif
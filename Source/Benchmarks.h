@@ -0,0 +1,41 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Timing runs for the playback paths, started from the command line instead
+// of opening the window:
+//
+//   --benchmark=seek <file.wav>   mapped vs reader seek latency and block cost
+//   --benchmark=mix <file>        mix cost at 2, 4 and 8 decks, serial and parallel
+//   --benchmark=stretch           time-stretch CPU per deck at each quality tier
+//   --benchmark=paint             main window paint time, background cached vs redrawn
+//
+// Each run reports a small table through onFinished, on the message thread.
+// Built into debug builds; define AUDIO_BENCHMARKS as 1 or 0 to override.
+#ifndef AUDIO_BENCHMARKS
+ #if JUCE_DEBUG
+  #define AUDIO_BENCHMARKS 1
+ #else
+  #define AUDIO_BENCHMARKS 0
+ #endif
+#endif
+
+#if AUDIO_BENCHMARKS
+
+namespace Benchmarks
+{
+    // False if the command line doesn't ask for a benchmark.
+    bool runFromCommandLine(const juce::String& commandLine, std::function<void(const juce::String&)> onFinished);
+
+    juce::String measureSeeks(const juce::File& file);
+
+    // Loads the file on every deck first, so it reports asynchronously.
+    void measureMix(const juce::File& file, std::function<void(const juce::String&)> onFinished);
+
+    juce::String measureStretch();
+
+    // Builds a MainComponent, so it opens the audio device and restores the
+    // saved decks like the app would.
+    juce::String measurePaint();
+}
+
+#endif
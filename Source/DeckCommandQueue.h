@@ -0,0 +1,65 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+
+struct DeckStream;
+struct LoopRegion;
+
+struct DeckCommand
+{
+    enum class Type
+    {
+        play,
+        stop,
+        seek,
+        setLooping,
+        setSegment,
+        swapStream,
+        queueStream,
+        setTimeStretch,
+        setResamplingQuality
+    };
+
+    Type type = Type::stop;
+    double first = 0.0;
+    double second = 0.0;
+    bool flag = false;
+    int serial = 0;
+    const LoopRegion* region = nullptr;
+    DeckStream* stream = nullptr;
+};
+
+// Single-producer/single-consumer queue: the message thread pushes, the audio
+// thread drains. Neither side locks or allocates.
+//
+// Only discrete commands go through here; continuous parameters such as gain
+// and speed are plain atomics read once per block, so dragging a slider can't
+// fill the queue. push() returns false when the queue is full and leaves it to
+// the caller to retry.
+class DeckCommandQueue
+{
+public:
+    bool push(const DeckCommand& command)
+    {
+        const auto scope = fifo.write(1);
+
+        if (scope.blockSize1 == 0)
+            return false;
+
+        commands[(size_t)scope.startIndex1] = command;
+        return true;
+    }
+
+    template <typename Callback>
+    void drain(Callback&& apply)
+    {
+        const auto scope = fifo.read(fifo.getNumReady());
+        scope.forEach([&](int index) { apply(commands[(size_t)index]); });
+    }
+
+private:
+    static constexpr int capacity = 256;
+
+    juce::AbstractFifo fifo{ capacity };
+    std::array<DeckCommand, capacity> commands;
+};
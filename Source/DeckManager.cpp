@@ -0,0 +1,259 @@
+#include "DeckManager.h"
+#include "SimdKernels.h"
+
+// Every slot gets a job index of its own.
+static_assert(DeckManager::maxDecks <= DeckRenderPool::maxJobs);
+
+DeckManager::DeckManager()
+{
+    if (const int numWorkers = DeckRenderPool::getDefaultNumWorkers(); numWorkers > 0)
+        renderPool = std::make_unique<DeckRenderPool>(numWorkers);
+
+    for (int i = 0; i < minDecks; ++i)
+        addDeck();
+}
+
+DeckManager::~DeckManager()
+{
+    stopTimer();
+    renderPool.reset();
+
+    for (auto& slot : slots)
+        slot.deck = nullptr;
+
+    retiredDecks.clear();
+    decks.clear();
+}
+
+PlayerAudio* DeckManager::addDeck()
+{
+    freeRetiredDecks();
+
+    if (decks.size() >= maxDecks)
+        return nullptr;
+
+    int slotIndex = -1;
+    for (int i = 0; i < maxDecks && slotIndex < 0; ++i)
+        if (slots[(size_t)i].deck.load() == nullptr)
+            slotIndex = i;
+
+    // Every free slot is still held by a deck that is fading out.
+    if (slotIndex < 0)
+        return nullptr;
+
+    auto* deck = new PlayerAudio();
+    auto& slot = slots[(size_t)slotIndex];
+
+    {
+        const juce::ScopedLock sl(prepareLock);
+
+        if (prepared)
+            deck->prepareToPlay(preparedBlockSize, preparedSampleRate);
+
+        slot.gain = 1.0f;
+        slot.lastGain = 0.0f;
+        slot.removing = false;
+        slot.deck.store(deck, std::memory_order_release);
+    }
+
+    decks.add(deck);
+    deckSlots.add(slotIndex);
+    return deck;
+}
+
+bool DeckManager::removeLastDeck()
+{
+    if (decks.size() <= minDecks)
+        return false;
+
+    auto* deck = decks.removeAndReturn(decks.size() - 1);
+    const int slotIndex = deckSlots.removeAndReturn(deckSlots.size() - 1);
+
+    deck->stop();
+    slots[(size_t)slotIndex].removing = true;
+
+    retiredDecks.add(deck);
+    retiredSlots.add(slotIndex);
+
+    freeRetiredDecks();
+
+    if (!retiredDecks.isEmpty())
+        startTimer(100);
+
+    return true;
+}
+
+void DeckManager::setNumDecks(int numDecks)
+{
+    numDecks = juce::jlimit(minDecks, maxDecks, numDecks);
+
+    while (decks.size() < numDecks && addDeck() != nullptr)
+    {
+    }
+
+    while (decks.size() > numDecks && removeLastDeck())
+    {
+    }
+}
+
+void DeckManager::setDeckGain(int index, float newGain)
+{
+    if (juce::isPositiveAndBelow(index, deckSlots.size()))
+        slots[(size_t)deckSlots.getUnchecked(index)].gain = juce::jmax(0.0f, newGain);
+}
+
+float DeckManager::getDeckGain(int index) const
+{
+    if (juce::isPositiveAndBelow(index, deckSlots.size()))
+        return slots[(size_t)deckSlots.getUnchecked(index)].gain.load();
+
+    return 0.0f;
+}
+
+DeckRenderPool::Stats DeckManager::getRenderStats() const
+{
+    return renderPool != nullptr ? renderPool->getStats() : DeckRenderPool::Stats{};
+}
+
+void DeckManager::freeRetiredDecks()
+{
+    for (int i = retiredDecks.size(); --i >= 0;)
+    {
+        auto& slot = slots[(size_t)retiredSlots.getUnchecked(i)];
+
+        {
+            const juce::ScopedLock sl(prepareLock);
+
+            // While audio runs, the mix clears the slot itself after the
+            // deck's last, faded-out block.
+            if (prepared && slot.deck.load() != nullptr)
+                continue;
+
+            slot.deck = nullptr;
+            slot.removing = false;
+        }
+
+        retiredDecks.getUnchecked(i)->releaseResources();
+        retiredDecks.remove(i);
+        retiredSlots.remove(i);
+    }
+}
+
+void DeckManager::timerCallback()
+{
+    freeRetiredDecks();
+
+    if (retiredDecks.isEmpty())
+        stopTimer();
+}
+
+void DeckManager::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    const juce::ScopedLock sl(prepareLock);
+
+    preparedBlockSize = juce::jmax(1, samplesPerBlockExpected);
+    preparedSampleRate = sampleRate;
+    deckBuffers.setSize(maxDecks * maxBusChannels, preparedBlockSize);
+
+    for (auto& slot : slots)
+    {
+        if (auto* deck = slot.deck.load())
+            deck->prepareToPlay(preparedBlockSize, sampleRate);
+
+        slot.lastGain = 0.0f;
+    }
+
+    masterMeter.prepare(sampleRate);
+    prepared = true;
+}
+
+void DeckManager::releaseResources()
+{
+    const juce::ScopedLock sl(prepareLock);
+    prepared = false;
+
+    for (auto& slot : slots)
+        if (auto* deck = slot.deck.load())
+            deck->releaseResources();
+}
+
+void DeckManager::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    bufferToFill.clearActiveBufferRegion();
+
+    if (preparedBlockSize <= 0)
+        return;
+
+    // Hosts may hand over more than they promised; render in prepared-size chunks.
+    for (int done = 0; done < bufferToFill.numSamples;)
+    {
+        const int numThisTime = juce::jmin(preparedBlockSize, bufferToFill.numSamples - done);
+        mixChunk(*bufferToFill.buffer, bufferToFill.startSample + done, numThisTime);
+        done += numThisTime;
+    }
+
+    masterMeter.process(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+}
+
+void DeckManager::mixChunk(juce::AudioBuffer<float>& output, int startSample, int numSamples)
+{
+    const int numChannels = juce::jmin(output.getNumChannels(), maxBusChannels);
+    int numActive = 0;
+
+    for (int i = 0; i < maxDecks; ++i)
+    {
+        auto* deck = slots[(size_t)i].deck.load(std::memory_order_acquire);
+        renderJobs[(size_t)i] = { deck, numChannels, numSamples };
+
+        if (deck != nullptr)
+            ++numActive;
+    }
+
+    // Each deck renders into its own channels and the sum below always runs
+    // in slot order, so the output is the same whichever thread rendered what.
+    if (renderPool != nullptr && parallelRendering.load() && numActive > 1)
+        renderPool->run(&DeckManager::renderDeck, this, maxDecks, 0.8 * numSamples / preparedSampleRate);
+    else
+        for (int i = 0; i < maxDecks; ++i)
+            renderDeck(this, i);
+
+    for (int i = 0; i < maxDecks; ++i)
+    {
+        auto& slot = slots[(size_t)i];
+
+        if (renderJobs[(size_t)i].deck == nullptr || slot.deck.load() == nullptr)
+            continue;
+
+        const bool removing = slot.removing.load();
+        const float targetGain = removing ? 0.0f : slot.gain.load();
+
+        if (slot.lastGain != 0.0f || targetGain != 0.0f)
+            for (int ch = 0; ch < numChannels; ++ch)
+                SimdKernels::addWithRamp(output.getWritePointer(ch, startSample),
+                    deckBuffers.getReadPointer(i * maxBusChannels + ch), slot.lastGain, targetGain, numSamples);
+
+        slot.lastGain = targetGain;
+
+        if (removing)
+        {
+            slot.lastGain = 0.0f;
+            slot.deck.store(nullptr, std::memory_order_release);
+        }
+    }
+}
+
+void DeckManager::renderDeck(void* context, int jobIndex)
+{
+    auto& self = *static_cast<DeckManager*>(context);
+    const auto& job = self.renderJobs[(size_t)jobIndex];
+
+    if (job.deck == nullptr)
+        return;
+
+    // A view onto the deck's preallocated channels, so it renders exactly the
+    // output's channel count without anything being resized.
+    juce::AudioBuffer<float> view(self.deckBuffers.getArrayOfWritePointers() + jobIndex * maxBusChannels,
+        job.numChannels, job.numSamples);
+
+    job.deck->getNextAudioBlock(juce::AudioSourceChannelInfo(&view, 0, job.numSamples));
+}
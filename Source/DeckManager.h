@@ -0,0 +1,95 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include "DeckRenderPool.h"
+#include "LevelMeter.h"
+#include "PlayerAudio.h"
+
+// Owns between minDecks and maxDecks players and mixes them onto the output.
+// Decks can be added and removed while audio runs: the audio thread only
+// reads a fixed table of slots, so the mix takes no lock and, once prepared,
+// allocates nothing.
+class DeckManager : public juce::AudioSource,
+    private juce::Timer
+{
+public:
+    static constexpr int minDecks = 2;
+    static constexpr int maxDecks = 16;
+
+    DeckManager();
+    ~DeckManager() override;
+
+    int getNumDecks() const { return decks.size(); }
+    PlayerAudio& getDeck(int index) { return *decks.getUnchecked(index); }
+
+    // Message thread only. addDeck returns nullptr once maxDecks are in use;
+    // removeLastDeck fades the deck out and frees it once the mix has let go.
+    PlayerAudio* addDeck();
+    bool removeLastDeck();
+    void setNumDecks(int numDecks);
+
+    // Fader gain applied on the bus, ramped over one block.
+    void setDeckGain(int index, float newGain);
+    float getDeckGain(int index) const;
+
+    // With two or more decks playing, spreads their rendering over a
+    // DeckRenderPool. Every deck still renders every block and the sum runs
+    // in slot order, so the mix is identical either way.
+    void setParallelRendering(bool shouldRenderInParallel) { parallelRendering = shouldRenderInParallel; }
+    bool isParallelRendering() const { return parallelRendering.load() && renderPool != nullptr; }
+    DeckRenderPool::Stats getRenderStats() const;
+
+    // The mixed output, after every deck's fader.
+    LevelMeter& getMasterMeter() { return masterMeter; }
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+private:
+    static constexpr int maxBusChannels = 8;
+
+    struct Slot
+    {
+        std::atomic<PlayerAudio*> deck{ nullptr };
+        std::atomic<float> gain{ 1.0f };
+        std::atomic<bool> removing{ false };
+
+        // Audio thread only.
+        float lastGain = 0.0f;
+    };
+
+    std::array<Slot, maxDecks> slots;
+    juce::OwnedArray<PlayerAudio> decks;
+    juce::Array<int> deckSlots;
+    juce::OwnedArray<PlayerAudio> retiredDecks;
+    juce::Array<int> retiredSlots;
+
+    juce::CriticalSection prepareLock;
+    bool prepared = false;
+    int preparedBlockSize = 0;
+    double preparedSampleRate = 0.0;
+
+    // maxBusChannels channels per slot.
+    juce::AudioBuffer<float> deckBuffers;
+
+    // One per slot; the render pool hands each worker a slot index.
+    struct RenderJob
+    {
+        PlayerAudio* deck = nullptr;
+        int numChannels = 0;
+        int numSamples = 0;
+    };
+
+    std::array<RenderJob, maxDecks> renderJobs;
+    std::unique_ptr<DeckRenderPool> renderPool;
+    std::atomic<bool> parallelRendering{ true };
+    LevelMeter masterMeter;
+
+    void mixChunk(juce::AudioBuffer<float>& output, int startSample, int numSamples);
+    static void renderDeck(void* context, int jobIndex);
+    void freeRetiredDecks();
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckManager)
+};
@@ -0,0 +1,177 @@
+#include "DeckRenderPool.h"
+#include "SimdKernels.h"
+
+namespace
+{
+    // Long enough to catch the next chunk of an oversized host block, far
+    // shorter than any device block.
+    constexpr double spinSeconds = 20.0e-6;
+
+    inline void cpuRelax() noexcept
+    {
+       #if AUDIO_SIMD_SSE
+        _mm_pause();
+       #elif AUDIO_SIMD_NEON && (defined(__aarch64__) || defined(_M_ARM64))
+        __asm__ __volatile__("yield");
+       #endif
+    }
+}
+
+class DeckRenderPool::Worker : public juce::Thread
+{
+public:
+    Worker(DeckRenderPool& ownerToUse, int index)
+        : juce::Thread("Deck render " + juce::String(index + 1)),
+        owner(ownerToUse),
+        workerIndex(index)
+    {
+    }
+
+    void run() override
+    {
+        const juce::ScopedNoDenormals noDenormals;
+        const auto spinTicks = juce::Time::secondsToHighResolutionTicks(spinSeconds);
+        auto lastWorkTicks = juce::Time::getHighResolutionTicks();
+        juce::uint32 seenGeneration = 0;
+
+        while (!threadShouldExit())
+        {
+            const auto batch = owner.batchState.load(std::memory_order_acquire);
+            const auto gen = (juce::uint32)(batch >> 32);
+
+            if (gen != seenGeneration)
+            {
+                // Lane 0 is the caller's.
+                seenGeneration = gen;
+                owner.runAvailableJobs(workerIndex + 1, gen, (int)(batch & 0xffff));
+                lastWorkTicks = juce::Time::getHighResolutionTicks();
+                continue;
+            }
+
+            if (juce::Time::getHighResolutionTicks() - lastWorkTicks < spinTicks)
+            {
+                cpuRelax();
+                continue;
+            }
+
+            // Announce the park before the final check, so a batch published
+            // in between either gets seen here or sends a wake-up.
+            parked.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if ((juce::uint32)(owner.batchState.load() >> 32) == seenGeneration)
+                wakeEvent.wait(100);
+
+            parked.store(false);
+            lastWorkTicks = juce::Time::getHighResolutionTicks();
+        }
+    }
+
+    void wake()
+    {
+        if (parked.load())
+            wakeEvent.signal();
+    }
+
+private:
+    DeckRenderPool& owner;
+    const int workerIndex;
+    std::atomic<bool> parked{ false };
+    juce::WaitableEvent wakeEvent;
+};
+
+DeckRenderPool::DeckRenderPool(int numWorkers)
+{
+    for (int i = 0; i < numWorkers; ++i)
+        workers.add(new Worker(*this, i));
+
+    for (auto* worker : workers)
+        worker->startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(9));
+}
+
+DeckRenderPool::~DeckRenderPool()
+{
+    for (auto* worker : workers)
+        worker->signalThreadShouldExit();
+
+    for (auto* worker : workers)
+    {
+        worker->wake();
+        worker->stopThread(1000);
+    }
+}
+
+int DeckRenderPool::getDefaultNumWorkers()
+{
+    return juce::jlimit(0, 4, juce::SystemStats::getNumCpus() - 2);
+}
+
+bool DeckRenderPool::tryRunJob(int jobIndex, juce::uint32 gen)
+{
+    auto& job = jobs[(size_t)jobIndex];
+    auto expected = makeState(gen, pending);
+
+    if (!job.state.compare_exchange_strong(expected, makeState(gen, running), std::memory_order_acq_rel))
+        return false;
+
+    job.function(job.context, jobIndex);
+    job.state.store(makeState(gen, done), std::memory_order_release);
+    return true;
+}
+
+void DeckRenderPool::runAvailableJobs(int lane, juce::uint32 gen, int numJobs)
+{
+    const int numLanes = workers.size() + 1;
+
+    for (int i = lane; i < numJobs; i += numLanes)
+        tryRunJob(i, gen);
+
+    // Own share done; help with whatever the others haven't started.
+    for (int i = 0; i < numJobs; ++i)
+        if (i % numLanes != lane)
+            tryRunJob(i, gen);
+}
+
+bool DeckRenderPool::hasFinished(int jobIndex, juce::uint32 gen) const
+{
+    return jobs[(size_t)jobIndex].state.load(std::memory_order_acquire) == makeState(gen, done);
+}
+
+void DeckRenderPool::run(JobFunction job, void* context, int numJobs, double budgetSeconds)
+{
+    jassert(numJobs >= 0 && numJobs <= maxJobs);
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    const auto gen = ++generation;
+
+    // Every job of the last batch finished before it returned, so nothing is
+    // reading these.
+    for (int i = 0; i < numJobs; ++i)
+    {
+        auto& state = jobs[(size_t)i];
+        state.function = job;
+        state.context = context;
+        state.state.store(makeState(gen, pending), std::memory_order_relaxed);
+    }
+
+    // Sequentially consistent, to pair with the fence a parking worker puts
+    // between announcing the park and its last look at the batch.
+    batchState.store(((juce::uint64)gen << 32) | (juce::uint64)numJobs);
+
+    // Workers still spinning from the last chunk need no signal.
+    for (auto* worker : workers)
+        worker->wake();
+
+    // The caller's pass claims everything still pending, so afterwards each
+    // job has either finished or is running on a worker.
+    runAvailableJobs(0, gen, numJobs);
+
+    for (int i = 0; i < numJobs; ++i)
+        while (!hasFinished(i, gen))
+            cpuRelax();
+
+    ++batches;
+
+    if (juce::Time::getHighResolutionTicks() - startTicks > juce::Time::secondsToHighResolutionTicks(budgetSeconds))
+        ++lateBatches;
+}
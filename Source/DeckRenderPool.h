@@ -0,0 +1,84 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+
+// A few real-time worker threads that help the audio callback render decks.
+// The caller publishes a batch of jobs and works on it too. Each thread owns
+// every Nth job and claims those first, then steals whatever the others
+// haven't started, so nothing locks or allocates and no single counter is
+// fought over.
+//
+// After a batch each worker spins for a few microseconds, in case another
+// follows straight away, then parks on its own event. Publishing a batch only
+// signals workers that have parked.
+class DeckRenderPool
+{
+public:
+    using JobFunction = void (*)(void* context, int jobIndex);
+
+    static constexpr int maxJobs = 64;
+
+    struct Stats
+    {
+        juce::int64 batches = 0;
+        juce::int64 lateBatches = 0;
+    };
+
+    explicit DeckRenderPool(int numWorkers);
+    ~DeckRenderPool();
+
+    int getNumWorkers() const { return workers.size(); }
+
+    // Runs job(context, i) exactly once for every i in [0, numJobs) and returns
+    // once they have all finished. Call from one thread at a time. The caller
+    // takes any job no worker has started yet, so a worker that is slow to
+    // wake costs at most the serial time. A batch that takes longer than
+    // budgetSeconds is counted as late; nothing is dropped.
+    void run(JobFunction job, void* context, int numJobs, double budgetSeconds);
+
+    Stats getStats() const { return { batches.load(), lateBatches.load() }; }
+
+    // Leaves a core for the audio thread and one for everything else; at most four.
+    static int getDefaultNumWorkers();
+
+private:
+    class Worker;
+
+    // Each job's state is its batch generation shifted left by two, plus a
+    // phase. Claiming is a CAS from pending to running for the claimer's
+    // generation, so a worker that wakes late can't take a job from a batch it
+    // never saw.
+    enum Phase : juce::uint64
+    {
+        done = 0,
+        pending = 1,
+        running = 2
+    };
+
+    struct alignas(64) JobState
+    {
+        std::atomic<juce::uint64> state{ 0 };
+
+        // Written by the caller between batches, when no job is running.
+        JobFunction function = nullptr;
+        void* context = nullptr;
+    };
+
+    std::array<JobState, maxJobs> jobs;
+
+    // Generation in the top 32 bits, batch size in the low 16.
+    std::atomic<juce::uint64> batchState{ 0 };
+    juce::uint32 generation = 0;
+
+    std::atomic<juce::int64> batches{ 0 };
+    std::atomic<juce::int64> lateBatches{ 0 };
+
+    juce::OwnedArray<Worker> workers;
+
+    static juce::uint64 makeState(juce::uint32 gen, Phase phase) { return ((juce::uint64)gen << 2) | phase; }
+    bool tryRunJob(int jobIndex, juce::uint32 gen);
+    void runAvailableJobs(int lane, juce::uint32 gen, int numJobs);
+    bool hasFinished(int jobIndex, juce::uint32 gen) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckRenderPool)
+};
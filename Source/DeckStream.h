@@ -0,0 +1,39 @@
+#pragma once
+#include <JuceHeader.h>
+#include "IndexedSeekReader.h"
+#include "LoudnessMeter.h"
+#include "MappedPcmSource.h"
+#include "ReadAheadSource.h"
+#include "SegmentLoopSource.h"
+
+// Everything that belongs to one opened file. A stream is built and pre-rolled
+// on a worker thread, then handed to the audio thread as a single pointer.
+struct DeckStream
+{
+    juce::File file;
+    double sampleRate = 0.0;
+    juce::int64 lengthInSamples = 0;
+    int serial = 0;
+
+    // Either a MappedPcmSource, played directly, or an AudioFormatReaderSource
+    // behind a ReadAheadSource.
+    std::unique_ptr<juce::PositionableAudioSource> fileSource;
+    std::unique_ptr<ReadAheadSource> readAheadSource;
+    std::unique_ptr<SegmentLoopSource> segmentLoopSource;
+
+    // Set for MP3/FLAC streams; owned further down the reader chain. Receives
+    // the seek index once it has been built.
+    IndexedSeekReader* seekReader = nullptr;
+
+    // Filled in on the message thread once the file has been measured; until
+    // then normalisationGain holds the provisional gain.
+    LoudnessMeter::Result loudness;
+    bool loudnessMeasured = false;
+    std::atomic<float> normalisationGain{ 1.0f };
+
+    // Audio thread only: the normalisation gain actually applied. It glides
+    // towards normalisationGain, and DeckTransport sets it outright when the
+    // stream starts, so a queued stream plays at its own level from its first
+    // sample.
+    float appliedNormalisation = 1.0f;
+};
@@ -0,0 +1,182 @@
+#include "DeckTransport.h"
+
+namespace
+{
+    // Normalisation changes glide at this much linear gain per second, so a
+    // measurement arriving mid-track fades in over a few hundred ms.
+    constexpr float normalisationSlewPerSecond = 1.0f;
+}
+
+void DeckTransport::setStream(DeckStream* newStream)
+{
+    stream = newStream;
+    nextStream = nullptr;
+
+    // A new file always starts from the top and silent; the next start()
+    // fades in from zero.
+    playing = false;
+    fadingOut = false;
+    lastGain = 0.0f;
+
+    if (stream != nullptr)
+    {
+        stream->appliedNormalisation = stream->normalisationGain.load(std::memory_order_relaxed);
+        stream->segmentLoopSource->setNextReadPosition(0);
+    }
+}
+
+void DeckTransport::setNextStream(DeckStream* newNextStream)
+{
+    nextStream = newNextStream;
+
+    if (nextStream != nullptr)
+        nextStream->segmentLoopSource->setNextReadPosition(0);
+}
+
+void DeckTransport::start()
+{
+    if (stream != nullptr && !playing.load())
+    {
+        playing = true;
+        fadingOut = false;
+    }
+}
+
+void DeckTransport::stop()
+{
+    if (playing.load())
+    {
+        playing = false;
+        fadingOut = true;
+    }
+}
+
+void DeckTransport::setLooping(bool shouldLoop)
+{
+    if (stream != nullptr)
+        stream->segmentLoopSource->setLooping(shouldLoop);
+
+    if (nextStream != nullptr)
+        nextStream->segmentLoopSource->setLooping(shouldLoop);
+}
+
+void DeckTransport::setNextReadPosition(juce::int64 newPosition)
+{
+    if (stream != nullptr)
+        stream->segmentLoopSource->setNextReadPosition(newPosition);
+}
+
+juce::int64 DeckTransport::getNextReadPosition() const
+{
+    return stream != nullptr ? stream->segmentLoopSource->getNextReadPosition() : 0;
+}
+
+juce::int64 DeckTransport::getTotalLength() const
+{
+    return stream != nullptr ? stream->segmentLoopSource->getTotalLength() : 0;
+}
+
+void DeckTransport::prepareToPlay(int samplesPerBlockExpected, double newSampleRate)
+{
+    blockSize = samplesPerBlockExpected;
+    sampleRate = newSampleRate;
+
+    if (stream != nullptr)
+        stream->segmentLoopSource->prepareToPlay(blockSize, sampleRate);
+
+    if (nextStream != nullptr)
+        nextStream->segmentLoopSource->prepareToPlay(blockSize, sampleRate);
+}
+
+void DeckTransport::releaseResources()
+{
+    if (stream != nullptr)
+        stream->segmentLoopSource->releaseResources();
+}
+
+void DeckTransport::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (stream == nullptr || (!playing.load() && !fadingOut) || bufferToFill.numSamples <= 0)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    auto* previous = stream;
+    const auto startPosition = stream->segmentLoopSource->getNextReadPosition();
+    stream->segmentLoopSource->getNextAudioBlock(bufferToFill);
+    const int samplesFromPrevious = spliceToNextStream(bufferToFill, startPosition);
+
+    auto& source = *stream->segmentLoopSource;
+
+    // Gain changes ramp across one block; stop() renders one more block
+    // fading to silence instead of cutting. Loudness normalisation rides
+    // along in the same ramp, split where a queued stream took over.
+    const float targetGain = fadingOut ? 0.0f : gain;
+    const float splitGain = lastGain + (targetGain - lastGain) * (float)samplesFromPrevious / (float)bufferToFill.numSamples;
+
+    applyStreamGain(*previous, bufferToFill, 0, samplesFromPrevious, lastGain, splitGain);
+
+    if (stream != previous)
+        applyStreamGain(*stream, bufferToFill, samplesFromPrevious, bufferToFill.numSamples - samplesFromPrevious,
+            splitGain, targetGain);
+
+    lastGain = targetGain;
+    fadingOut = false;
+
+    if (playing.load() && !source.isLooping()
+        && source.getNextReadPosition() >= source.getTotalLength())
+    {
+        playing = false;
+        lastGain = 0.0f;
+    }
+}
+
+int DeckTransport::spliceToNextStream(const juce::AudioSourceChannelInfo& bufferToFill, juce::int64 startPosition)
+{
+    auto& source = *stream->segmentLoopSource;
+
+    // A looping file or an A-B loop wraps before the end, so only a real run-out
+    // lands here.
+    if (nextStream == nullptr || source.isLooping() || source.getNextReadPosition() < source.getTotalLength())
+        return bufferToFill.numSamples;
+
+    const int samplesFromCurrent = (int)juce::jlimit((juce::int64)0, (juce::int64)bufferToFill.numSamples,
+        source.getTotalLength() - startPosition);
+
+    stream = nextStream;
+    nextStream = nullptr;
+    stream->appliedNormalisation = stream->normalisationGain.load(std::memory_order_relaxed);
+
+    if (onStreamSpliced != nullptr)
+        onStreamSpliced(samplesFromCurrent);
+
+    if (samplesFromCurrent < bufferToFill.numSamples)
+    {
+        juce::AudioSourceChannelInfo remainder(bufferToFill.buffer,
+            bufferToFill.startSample + samplesFromCurrent,
+            bufferToFill.numSamples - samplesFromCurrent);
+        stream->segmentLoopSource->getNextAudioBlock(remainder);
+    }
+
+    return samplesFromCurrent;
+}
+
+// Ramps from startGain to endGain over part of the block, times the stream's
+// normalisation as it glides towards its latest value.
+void DeckTransport::applyStreamGain(DeckStream& target, const juce::AudioSourceChannelInfo& bufferToFill,
+    int offset, int numSamples, float startGain, float endGain)
+{
+    if (numSamples <= 0)
+        return;
+
+    const float wanted = target.normalisationGain.load(std::memory_order_relaxed);
+    const float maxChange = sampleRate > 0.0 ? normalisationSlewPerSecond * (float)(numSamples / sampleRate)
+                                             : std::abs(wanted - target.appliedNormalisation);
+    const float normalisation = target.appliedNormalisation
+        + juce::jlimit(-maxChange, maxChange, wanted - target.appliedNormalisation);
+
+    bufferToFill.buffer->applyGainRamp(bufferToFill.startSample + offset, numSamples,
+        startGain * target.appliedNormalisation, endGain * normalisation);
+    target.appliedNormalisation = normalisation;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <JuceHeader.h>
+#include "DeckStream.h"
+
+// Play/stop, gain and stream switching for one deck. Everything except
+// isPlaying() is called on the audio thread only (via the deck's command
+// queue), so unlike AudioTransportSource nothing here locks or waits.
+class DeckTransport : public juce::AudioSource
+{
+public:
+    DeckTransport() = default;
+
+    DeckStream* getStream() const { return stream; }
+    void setStream(DeckStream* newStream);
+
+    // The queued stream takes over from the current one at the exact sample
+    // where the current one runs out, inside the same block if need be. Each
+    // part of that block gets its own stream's normalisation gain.
+    DeckStream* getNextStream() const { return nextStream; }
+    void setNextStream(DeckStream* newNextStream);
+
+    // Called on the audio thread when the queued stream takes over, with the
+    // offset of its first sample from the block's startSample.
+    std::function<void(int offsetInBlock)> onStreamSpliced;
+
+    void start();
+    void stop();
+    bool isPlaying() const { return playing.load(); }
+
+    void setGain(float newGain) { gain = newGain; }
+    void setLooping(bool shouldLoop);
+
+    void setNextReadPosition(juce::int64 newPosition);
+    juce::int64 getNextReadPosition() const;
+    juce::int64 getTotalLength() const;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+private:
+    DeckStream* stream = nullptr;
+    DeckStream* nextStream = nullptr;
+    std::atomic<bool> playing{ false };
+    bool fadingOut = false;
+    float gain = 1.0f;
+    float lastGain = 0.0f;
+
+    int blockSize = 0;
+    double sampleRate = 0.0;
+
+    int spliceToNextStream(const juce::AudioSourceChannelInfo& bufferToFill, juce::int64 startPosition);
+    void applyStreamGain(DeckStream& target, const juce::AudioSourceChannelInfo& bufferToFill,
+        int offset, int numSamples, float startGain, float endGain);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckTransport)
+};
@@ -0,0 +1,188 @@
+#include "DecodedBlockCache.h"
+
+void DecodedBlockCache::setMemoryBudget(size_t newBudgetBytes)
+{
+    const juce::ScopedLock sl(lock);
+    budgetBytes = newBudgetBytes;
+    evictToBudget();
+}
+
+size_t DecodedBlockCache::getMemoryBudget() const
+{
+    const juce::ScopedLock sl(lock);
+    return budgetBytes;
+}
+
+DecodedBlockCache::Block DecodedBlockCache::find(juce::int64 fileKey, juce::int64 blockIndex)
+{
+    const juce::ScopedLock sl(lock);
+    const auto it = lookup.find({ fileKey, blockIndex });
+
+    if (it == lookup.end())
+    {
+        ++misses;
+        return nullptr;
+    }
+
+    ++hits;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->block;
+}
+
+void DecodedBlockCache::insert(juce::int64 fileKey, juce::int64 blockIndex, Block block)
+{
+    if (block == nullptr)
+        return;
+
+    const Key key{ fileKey, blockIndex };
+    const auto bytes = (size_t)block->getNumChannels() * (size_t)block->getNumSamples() * sizeof(float);
+
+    const juce::ScopedLock sl(lock);
+
+    // Two readers may decode the same block at once; the first one in stays.
+    if (lookup.find(key) != lookup.end())
+        return;
+
+    entries.push_front({ key, std::move(block), bytes });
+    lookup[key] = entries.begin();
+    bytesResident += bytes;
+
+    evictToBudget();
+}
+
+void DecodedBlockCache::evictToBudget()
+{
+    // The newest block always stays, even if it alone is over budget.
+    while (bytesResident > budgetBytes && entries.size() > 1)
+    {
+        auto& oldest = entries.back();
+        bytesResident -= oldest.bytes;
+        lookup.erase(oldest.key);
+        entries.pop_back();
+        ++evictions;
+    }
+}
+
+void DecodedBlockCache::clear()
+{
+    const juce::ScopedLock sl(lock);
+    entries.clear();
+    lookup.clear();
+    bytesResident = 0;
+}
+
+DecodedBlockCache::Stats DecodedBlockCache::getStats() const
+{
+    const juce::ScopedLock sl(lock);
+
+    Stats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.evictions = evictions;
+    stats.bytesResident = bytesResident;
+    stats.budgetBytes = budgetBytes;
+    stats.numBlocks = (int)entries.size();
+    return stats;
+}
+
+void DecodedBlockCache::resetStats()
+{
+    const juce::ScopedLock sl(lock);
+    hits = misses = evictions = 0;
+}
+
+juce::int64 DecodedBlockCache::makeFileKey(const juce::File& file)
+{
+    return (file.getFullPathName() + "|" + juce::String(file.getSize())
+        + "|" + juce::String(file.getLastModificationTime().toMilliseconds())).hashCode64();
+}
+
+//==============================================================================
+CachingAudioReader::CachingAudioReader(juce::AudioFormatReader* sourceReader, juce::int64 fileKey)
+    : juce::AudioFormatReader(nullptr, sourceReader->getFormatName()),
+    source(sourceReader),
+    key(fileKey)
+{
+    sampleRate = source->sampleRate;
+    lengthInSamples = source->lengthInSamples;
+    numChannels = source->numChannels;
+    metadataValues = source->metadataValues;
+
+    // Blocks are stored decoded, so this reader always hands out floats.
+    bitsPerSample = 32;
+    usesFloatingPointData = true;
+}
+
+const juce::AudioBuffer<float>* CachingAudioReader::getBlock(juce::int64 blockIndex)
+{
+    if (blockIndex == currentBlockIndex)
+        return currentBlock.get();
+
+    auto block = cache->find(key, blockIndex);
+
+    if (block == nullptr)
+    {
+        const auto start = blockIndex * DecodedBlockCache::blockSize;
+        const int numSamples = (int)juce::jmin((juce::int64)DecodedBlockCache::blockSize, lengthInSamples - start);
+
+        if (numSamples <= 0)
+            return nullptr;
+
+        auto decoded = std::make_shared<juce::AudioBuffer<float>>((int)numChannels, numSamples);
+
+        if (!source->read(decoded.get(), 0, numSamples, start, true, true))
+            return nullptr;
+
+        block = decoded;
+        cache->insert(key, blockIndex, block);
+    }
+
+    currentBlock = std::move(block);
+    currentBlockIndex = blockIndex;
+    return currentBlock.get();
+}
+
+bool CachingAudioReader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+    juce::int64 startSampleInFile, int numSamples)
+{
+    bool succeeded = true;
+
+    while (numSamples > 0)
+    {
+        const auto blockIndex = startSampleInFile / DecodedBlockCache::blockSize;
+        const int offsetInBlock = (int)(startSampleInFile % DecodedBlockCache::blockSize);
+        const auto* block = startSampleInFile >= 0 ? getBlock(blockIndex) : nullptr;
+
+        // Before the start, past the end or on a failed decode, the rest reads as silence.
+        const int available = block != nullptr ? block->getNumSamples() - offsetInBlock : 0;
+        int numThisTime = numSamples;
+
+        if (available > 0)
+            numThisTime = juce::jmin(numSamples, available);
+        else if (startSampleInFile < 0)
+            numThisTime = (int)juce::jmin((juce::int64)numSamples, -startSampleInFile);
+        else if (startSampleInFile < lengthInSamples)
+            succeeded = false;
+
+        for (int ch = 0; ch < numDestChannels; ++ch)
+        {
+            if (auto* dest = destChannels[ch])
+            {
+                auto* destFloats = reinterpret_cast<float*>(dest + startOffsetInDestBuffer);
+
+                if (available > 0 && ch < block->getNumChannels())
+                    juce::FloatVectorOperations::copy(destFloats, block->getReadPointer(ch, offsetInBlock), numThisTime);
+                else
+                    juce::FloatVectorOperations::clear(destFloats, numThisTime);
+            }
+        }
+
+        startOffsetInDestBuffer += numThisTime;
+        startSampleInFile += numThisTime;
+        numSamples -= numThisTime;
+    }
+
+    // Silence past either end is a normal read; a block that failed to decode
+    // is reported, like the source reader would.
+    return succeeded;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <JuceHeader.h>
+#include <list>
+#include <unordered_map>
+
+// Process-wide store of decoded audio, in fixed-size blocks of float samples,
+// shared by every deck, the waveform thumbnails and slice creation. Blocks are
+// evicted least-recently-used once the memory budget is exceeded. Use it
+// through a juce::SharedResourcePointer.
+class DecodedBlockCache
+{
+public:
+    static constexpr int blockSize = 16384;
+
+    using Block = std::shared_ptr<const juce::AudioBuffer<float>>;
+
+    struct Stats
+    {
+        juce::int64 hits = 0;
+        juce::int64 misses = 0;
+        juce::int64 evictions = 0;
+        size_t bytesResident = 0;
+        size_t budgetBytes = 0;
+        int numBlocks = 0;
+
+        float getHitRate() const { return hits + misses > 0 ? (float)hits / (float)(hits + misses) : 0.0f; }
+    };
+
+    DecodedBlockCache() = default;
+
+    void setMemoryBudget(size_t newBudgetBytes);
+    size_t getMemoryBudget() const;
+
+    // Returns nullptr on a miss. Either way the lookup is counted in the stats.
+    Block find(juce::int64 fileKey, juce::int64 blockIndex);
+    void insert(juce::int64 fileKey, juce::int64 blockIndex, Block block);
+    void clear();
+
+    Stats getStats() const;
+    void resetStats();
+
+    // Identifies a file's contents by path, size and modification time.
+    static juce::int64 makeFileKey(const juce::File& file);
+
+private:
+    struct Key
+    {
+        juce::int64 file = 0;
+        juce::int64 block = 0;
+
+        bool operator==(const Key& other) const { return file == other.file && block == other.block; }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return std::hash<juce::uint64>()((juce::uint64)key.file ^ ((juce::uint64)key.block * 0x9e3779b97f4a7c15ull));
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        Block block;
+        size_t bytes = 0;
+    };
+
+    mutable juce::CriticalSection lock;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> lookup;
+    size_t budgetBytes = (size_t)256 * 1024 * 1024;
+    size_t bytesResident = 0;
+    juce::int64 hits = 0, misses = 0, evictions = 0;
+
+    void evictToBudget();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecodedBlockCache)
+};
+
+// Reads another reader through the DecodedBlockCache. Reads are block-aligned
+// underneath, so the wrapped reader sees long sequential runs.
+class CachingAudioReader : public juce::AudioFormatReader
+{
+public:
+    // Takes ownership of sourceReader.
+    CachingAudioReader(juce::AudioFormatReader* sourceReader, juce::int64 fileKey);
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+        juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+    std::unique_ptr<juce::AudioFormatReader> source;
+    juce::SharedResourcePointer<DecodedBlockCache> cache;
+    const juce::int64 key;
+
+    // The block being read from, kept so consecutive small reads skip the lookup.
+    DecodedBlockCache::Block currentBlock;
+    juce::int64 currentBlockIndex = -1;
+
+    const juce::AudioBuffer<float>* getBlock(juce::int64 blockIndex);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CachingAudioReader)
+};
@@ -0,0 +1,108 @@
+#include "DiskThumbnailCache.h"
+#include "SidecarCache.h"
+
+namespace
+{
+    // Bump if the stored format changes; older files then read as misses.
+    constexpr int fileVersion = 1;
+}
+
+DiskThumbnailCache::DiskThumbnailCache(int maxThumbsInMemory, juce::int64 diskBudgetBytes)
+    : juce::AudioThumbnailCache(maxThumbsInMemory),
+    directory(SidecarCache::getCacheDirectory().getChildFile("thumbnails")),
+    diskBudget(diskBudgetBytes)
+{
+}
+
+void DiskThumbnailCache::setDiskBudget(juce::int64 newBudgetBytes)
+{
+    diskBudget = juce::jmax((juce::int64)0, newBudgetBytes);
+
+    const juce::ScopedLock sl(fileLock);
+    trimToBudget();
+}
+
+juce::File DiskThumbnailCache::getFileFor(juce::int64 hashCode) const
+{
+    return directory.getChildFile(juce::String::toHexString(hashCode) + ".thumb");
+}
+
+void DiskThumbnailCache::saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+    const juce::ScopedLock sl(fileLock);
+
+    if (!directory.createDirectory())
+        return;
+
+    const auto target = getFileFor(hashCode);
+    juce::TemporaryFile temp(target);
+
+    {
+        juce::FileOutputStream stream(temp.getFile());
+        if (!stream.openedOk())
+            return;
+
+        stream.writeInt(fileVersion);
+        stream.writeInt64(hashCode);
+        thumb.saveTo(stream);
+        stream.flush();
+
+        if (stream.getStatus().failed())
+            return;
+    }
+
+    if (temp.overwriteTargetFileWithTemporary())
+        trimToBudget();
+}
+
+bool DiskThumbnailCache::loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+    const juce::ScopedLock sl(fileLock);
+
+    const auto file = getFileFor(hashCode);
+    juce::FileInputStream stream(file);
+
+    if (!stream.openedOk() || stream.readInt() != fileVersion || stream.readInt64() != hashCode)
+        return false;
+
+    if (!thumb.loadFrom(stream))
+        return false;
+
+    // The modification time doubles as the last-used time for trimming.
+    file.setLastModificationTime(juce::Time::getCurrentTime());
+    return true;
+}
+
+void DiskThumbnailCache::trimToBudget()
+{
+    struct Entry
+    {
+        juce::File file;
+        juce::int64 size;
+        juce::Time lastUsed;
+    };
+
+    std::vector<Entry> entries;
+    juce::int64 total = 0;
+
+    for (const auto& file : directory.findChildFiles(juce::File::findFiles, false, "*.thumb"))
+    {
+        entries.push_back({ file, file.getSize(), file.getLastModificationTime() });
+        total += entries.back().size;
+    }
+
+    const auto budget = diskBudget.load();
+    if (total <= budget)
+        return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+
+    for (const auto& entry : entries)
+    {
+        if (total <= budget)
+            break;
+
+        if (entry.file.deleteFile())
+            total -= entry.size;
+    }
+}
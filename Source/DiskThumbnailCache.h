@@ -0,0 +1,36 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Thumbnail cache that writes every finished thumbnail to disk as well as
+// keeping the last few in memory, so a track seen before shows its whole
+// waveform at once instead of being decoded again. Thumbnails are keyed by
+// the hash passed to AudioThumbnail::setReader (DecodedBlockCache::makeFileKey:
+// path, size and modification time). The folder is held to a size budget by
+// deleting the least recently used files.
+class DiskThumbnailCache : public juce::AudioThumbnailCache
+{
+public:
+    DiskThumbnailCache(int maxThumbsInMemory, juce::int64 diskBudgetBytes);
+
+    void setDiskBudget(juce::int64 newBudgetBytes);
+    juce::int64 getDiskBudget() const { return diskBudget.load(); }
+
+    juce::File getDirectory() const { return directory; }
+
+protected:
+    // Called on the cache's own thread when a thumbnail finishes.
+    void saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+
+    // Called on a miss in memory.
+    bool loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+
+private:
+    const juce::File directory;
+    std::atomic<juce::int64> diskBudget;
+    juce::CriticalSection fileLock;
+
+    juce::File getFileFor(juce::int64 hashCode) const;
+    void trimToBudget();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DiskThumbnailCache)
+};
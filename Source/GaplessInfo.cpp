@@ -0,0 +1,132 @@
+#include "GaplessInfo.h"
+
+namespace
+{
+    // Standard MP3 decoders lag the encoder by 528 samples plus one; the
+    // LAME figures are relative to the encoder, so both ends shift by this.
+    constexpr int decoderDelay = 529;
+
+    int readBigEndian32(const juce::uint8* data)
+    {
+        return (int)(((juce::uint32)data[0] << 24) | ((juce::uint32)data[1] << 16)
+            | ((juce::uint32)data[2] << 8) | (juce::uint32)data[3]);
+    }
+
+    juce::int64 skipId3v2Tag(const juce::uint8* data, size_t size)
+    {
+        if (size < 10 || data[0] != 'I' || data[1] != 'D' || data[2] != '3')
+            return 0;
+
+        const juce::int64 tagSize = ((juce::int64)(data[6] & 0x7f) << 21) | ((data[7] & 0x7f) << 14)
+            | ((data[8] & 0x7f) << 7) | (data[9] & 0x7f);
+        const bool hasFooter = (data[5] & 0x10) != 0;
+
+        return 10 + tagSize + (hasFooter ? 10 : 0);
+    }
+
+    GaplessInfo parseLameTag(const juce::uint8* frame, size_t size)
+    {
+        GaplessInfo info;
+
+        if (size < 4 || frame[0] != 0xff || (frame[1] & 0xe0) != 0xe0)
+            return info;
+
+        const int versionBits = (frame[1] >> 3) & 0x03;
+        const int layerBits = (frame[1] >> 1) & 0x03;
+        const bool isMpeg1 = versionBits == 3;
+        const bool isMono = ((frame[3] >> 6) & 0x03) == 3;
+
+        if (versionBits == 1 || layerBits != 1)
+            return info;
+
+        const size_t sideInfoSize = isMpeg1 ? (isMono ? 17 : 32) : (isMono ? 9 : 17);
+        size_t offset = 4 + sideInfoSize;
+
+        if (offset + 8 > size)
+            return info;
+
+        const auto* tag = frame + offset;
+        const bool isXing = std::memcmp(tag, "Xing", 4) == 0 || std::memcmp(tag, "Info", 4) == 0;
+
+        if (!isXing)
+            return info;
+
+        const int flags = readBigEndian32(tag + 4);
+        offset += 8;
+        if (flags & 0x01) offset += 4;
+        if (flags & 0x02) offset += 4;
+        if (flags & 0x04) offset += 100;
+        if (flags & 0x08) offset += 4;
+
+        if (offset + 24 > size)
+            return info;
+
+        const auto* lame = frame + offset;
+        const bool hasLameExtension = std::memcmp(lame, "LAME", 4) == 0
+            || std::memcmp(lame, "Lavf", 4) == 0 || std::memcmp(lame, "Lavc", 4) == 0;
+
+        if (!hasLameExtension)
+            return info;
+
+        const int encoderDelay = (lame[21] << 4) | (lame[22] >> 4);
+        const int encoderPadding = ((lame[22] & 0x0f) << 8) | lame[23];
+
+        info.leadingSamples = encoderDelay + decoderDelay;
+        info.trailingSamples = juce::jmax(0, encoderPadding - decoderDelay);
+        return info;
+    }
+}
+
+GaplessInfo GaplessInfo::readFromFile(const juce::File& file)
+{
+    if (!file.hasFileExtension("mp3"))
+        return {};
+
+    juce::FileInputStream stream(file);
+    if (!stream.openedOk())
+        return {};
+
+    juce::uint8 header[10] = {};
+    if (stream.read(header, sizeof(header)) != (int)sizeof(header))
+        return {};
+
+    // The Xing/LAME frame is the first audio frame, right after any ID3v2 tag.
+    // Allow a little slack for junk between the tag and the frame sync.
+    constexpr int searchSize = 4096;
+    juce::HeapBlock<juce::uint8> block(searchSize, true);
+
+    if (!stream.setPosition(skipId3v2Tag(header, sizeof(header))))
+        return {};
+
+    const int bytesRead = stream.read(block.getData(), searchSize);
+
+    for (int i = 0; i + 4 <= bytesRead; ++i)
+        if (block[i] == 0xff && (block[i + 1] & 0xe0) == 0xe0)
+            return parseLameTag(block.getData() + i, (size_t)(bytesRead - i));
+
+    return {};
+}
+
+juce::AudioFormatReader* GaplessInfo::createTrimmedReader(juce::AudioFormatManager& formatManager,
+    const juce::File& file)
+{
+    return trimReader(formatManager.createReaderFor(file), file);
+}
+
+juce::AudioFormatReader* GaplessInfo::trimReader(juce::AudioFormatReader* sourceReader, const juce::File& file)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(sourceReader);
+    if (reader == nullptr)
+        return nullptr;
+
+    const auto info = readFromFile(file);
+    const auto length = reader->lengthInSamples - info.leadingSamples - info.trailingSamples;
+
+    if (info.isEmpty() || length <= 0)
+        return reader.release();
+
+    auto metadataValues = reader->metadataValues;
+    auto* trimmed = new juce::AudioSubsectionReader(reader.release(), info.leadingSamples, length, true);
+    trimmed->metadataValues = metadataValues;
+    return trimmed;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Encoder delay and padding recorded in an MP3's LAME/Xing header. Decoders
+// output these as silence at either end of the track, which is what makes
+// playlists click or gap at the joins.
+struct GaplessInfo
+{
+    juce::int64 leadingSamples = 0;
+    juce::int64 trailingSamples = 0;
+
+    bool isEmpty() const { return leadingSamples == 0 && trailingSamples == 0; }
+
+    static GaplessInfo readFromFile(const juce::File& file);
+
+    // Opens the file and, when it carries gapless info, wraps the reader so
+    // that sample 0 is the first real sample and the length excludes padding.
+    static juce::AudioFormatReader* createTrimmedReader(juce::AudioFormatManager& formatManager,
+        const juce::File& file);
+
+    // Same, for a reader that is already open; takes ownership of it.
+    static juce::AudioFormatReader* trimReader(juce::AudioFormatReader* reader, const juce::File& file);
+};
@@ -0,0 +1,192 @@
+#include "IndexedSeekReader.h"
+
+namespace
+{
+    constexpr int scratchSamples = 4096;
+
+    // Short jumps forward are cheaper to decode through than to restart for.
+    constexpr double maxSkipSeconds = 2.0;
+
+    // Replays a FLAC stream header in front of a stream that starts mid-file,
+    // so the decoder sees a valid "fLaC" + STREAMINFO before the first frame.
+    class PrefixedInputStream : public juce::InputStream
+    {
+    public:
+        PrefixedInputStream(const juce::MemoryBlock& prefixToUse, std::unique_ptr<juce::InputStream> sourceToUse)
+            : prefix(prefixToUse), source(std::move(sourceToUse))
+        {
+        }
+
+        juce::int64 getTotalLength() override
+        {
+            const auto sourceLength = source->getTotalLength();
+            return sourceLength < 0 ? -1 : (juce::int64)prefix.getSize() + sourceLength;
+        }
+
+        bool isExhausted() override
+        {
+            return position >= (juce::int64)prefix.getSize() && source->isExhausted();
+        }
+
+        int read(void* destBuffer, int maxBytesToRead) override
+        {
+            auto* dest = static_cast<char*>(destBuffer);
+            const auto prefixSize = (juce::int64)prefix.getSize();
+            int numRead = 0;
+
+            if (position < prefixSize)
+            {
+                numRead = (int)juce::jmin((juce::int64)maxBytesToRead, prefixSize - position);
+                std::memcpy(dest, static_cast<const char*>(prefix.getData()) + position, (size_t)numRead);
+                position += numRead;
+            }
+
+            if (numRead < maxBytesToRead)
+            {
+                const int fromSource = source->read(dest + numRead, maxBytesToRead - numRead);
+                if (fromSource > 0)
+                {
+                    numRead += fromSource;
+                    position += fromSource;
+                }
+            }
+
+            return numRead;
+        }
+
+        juce::int64 getPosition() override { return position; }
+
+        bool setPosition(juce::int64 newPosition) override
+        {
+            const auto prefixSize = (juce::int64)prefix.getSize();
+            newPosition = juce::jmax((juce::int64)0, newPosition);
+
+            if (!source->setPosition(juce::jmax((juce::int64)0, newPosition - prefixSize)))
+                return false;
+
+            position = newPosition;
+            return true;
+        }
+
+    private:
+        const juce::MemoryBlock prefix;
+        std::unique_ptr<juce::InputStream> source;
+        juce::int64 position = 0;
+    };
+}
+
+IndexedSeekReader::IndexedSeekReader(juce::AudioFormatReader* sourceReader, juce::AudioFormat& formatToUse,
+    const juce::File& fileToUse)
+    : juce::AudioFormatReader(nullptr, sourceReader->getFormatName()),
+    source(sourceReader),
+    format(formatToUse),
+    file(fileToUse)
+{
+    sampleRate = source->sampleRate;
+    bitsPerSample = source->bitsPerSample;
+    lengthInSamples = source->lengthInSamples;
+    numChannels = source->numChannels;
+    usesFloatingPointData = source->usesFloatingPointData;
+    metadataValues = source->metadataValues;
+
+    const int channels = juce::jmax(1, (int)numChannels);
+    scratch.allocate((size_t)(channels * scratchSamples), false);
+    scratchChannels.allocate((size_t)channels, false);
+
+    for (int ch = 0; ch < channels; ++ch)
+        scratchChannels[ch] = scratch + ch * scratchSamples;
+}
+
+IndexedSeekReader::~IndexedSeekReader() = default;
+
+void IndexedSeekReader::setIndex(std::shared_ptr<const SeekIndex> newIndex)
+{
+    if (newIndex == nullptr || newIndex->entries.isEmpty())
+        return;
+
+    const juce::SpinLock::ScopedLockType sl(indexLock);
+
+    if (ownedIndex == nullptr)
+    {
+        ownedIndex = std::move(newIndex);
+        seekIndex = ownedIndex.get();
+    }
+}
+
+bool IndexedSeekReader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+    juce::int64 startSampleInFile, int numSamples)
+{
+    const auto maxSkip = (juce::int64)(maxSkipSeconds * sampleRate);
+    const auto* index = indexFailed ? nullptr : seekIndex.load();
+
+    const bool continuesActive = active != nullptr && startSampleInFile >= activeNext
+        && startSampleInFile - activeNext <= maxSkip;
+    const bool continuesSource = active == nullptr && startSampleInFile >= sourceNext
+        && startSampleInFile - sourceNext <= maxSkip;
+
+    if (index != nullptr && !continuesActive && !continuesSource && !restartAt(*index, startSampleInFile))
+    {
+        // A stale or unusable index; the wrapped reader still seeks correctly, just slowly.
+        indexFailed = true;
+        active.reset();
+    }
+
+    if (active != nullptr && skipActiveTo(startSampleInFile))
+    {
+        const bool ok = active->readSamples(destChannels, numDestChannels, startOffsetInDestBuffer,
+            startSampleInFile - activeStart, numSamples);
+        activeNext = startSampleInFile + numSamples;
+        return ok;
+    }
+
+    active.reset();
+    sourceNext = startSampleInFile + numSamples;
+    return source->readSamples(destChannels, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numSamples);
+}
+
+bool IndexedSeekReader::restartAt(const SeekIndex& index, juce::int64 targetSample)
+{
+    active.reset();
+
+    const auto* entry = index.findEntryBefore(juce::jmax((juce::int64)0, targetSample - index.preRollSamples));
+    if (entry == nullptr)
+        entry = &index.entries.getReference(0);
+
+    std::unique_ptr<juce::InputStream> stream(file.createInputStream());
+    if (stream == nullptr)
+        return false;
+
+    stream = std::make_unique<juce::SubregionStream>(stream.release(), entry->byteOffset, -1, true);
+
+    if (!index.streamHeader.isEmpty())
+        stream = std::make_unique<PrefixedInputStream>(index.streamHeader, std::move(stream));
+
+    active.reset(format.createReaderFor(stream.release(), true));
+
+    if (active == nullptr || active->numChannels != numChannels || active->sampleRate != sampleRate)
+    {
+        active.reset();
+        return false;
+    }
+
+    activeStart = entry->sample;
+    activeNext = entry->sample;
+    return true;
+}
+
+bool IndexedSeekReader::skipActiveTo(juce::int64 targetSample)
+{
+    // Decoders restarted mid-file are only positioned by what they have
+    // produced, so the lead-in is decoded and thrown away in order.
+    while (activeNext < targetSample)
+    {
+        const int numThisTime = (int)juce::jmin((juce::int64)scratchSamples, targetSample - activeNext);
+
+        if (!active->readSamples(scratchChannels, (int)numChannels, 0, activeNext - activeStart, numThisTime))
+            return false;
+
+        activeNext += numThisTime;
+    }
+
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <JuceHeader.h>
+#include "SeekIndex.h"
+
+// Wraps an MP3 or FLAC reader so that jumps restart decoding at the nearest
+// indexed frame rather than letting the decoder walk the file from wherever it
+// last was. Sequential reads, and reads before an index exists, go straight to
+// the wrapped reader.
+class IndexedSeekReader : public juce::AudioFormatReader
+{
+public:
+    IndexedSeekReader(juce::AudioFormatReader* sourceReader, juce::AudioFormat& formatToUse, const juce::File& file);
+    ~IndexedSeekReader() override;
+
+    // May be called from any thread while the reader is in use; the first
+    // non-null index wins.
+    void setIndex(std::shared_ptr<const SeekIndex> newIndex);
+    bool hasIndex() const { return seekIndex.load() != nullptr; }
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+        juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+    std::unique_ptr<juce::AudioFormatReader> source;
+    juce::AudioFormat& format;
+    const juce::File file;
+
+    std::shared_ptr<const SeekIndex> ownedIndex;
+    std::atomic<const SeekIndex*> seekIndex{ nullptr };
+    juce::SpinLock indexLock;
+
+    // Reading-thread state. `active` decodes from an indexed frame; its sample
+    // 0 is `activeStart` in file terms.
+    std::unique_ptr<juce::AudioFormatReader> active;
+    juce::int64 activeStart = 0;
+    juce::int64 activeNext = 0;
+    juce::int64 sourceNext = 0;
+    bool indexFailed = false;
+    juce::HeapBlock<int> scratch;
+    juce::HeapBlock<int*> scratchChannels;
+
+    bool restartAt(const SeekIndex& index, juce::int64 targetSample);
+    bool skipActiveTo(juce::int64 targetSample);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(IndexedSeekReader)
+};
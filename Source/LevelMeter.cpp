@@ -0,0 +1,69 @@
+#include "LevelMeter.h"
+#include "SimdKernels.h"
+
+void LevelMeter::prepare(double sampleRate)
+{
+    windowLength = juce::jmax(1, juce::roundToInt(sampleRate * windowSeconds));
+    numAccumulated = 0;
+    windowPeak.fill(0.0f);
+    windowSquares.fill(0.0);
+}
+
+void LevelMeter::process(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+{
+    const int numChannels = juce::jmin(buffer.getNumChannels(), maxChannels);
+    if (numChannels == 0)
+        return;
+
+    bool anyClipped = false;
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int numThisTime = juce::jmin(numSamples - done, windowLength - numAccumulated);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            float low, high;
+            const float squares = SimdKernels::minMaxSumSquares(buffer.getReadPointer(channel, startSample + done),
+                numThisTime, low, high);
+            const float peak = juce::jmax(-low, high);
+
+            windowPeak[(size_t)channel] = juce::jmax(windowPeak[(size_t)channel], peak);
+            windowSquares[(size_t)channel] += squares;
+            anyClipped = anyClipped || peak >= 1.0f;
+        }
+
+        numAccumulated += numThisTime;
+        done += numThisTime;
+
+        if (numAccumulated == windowLength)
+        {
+            auto& reading = readings.getWriteBuffer();
+            reading.numChannels = numChannels;
+
+            for (int channel = 0; channel < maxChannels; ++channel)
+            {
+                reading.peak[(size_t)channel] = windowPeak[(size_t)channel];
+                reading.rms[(size_t)channel] = (float)std::sqrt(windowSquares[(size_t)channel] / windowLength);
+            }
+
+            readings.publish();
+
+            numAccumulated = 0;
+            windowPeak.fill(0.0f);
+            windowSquares.fill(0.0);
+        }
+    }
+
+    if (anyClipped)
+        clipped.store(true, std::memory_order_relaxed);
+}
+
+bool LevelMeter::read(Reading& reading) noexcept
+{
+    if (!readings.update())
+        return false;
+
+    reading = readings.getReadBuffer();
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <JuceHeader.h>
+#include "TripleBuffer.h"
+
+// Peak, RMS and clip measurement of a stream of audio, taken on the audio
+// thread and read on the message thread. process() measures each window of
+// windowSeconds and publishes it through a TripleBuffer, so neither side
+// waits on the other; the window is short enough that a display refreshing
+// at 60 Hz sees every one. Clips are latched separately, so one can't be
+// lost between reads.
+class LevelMeter
+{
+public:
+    static constexpr int maxChannels = 2;
+    static constexpr double windowSeconds = 0.02;
+
+    struct Reading
+    {
+        int numChannels = 0;
+
+        // Linear gain; the peak is the largest absolute sample of the window.
+        std::array<float, maxChannels> peak{};
+        std::array<float, maxChannels> rms{};
+    };
+
+    // Before the first process() call, from whichever thread prepares audio.
+    void prepare(double sampleRate);
+
+    // Audio thread. Channels past maxChannels are ignored.
+    void process(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept;
+
+    // Message thread. Returns false if no window has finished since last time.
+    bool read(Reading& reading) noexcept;
+
+    // Message thread. True if anything reached full scale since last asked.
+    bool takeClip() noexcept { return clipped.exchange(false, std::memory_order_relaxed); }
+
+private:
+    // Audio thread only.
+    int windowLength = 1024;
+    int numAccumulated = 0;
+    std::array<float, maxChannels> windowPeak{};
+    std::array<double, maxChannels> windowSquares{};
+
+    TripleBuffer<Reading> readings;
+    std::atomic<bool> clipped{ false };
+};
@@ -0,0 +1,131 @@
+#include "LevelMeterComponent.h"
+
+LevelMeterComponent::LevelMeterComponent(const juce::String& labelText)
+    : label(labelText)
+{
+}
+
+bool LevelMeterComponent::update(LevelMeter& meter)
+{
+    const double now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+    const float fall = (float)(juce::jlimit(0.0, 1.0, now - lastUpdate) * decayDbPerSecond);
+    lastUpdate = now;
+
+    LevelMeter::Reading reading;
+    const bool fresh = meter.read(reading);
+
+    if (meter.takeClip())
+        clipUntil = now + clipHoldSeconds;
+
+    if (fresh && reading.numChannels > 0)
+        numChannels = reading.numChannels;
+
+    bool changed = false;
+    bool moving = clipUntil > now;
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        auto& channel = channels[(size_t)i];
+        const Channel before = channel;
+
+        float peakDb = minDb, rmsDb = minDb;
+
+        if (fresh)
+        {
+            peakDb = juce::jlimit(minDb, maxDb, juce::Decibels::gainToDecibels(reading.peak[(size_t)i], minDb));
+            rmsDb = juce::jlimit(minDb, maxDb, juce::Decibels::gainToDecibels(reading.rms[(size_t)i], minDb));
+        }
+
+        channel.peakDb = juce::jmax(peakDb, channel.peakDb - fall);
+        channel.rmsDb = juce::jmax(rmsDb, channel.rmsDb - fall);
+
+        if (channel.peakDb >= channel.holdDb)
+        {
+            channel.holdDb = channel.peakDb;
+            channel.holdUntil = now + holdSeconds;
+        }
+        else if (now > channel.holdUntil)
+        {
+            channel.holdDb = juce::jmax(channel.peakDb, channel.holdDb - fall);
+        }
+
+        // A tenth of a dB is well under a pixel at any sensible size.
+        changed = changed || std::abs(channel.peakDb - before.peakDb) > 0.1f
+            || std::abs(channel.rmsDb - before.rmsDb) > 0.1f
+            || std::abs(channel.holdDb - before.holdDb) > 0.1f;
+
+        moving = moving || channel.holdDb > minDb;
+    }
+
+    const bool clipLit = clipUntil > now;
+    if (changed || clipLit != clipShown)
+        repaint();
+
+    clipShown = clipLit;
+
+    return moving;
+}
+
+float LevelMeterComponent::dbToY(float db, juce::Rectangle<float> area) const
+{
+    return juce::jmap(db, minDb, maxDb, area.getBottom(), area.getY());
+}
+
+void LevelMeterComponent::paint(juce::Graphics& g)
+{
+    auto area = getLocalBounds().toFloat();
+
+    g.setColour(juce::Colours::white.withAlpha(0.6f));
+    g.setFont(11.0f);
+    g.drawText(label, area.removeFromBottom(14.0f), juce::Justification::centred);
+
+    auto clipArea = area.removeFromTop(6.0f);
+    g.setColour(clipShown ? juce::Colours::red : juce::Colours::red.withAlpha(0.15f));
+    g.fillRoundedRectangle(clipArea.reduced(1.0f, 0.0f), 2.0f);
+    area.removeFromTop(2.0f);
+
+    g.setColour(juce::Colours::black.withAlpha(0.5f));
+    g.fillRoundedRectangle(area, 2.0f);
+
+    // Green below -18 dB, the usual headroom target, yellow up to -6 and red
+    // above.
+    juce::ColourGradient gradient(juce::Colours::red, 0.0f, dbToY(0.0f, area),
+        juce::Colours::limegreen, 0.0f, dbToY(minDb, area), false);
+    gradient.addColour(juce::jmap(-6.0, (double)maxDb, (double)minDb, 0.0, 1.0), juce::Colours::yellow);
+    gradient.addColour(juce::jmap(-18.0, (double)maxDb, (double)minDb, 0.0, 1.0), juce::Colours::limegreen);
+
+    const float barWidth = area.getWidth() / (float)numChannels;
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        const auto& channel = channels[(size_t)i];
+        auto bar = area.withX(area.getX() + i * barWidth).withWidth(barWidth).reduced(1.0f, 0.0f);
+
+        g.setGradientFill(gradient);
+        g.setOpacity(0.35f);
+        g.fillRect(bar.withTop(dbToY(channel.peakDb, bar)));
+
+        g.setOpacity(1.0f);
+        g.fillRect(bar.withTop(dbToY(channel.rmsDb, bar)));
+
+        if (channel.holdDb > minDb)
+        {
+            g.setColour(juce::Colours::white);
+            g.fillRect(bar.withTop(dbToY(channel.holdDb, bar)).withHeight(1.5f));
+        }
+    }
+
+    // Full scale, and the -18 dB alignment level.
+    for (auto db : { 0.0f, -18.0f })
+    {
+        g.setColour(juce::Colours::white.withAlpha(db == 0.0f ? 0.5f : 0.25f));
+        g.drawHorizontalLine(juce::roundToInt(dbToY(db, area)), area.getX(), area.getRight());
+    }
+}
+
+void LevelMeterComponent::mouseDown(const juce::MouseEvent&)
+{
+    clipUntil = 0.0;
+    clipShown = false;
+    repaint();
+}
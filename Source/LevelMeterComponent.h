@@ -0,0 +1,48 @@
+#pragma once
+#include <JuceHeader.h>
+#include "LevelMeter.h"
+
+// Draws one LevelMeter as a pair of vertical bars: RMS solid, peak fainter
+// behind it, with a peak-hold line and a clip light on top. Peaks rise at
+// once and fall at decayDbPerSecond; the hold line stays put for
+// holdSeconds first. A clip stays lit for clipHoldSeconds, or until the
+// meter is clicked.
+class LevelMeterComponent : public juce::Component
+{
+public:
+    static constexpr float minDb = -60.0f;
+    static constexpr float maxDb = 6.0f;
+    static constexpr float decayDbPerSecond = 24.0f;
+    static constexpr double holdSeconds = 1.5;
+    static constexpr double clipHoldSeconds = 3.0;
+
+    explicit LevelMeterComponent(const juce::String& labelText);
+
+    // Message thread: takes the meter's latest reading and moves the
+    // ballistics on, repainting if anything visible changed. Returns false
+    // once everything has fallen back to silence.
+    bool update(LevelMeter& meter);
+
+    void paint(juce::Graphics& g) override;
+    void mouseDown(const juce::MouseEvent& event) override;
+
+private:
+    struct Channel
+    {
+        float peakDb = minDb;
+        float rmsDb = minDb;
+        float holdDb = minDb;
+        double holdUntil = 0.0;
+    };
+
+    const juce::String label;
+    std::array<Channel, LevelMeter::maxChannels> channels;
+    int numChannels = 2;
+    double clipUntil = 0.0;
+    bool clipShown = false;
+    double lastUpdate = 0.0;
+
+    float dbToY(float db, juce::Rectangle<float> area) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LevelMeterComponent)
+};
@@ -0,0 +1,312 @@
+#include "LoudnessMeter.h"
+#include "SidecarCache.h"
+#include "SimdKernels.h"
+
+namespace
+{
+    // Bump when the measurement changes, so old results get re-analysed.
+    constexpr int cacheVersion = 1;
+
+    constexpr double absoluteGateLufs = -70.0;
+    constexpr double relativeGateLu = -10.0;
+    constexpr double truePeakCeilingDb = -1.0;
+
+    // What an unmeasured track is assumed to be: a loud modern master.
+    constexpr double provisionalLufs = -8.0;
+    constexpr double provisionalTruePeakDb = 0.0;
+
+    // 12 taps for each of the four phases, as in BS.1770 Annex 2.
+    constexpr int peakTaps = 12;
+
+    double energyToLufs(double meanSquare)
+    {
+        return -0.691 + 10.0 * std::log10(meanSquare);
+    }
+
+    double lufsToEnergy(double lufs)
+    {
+        return std::pow(10.0, (lufs + 0.691) / 10.0);
+    }
+}
+
+LoudnessMeter::LoudnessMeter(double sampleRate, int numChannelsToUse)
+    : numChannels(juce::jlimit(1, 2, numChannelsToUse)),
+    subBlockLength(juce::jmax(1, juce::roundToInt(sampleRate * 0.1)))
+{
+    // The K-weighting filters, recomputed for this rate from the analogue
+    // prototypes behind the 48 kHz coefficients in the standard.
+    {
+        const double frequency = 1681.974450955533;
+        const double gainDb = 3.999843853973347;
+        const double q = 0.7071752369554196;
+
+        const double k = std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+        const double vh = std::pow(10.0, gainDb / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+
+        shelf.b0 = (vh + vb * k / q + k * k) / a0;
+        shelf.b1 = 2.0 * (k * k - vh) / a0;
+        shelf.b2 = (vh - vb * k / q + k * k) / a0;
+        shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+        shelf.a2 = (1.0 - k / q + k * k) / a0;
+    }
+
+    {
+        const double frequency = 38.13547087602444;
+        const double q = 0.5003270373238773;
+
+        const double k = std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+        const double a0 = 1.0 + k / q + k * k;
+
+        highPass.b0 = 1.0;
+        highPass.b1 = -2.0;
+        highPass.b2 = 1.0;
+        highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+        highPass.a2 = (1.0 - k / q + k * k) / a0;
+    }
+
+    // Blackman-windowed sinc cut off at the original Nyquist, split into
+    // phases and scaled by 4 for the zeros stuffed in between samples.
+    const int length = 4 * peakTaps;
+    const double centre = (length - 1) / 2.0;
+    peakCoefficients.resize((size_t)length);
+
+    for (int tap = 0; tap < peakTaps; ++tap)
+    {
+        for (int phase = 0; phase < 4; ++phase)
+        {
+            const int j = 4 * tap + phase;
+            const double x = (j - centre) / 4.0;
+            const double sinc = std::sin(juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+            const double w = juce::MathConstants<double>::twoPi * j / (length - 1);
+            const double window = 0.42 - 0.5 * std::cos(w) + 0.08 * std::cos(2.0 * w);
+
+            peakCoefficients[(size_t)j] = (float)(sinc * window);
+        }
+    }
+
+    for (auto& input : peakInput)
+        input.assign((size_t)peakTaps - 1, 0.0f);
+}
+
+void LoudnessMeter::process(const juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    const float* channels[2] = { buffer.getReadPointer(0),
+                                 buffer.getReadPointer(numChannels > 1 ? 1 : 0) };
+
+    updatePeak(channels, numSamples);
+
+    for (int start = 0; start < numSamples;)
+    {
+        const int numThisTime = juce::jmin(numSamples - start, subBlockLength - subBlockFill);
+        subBlockEnergy += filterAndSum(channels, start, numThisTime);
+        subBlockFill += numThisTime;
+        start += numThisTime;
+
+        if (subBlockFill < subBlockLength)
+            break;
+
+        recentSubBlocks[numSubBlocks++ % 4] = subBlockEnergy;
+        subBlockEnergy = 0.0;
+        subBlockFill = 0;
+
+        if (numSubBlocks >= 4)
+        {
+            const double sum = recentSubBlocks[0] + recentSubBlocks[1] + recentSubBlocks[2] + recentSubBlocks[3];
+            blockEnergies.push_back(sum / (4.0 * subBlockLength));
+        }
+    }
+}
+
+double LoudnessMeter::filterAndSum(const float* const* channels, int start, int numSamples)
+{
+    const float* left = channels[0] + start;
+    const float* right = channels[1] + start;
+
+   #if AUDIO_SIMD_SSE
+    // Both channels go through the filters together, one per lane.
+    if (numChannels == 2)
+    {
+        const __m128d sb0 = _mm_set1_pd(shelf.b0), sb1 = _mm_set1_pd(shelf.b1), sb2 = _mm_set1_pd(shelf.b2);
+        const __m128d sa1 = _mm_set1_pd(shelf.a1), sa2 = _mm_set1_pd(shelf.a2);
+        const __m128d ha1 = _mm_set1_pd(highPass.a1), ha2 = _mm_set1_pd(highPass.a2);
+        const __m128d two = _mm_set1_pd(2.0);
+
+        __m128d s1 = _mm_set_pd(filterState[1][0], filterState[0][0]);
+        __m128d s2 = _mm_set_pd(filterState[1][1], filterState[0][1]);
+        __m128d h1 = _mm_set_pd(filterState[1][2], filterState[0][2]);
+        __m128d h2 = _mm_set_pd(filterState[1][3], filterState[0][3]);
+        __m128d energy = _mm_setzero_pd();
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const __m128d x = _mm_set_pd((double)right[i], (double)left[i]);
+
+            const __m128d y = _mm_add_pd(_mm_mul_pd(sb0, x), s1);
+            s1 = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(sb1, x), s2), _mm_mul_pd(sa1, y));
+            s2 = _mm_sub_pd(_mm_mul_pd(sb2, x), _mm_mul_pd(sa2, y));
+
+            // The high-pass numerator is 1, -2, 1.
+            const __m128d z = _mm_add_pd(y, h1);
+            h1 = _mm_sub_pd(_mm_sub_pd(h2, _mm_mul_pd(two, y)), _mm_mul_pd(ha1, z));
+            h2 = _mm_sub_pd(y, _mm_mul_pd(ha2, z));
+
+            energy = _mm_add_pd(energy, _mm_mul_pd(z, z));
+        }
+
+        alignas(16) double lanes[2];
+        _mm_store_pd(lanes, s1);
+        filterState[0][0] = lanes[0];
+        filterState[1][0] = lanes[1];
+        _mm_store_pd(lanes, s2);
+        filterState[0][1] = lanes[0];
+        filterState[1][1] = lanes[1];
+        _mm_store_pd(lanes, h1);
+        filterState[0][2] = lanes[0];
+        filterState[1][2] = lanes[1];
+        _mm_store_pd(lanes, h2);
+        filterState[0][3] = lanes[0];
+        filterState[1][3] = lanes[1];
+        _mm_store_pd(lanes, energy);
+        return lanes[0] + lanes[1];
+    }
+   #endif
+
+    double energy = 0.0;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const float* input = channel == 0 ? left : right;
+        auto* state = filterState[channel];
+        double s1 = state[0], s2 = state[1], h1 = state[2], h2 = state[3];
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const double x = input[i];
+
+            const double y = shelf.b0 * x + s1;
+            s1 = shelf.b1 * x + s2 - shelf.a1 * y;
+            s2 = shelf.b2 * x - shelf.a2 * y;
+
+            const double z = y + h1;
+            h1 = h2 - 2.0 * y - highPass.a1 * z;
+            h2 = y - highPass.a2 * z;
+
+            energy += z * z;
+        }
+
+        state[0] = s1;
+        state[1] = s2;
+        state[2] = h1;
+        state[3] = h2;
+    }
+
+    return energy;
+}
+
+void LoudnessMeter::updatePeak(const float* const* channels, int numSamples)
+{
+    const int history = peakTaps - 1;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto& input = peakInput[channel];
+        input.resize((size_t)(history + numSamples));
+        std::copy_n(channels[channel], numSamples, input.begin() + history);
+
+        peak = juce::jmax(peak, SimdKernels::oversampledPeak(input.data() + history, numSamples,
+            peakCoefficients.data(), peakTaps));
+
+        std::copy(input.end() - history, input.end(), input.begin());
+    }
+}
+
+LoudnessMeter::Result LoudnessMeter::getResult() const
+{
+    Result result;
+
+    const double absoluteGate = lufsToEnergy(absoluteGateLufs);
+    double sum = 0.0;
+    int count = 0;
+
+    for (auto energy : blockEnergies)
+    {
+        if (energy > absoluteGate)
+        {
+            sum += energy;
+            ++count;
+        }
+    }
+
+    if (count == 0)
+        return result;
+
+    const double relativeGate = juce::jmax(absoluteGate, sum / count * lufsToEnergy(relativeGateLu - 0.691));
+    sum = 0.0;
+    count = 0;
+
+    for (auto energy : blockEnergies)
+    {
+        if (energy > relativeGate)
+        {
+            sum += energy;
+            ++count;
+        }
+    }
+
+    if (count == 0)
+        return result;
+
+    result.valid = true;
+    result.integratedLufs = energyToLufs(sum / count);
+    result.truePeakDb = juce::Decibels::gainToDecibels((double)peak, -200.0);
+    return result;
+}
+
+float LoudnessMeter::getNormalisationGain(const Result& result, double targetLufs)
+{
+    if (!result.valid)
+        return 1.0f;
+
+    const double gainDb = juce::jmin(targetLufs - result.integratedLufs, truePeakCeilingDb - result.truePeakDb);
+    return juce::Decibels::decibelsToGain((float)gainDb);
+}
+
+float LoudnessMeter::getProvisionalGain(double targetLufs)
+{
+    Result loudMaster;
+    loudMaster.valid = true;
+    loudMaster.integratedLufs = provisionalLufs;
+    loudMaster.truePeakDb = provisionalTruePeakDb;
+
+    return juce::jmin(1.0f, getNormalisationGain(loudMaster, targetLufs));
+}
+
+bool LoudnessMeter::loadFromCache(const juce::File& file, Result& result)
+{
+    juce::MemoryBlock data;
+    if (!SidecarCache::loadByFingerprint(file, "loudness", data))
+        return false;
+
+    juce::MemoryInputStream in(data, false);
+
+    if (in.readInt() != cacheVersion || in.getNumBytesRemaining() < 17)
+        return false;
+
+    result.valid = in.readBool();
+    result.integratedLufs = in.readDouble();
+    result.truePeakDb = in.readDouble();
+    return true;
+}
+
+void LoudnessMeter::saveToCache(const juce::File& file, const Result& result)
+{
+    juce::MemoryOutputStream out;
+    out.writeInt(cacheVersion);
+    out.writeBool(result.valid);
+    out.writeDouble(result.integratedLufs);
+    out.writeDouble(result.truePeakDb);
+
+    SidecarCache::saveByFingerprint(file, "loudness", out.getMemoryBlock());
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+// Loudness of a whole track to EBU R128 (ITU-R BS.1770-4): K-weighted mean
+// square over 400 ms blocks every 100 ms, gated at -70 LUFS and then 10 LU
+// below the level of what passed, plus the true peak found by interpolating
+// to four times the sample rate. Feed it the track start to finish.
+class LoudnessMeter
+{
+public:
+    struct Result
+    {
+        bool valid = false;             // false when nothing clears the gates
+        double integratedLufs = 0.0;
+        double truePeakDb = 0.0;        // dBTP
+    };
+
+    // One or two channels; two are weighted equally as left and right.
+    LoudnessMeter(double sampleRate, int numChannels);
+
+    void process(const juce::AudioBuffer<float>& buffer, int numSamples);
+    Result getResult() const;
+
+    // The gain that brings a track to targetLufs, held back where that would
+    // push its true peak over -1 dBTP. 1 for an invalid result.
+    static float getNormalisationGain(const Result& result, double targetLufs);
+
+    // The gain to hold a track at until it has been measured: what a loud
+    // master would get, and never a boost. Most tracks then only get louder
+    // once their result arrives.
+    static float getProvisionalGain(double targetLufs);
+
+    // Kept by content fingerprint, like the beat grid.
+    static bool loadFromCache(const juce::File& file, Result& result);
+    static void saveToCache(const juce::File& file, const Result& result);
+
+private:
+    struct Biquad
+    {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+    };
+
+    const int numChannels;
+    Biquad shelf, highPass;
+
+    // Transposed direct form II state: shelf z1, z2, then high-pass z1, z2.
+    double filterState[2][4] = {};
+
+    const int subBlockLength;
+    int subBlockFill = 0;
+    double subBlockEnergy = 0.0;
+    double recentSubBlocks[4] = {};
+    int numSubBlocks = 0;
+    std::vector<double> blockEnergies;
+
+    std::vector<float> peakCoefficients;
+    std::vector<float> peakInput[2];
+    float peak = 0.0f;
+
+    double filterAndSum(const float* const* channels, int start, int numSamples);
+    void updatePeak(const float* const* channels, int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoudnessMeter)
+};
@@ -1,4 +1,5 @@
 #include <JuceHeader.h>
+#include "Benchmarks.h"
 #include "MainComponent.h"
 
 class SimpleAudioPlayer : public juce::JUCEApplication
@@ -10,6 +11,17 @@ public:
 
     void initialise(const juce::String& commandLine) override
     {
+       #if AUDIO_BENCHMARKS
+        const bool benchmarking = Benchmarks::runFromCommandLine(commandLine, [](const juce::String& report)
+            {
+                juce::Logger::writeToLog(report);
+                juce::JUCEApplication::quit();
+            });
+
+        if (benchmarking)
+            return;
+       #endif
+
         mainWindow = std::make_unique<MainWindow>(getApplicationName());
     }
 
@@ -40,7 +52,7 @@ private:
             setContentOwned(new MainComponent(), true);
             setResizable(true, true);
             setResizeLimits(800, 600, 1600, 1200);
-            centreWithSize(800, 800);
+            centreWithSize(800, 870);
             setVisible(true);
         }
 
@@ -1,4 +1,5 @@
 ﻿#include "MainComponent.h"
+#include "SidecarCache.h"
 #include <juce_data_structures/juce_data_structures.h>
 #include <random>
 
@@ -17,20 +18,24 @@ MainComponent::MainComponent()
 
     RestoreState();
 
-    startTimerHz(30);
-
+    setOpaque(true);
     addAndMakeVisible(playerGUI);
+    addAndMakeVisible(waveformView1);
+    addAndMakeVisible(waveformView2);
+    addAndMakeVisible(spectrumView);
     playerGUI.setListener(this);
     playerGUI.getMarkersList().setModel(this);
+    playerGUI.setSpeedMode(player1.isPitchPreserving() ? (int)player1.getStretchQuality() + 2 : 1);
+    playerGUI.setOnsetMarkersState(player1.getAutoOnsetMarkers());
 
     player1.addChangeListener(this);
+    player1.onTrackAdvanced = [this] { playlistTrackAdvanced(); };
     player2.addChangeListener(this);
-
-    mixerAudioSource.addInputSource(&player1, false);
-    mixerAudioSource.addInputSource(&player2, false);
+    thumbnail1.addChangeListener(this);
+    thumbnail2.addChangeListener(this);
 
     setAudioChannels(0, 2);
-    setSize(1000, 800);
+    setSize(1000, 870);
 }
 
 MainComponent::~MainComponent()
@@ -41,55 +46,33 @@ MainComponent::~MainComponent()
 
 void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-    player1.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    player2.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    mixerAudioSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    deckManager.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    spectrumAnalyser.setSampleRate(sampleRate);
 }
 
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    mixerAudioSource.getNextAudioBlock(bufferToFill);
+    deckManager.getNextAudioBlock(bufferToFill);
+    masterTap.push(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
 }
 
 void MainComponent::releaseResources()
 {
-    player1.releaseResources();
-    player2.releaseResources();
-    mixerAudioSource.releaseResources();
+    deckManager.releaseResources();
 }
 
 void MainComponent::paint(juce::Graphics& g)
 {
-    juce::ColourGradient bgGradient(
-        juce::Colour::fromRGB(5, 5, 15), 0, 0,
-        juce::Colour::fromRGB(20, 10, 35), 0, (float)getHeight(),
-        false);
-    g.setGradientFill(bgGradient);
-    g.fillAll();
-
-    g.setColour(juce::Colours::white);
-    for (int i = 0; i < 300; ++i)
-    {
-        float x = juce::Random::getSystemRandom().nextFloat() * getWidth();
-        float y = juce::Random::getSystemRandom().nextFloat() * getHeight();
-        float brightness = juce::Random::getSystemRandom().nextFloat() * 0.9f + 0.1f;
-        float size = juce::Random::getSystemRandom().nextFloat() * 1.5f + 0.5f;
-
-        juce::Colour starColour = juce::Colours::white.withBrightness(brightness);
-        g.setColour(starColour);
-        g.fillEllipse(x, y, size, size);
-    }
-
-    g.setColour(juce::Colour::fromRGBA(80, 60, 150, 30));
-    g.fillEllipse(getWidth() * 0.3f, getHeight() * 0.2f, 250, 150);
-
-    g.setColour(juce::Colour::fromRGBA(120, 80, 180, 25));
-    g.fillEllipse(getWidth() * 0.6f, getHeight() * 0.6f, 300, 200);
+   #if AUDIO_PAINT_TIMING
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+   #endif
 
-    auto titleArea = getLocalBounds().removeFromTop(40).reduced(20, 5);
-    g.setColour(juce::Colours::white.withAlpha(0.9f));
-    g.setFont(20.0f);
-    g.drawText("Dual Track Mixer - Two Waveforms, One Player", titleArea, juce::Justification::centred);
+   #if AUDIO_BENCHMARKS
+    if (!backgroundCached)
+        drawBackground(g);
+    else
+   #endif
+        paintCachedBackground(g);
 
     auto statusArea = getLocalBounds().removeFromTop(25).reduced(20, 0);
 
@@ -97,129 +80,86 @@ void MainComponent::paint(juce::Graphics& g)
     {
         g.setColour(juce::Colours::limegreen.withAlpha(0.8f));
         g.setFont(11.0f);
-        juce::String playlistInfo = "Playlist: " + juce::String(currentPlaylistIndex + 1) +
-            "/" + juce::String(playlist.size());
-        g.drawText(playlistInfo, statusArea.removeFromRight(100), juce::Justification::centredRight);
+        g.drawText(getPlaylistText(), statusArea.removeFromRight(100), juce::Justification::centredRight);
     }
 
     g.setColour(juce::Colours::white.withAlpha(0.6f));
     g.setFont(12.0f);
-    juce::String statusText = "Track 1: ";
-    if (player1.getLengthInSeconds() > 0)
-        statusText += player1.getMetadata().title;
-    else
-        statusText += "No File";
-
-    statusText += " | Track 2: ";
-    if (player2.getLengthInSeconds() > 0)
-        statusText += player2.getMetadata().title;
-    else
-        statusText += "No File";
+    g.drawText(getStatusText(), statusArea, juce::Justification::centredLeft);
 
-    g.drawText(statusText, statusArea, juce::Justification::centredLeft);
-
-    auto waveformArea = getLocalBounds().removeFromTop(240).reduced(20, 10);
-
-    g.setColour(juce::Colours::black.withAlpha(0.3f));
-    g.fillRoundedRectangle(waveformArea.toFloat(), 8.0f);
-    g.setColour(juce::Colours::white.withAlpha(0.2f));
-    g.drawRoundedRectangle(waveformArea.toFloat(), 8.0f, 1.0f);
+    auto mixInfoArea = getLocalBounds().removeFromTop(30).reduced(20, 5);
+    g.setColour(juce::Colours::white.withAlpha(0.7f));
+    g.setFont(12.0f);
+    g.drawText(getMixInfoText(), mixInfoArea, juce::Justification::centred);
 
-    auto waveform1Area = waveformArea.removeFromTop(waveformArea.getHeight() / 2).reduced(5, 5);
-    auto waveform2Area = waveformArea.reduced(5, 5);
+   #if AUDIO_PAINT_TIMING
+    // Smoothed over roughly the last second of frames.
+    const double elapsedMs = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1000.0;
+    averagePaintMilliseconds += (elapsedMs - averagePaintMilliseconds) * 0.05;
 
-    if (showWaveform1 && thumbnail1.getTotalLength() > 0.0)
+    if (++paintsSinceReport >= 300)
     {
-        g.setColour(juce::Colours::black.withAlpha(0.5f));
-        g.fillRoundedRectangle(waveform1Area.toFloat(), 4.0f);
-
-        juce::ColourGradient waveform1Gradient(
-            juce::Colours::cyan.withAlpha(0.8f), (float)waveform1Area.getX(), (float)waveform1Area.getCentreY(),
-            juce::Colours::blue.withAlpha(0.8f), (float)waveform1Area.getRight(), (float)waveform1Area.getCentreY(),
-            false);
-        g.setGradientFill(waveform1Gradient);
-        thumbnail1.drawChannel(g, waveform1Area, 0.0, thumbnail1.getTotalLength(), 0, 0.85f);
-
-        auto& markers1 = player1.getMarkers();
-        double totalLength1 = player1.getLengthInSeconds();
-        for (const auto& marker : markers1)
-        {
-            float xPos = (float)(marker.time / totalLength1) * waveform1Area.getWidth() + waveform1Area.getX();
-            g.setColour(juce::Colours::yellow);
-            g.drawLine(xPos, (float)waveform1Area.getY(), xPos, (float)waveform1Area.getBottom(), 2.0f);
+        juce::Logger::writeToLog("Paint: " + juce::String(averagePaintMilliseconds, 2) + " ms");
+        paintsSinceReport = 0;
+    }
+   #endif
+}
 
-            g.setColour(juce::Colours::orange);
-            g.fillEllipse(xPos - 3, waveform1Area.getBottom() - 8, 6, 6);
-        }
+// The gradient, stars, frames and fixed labels only change with the size of
+// the window, so they are drawn into an image once per size and display
+// scale and blitted from then on.
+void MainComponent::paintCachedBackground(juce::Graphics& g)
+{
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    const int imageWidth = juce::roundToInt(getWidth() * scale);
+    const int imageHeight = juce::roundToInt(getHeight() * scale);
 
-        if (player1.isPlaying())
-        {
-            double position = player1.getCurrentPosition();
-            double proportion = (totalLength1 > 0.0) ? (position / totalLength1) : 0.0;
-            float x = (float)waveform1Area.getX() + (float)(proportion * waveform1Area.getWidth());
-            g.setColour(juce::Colours::white);
-            g.drawLine(x, (float)waveform1Area.getY(), x, (float)waveform1Area.getBottom(), 2.0f);
-        }
+    if (imageWidth <= 0 || imageHeight <= 0)
+        return;
 
-        g.setColour(juce::Colours::white.withAlpha(0.8f));
-        g.setFont(12.0f);
-        g.drawText("Track 1: " + player1.getMetadata().title, waveform1Area, juce::Justification::topLeft);
-    }
-    else
+    if (!backgroundCache.isValid() || backgroundCache.getWidth() != imageWidth
+        || backgroundCache.getHeight() != imageHeight || backgroundCacheScale != scale)
     {
-        g.setColour(juce::Colours::white.withAlpha(0.4f));
-        g.setFont(14.0f);
-        g.drawText("Load Track 1", waveform1Area, juce::Justification::centred);
-    }
+        backgroundCache = juce::Image(juce::Image::RGB, imageWidth, imageHeight, false);
+        backgroundCacheScale = scale;
 
-    if (showWaveform2 && thumbnail2.getTotalLength() > 0.0)
-    {
-        g.setColour(juce::Colours::black.withAlpha(0.5f));
-        g.fillRoundedRectangle(waveform2Area.toFloat(), 4.0f);
+        juce::Graphics imageGraphics(backgroundCache);
+        imageGraphics.addTransform(juce::AffineTransform::scale(scale));
+        drawBackground(imageGraphics);
+    }
 
-        juce::ColourGradient waveform2Gradient(
-            juce::Colours::green.withAlpha(0.8f), (float)waveform2Area.getX(), (float)waveform2Area.getCentreY(),
-            juce::Colours::lime.withAlpha(0.8f), (float)waveform2Area.getRight(), (float)waveform2Area.getCentreY(),
-            false);
-        g.setGradientFill(waveform2Gradient);
-        thumbnail2.drawChannel(g, waveform2Area, 0.0, thumbnail2.getTotalLength(), 0, 0.85f);
+    g.drawImageTransformed(backgroundCache, juce::AffineTransform::scale(1.0f / scale));
+}
 
-        auto& markers2 = player2.getMarkers();
-        double totalLength2 = player2.getLengthInSeconds();
-        for (const auto& marker : markers2)
-        {
-            float xPos = (float)(marker.time / totalLength2) * waveform2Area.getWidth() + waveform2Area.getX();
-            g.setColour(juce::Colours::yellow);
-            g.drawLine(xPos, (float)waveform2Area.getY(), xPos, (float)waveform2Area.getBottom(), 2.0f);
+juce::Rectangle<int> MainComponent::getHeaderArea() const
+{
+    return getLocalBounds().removeFromTop(30);
+}
 
-            g.setColour(juce::Colours::orange);
-            g.fillEllipse(xPos - 3, waveform2Area.getBottom() - 8, 6, 6);
-        }
+juce::String MainComponent::getPlaylistText() const
+{
+    return "Playlist: " + juce::String(currentPlaylistIndex + 1) + "/" + juce::String(playlist.size());
+}
 
-        if (player2.isPlaying())
-        {
-            double position = player2.getCurrentPosition();
-            double proportion = (totalLength2 > 0.0) ? (position / totalLength2) : 0.0;
-            float x = (float)waveform2Area.getX() + (float)(proportion * waveform2Area.getWidth());
-            g.setColour(juce::Colours::white);
-            g.drawLine(x, (float)waveform2Area.getY(), x, (float)waveform2Area.getBottom(), 2.0f);
-        }
+juce::String MainComponent::getStatusText() const
+{
+    juce::String statusText = "Track 1: ";
+    if (player1.getLengthInSeconds() > 0)
+        statusText += player1.getMetadata().title;
+    else
+        statusText += "No File";
 
-        g.setColour(juce::Colours::white.withAlpha(0.8f));
-        g.setFont(12.0f);
-        g.drawText("Track 2: " + player2.getMetadata().title, waveform2Area, juce::Justification::topLeft);
-    }
+    statusText += " | Track 2: ";
+    if (player2.getLengthInSeconds() > 0)
+        statusText += player2.getMetadata().title;
     else
-    {
-        g.setColour(juce::Colours::white.withAlpha(0.4f));
-        g.setFont(14.0f);
-        g.drawText("Load Track 2", waveform2Area, juce::Justification::centred);
-    }
+        statusText += "No File";
 
-    auto mixInfoArea = getLocalBounds().removeFromTop(30).reduced(20, 5);
-    g.setColour(juce::Colours::white.withAlpha(0.7f));
-    g.setFont(12.0f);
+    return statusText;
+}
 
+juce::String MainComponent::getMixInfoText() const
+{
     juce::String mixInfo = "Mixer: ";
     if (player1.isPlaying() && player2.isPlaying())
         mixInfo += "Both Tracks Active | ";
@@ -234,13 +174,72 @@ void MainComponent::paint(juce::Graphics& g)
         " T2=" + juce::String(player2.getVolume(), 2) +
         " | Speed: T1=" + juce::String(player1.getSpeed(), 2) + "x T2=" + juce::String(player2.getSpeed(), 2) + "x";
 
-    g.drawText(mixInfo, mixInfoArea, juce::Justification::centred);
+    if (player1.isPitchPreserving() || player2.isPitchPreserving())
+        mixInfo += " | Stretch CPU: T1=" + juce::String(player1.getStretchCpuLoad() * 100.0f, 1) +
+            "% T2=" + juce::String(player2.getStretchCpuLoad() * 100.0f, 1) + "%";
+
+    const auto cacheStats = decodedCache->getStats();
+    if (cacheStats.numBlocks > 0)
+        mixInfo += " | Cache: " + juce::String((double)cacheStats.bytesResident / (1024.0 * 1024.0), 0) + " MB, "
+            + juce::String(cacheStats.getHitRate() * 100.0f, 0) + "% hits";
+
+    if (const auto deferred = player1.getDeferredCommandCount() + player2.getDeferredCommandCount(); deferred > 0)
+        mixInfo += " | Deferred commands: " + juce::String(deferred);
+
+    return mixInfo;
+}
+
+void MainComponent::drawBackground(juce::Graphics& g) const
+{
+    juce::ColourGradient bgGradient(
+        juce::Colour::fromRGB(5, 5, 15), 0, 0,
+        juce::Colour::fromRGB(20, 10, 35), 0, (float)getHeight(),
+        false);
+    g.setGradientFill(bgGradient);
+    g.fillAll();
+
+    // A fixed seed keeps the same sky from one size to the next.
+    juce::Random random(0x5eed);
+
+    g.setColour(juce::Colours::white);
+    for (int i = 0; i < 300; ++i)
+    {
+        float x = random.nextFloat() * getWidth();
+        float y = random.nextFloat() * getHeight();
+        float brightness = random.nextFloat() * 0.9f + 0.1f;
+        float size = random.nextFloat() * 1.5f + 0.5f;
+
+        juce::Colour starColour = juce::Colours::white.withBrightness(brightness);
+        g.setColour(starColour);
+        g.fillEllipse(x, y, size, size);
+    }
+
+    g.setColour(juce::Colour::fromRGBA(80, 60, 150, 30));
+    g.fillEllipse(getWidth() * 0.3f, getHeight() * 0.2f, 250, 150);
+
+    g.setColour(juce::Colour::fromRGBA(120, 80, 180, 25));
+    g.fillEllipse(getWidth() * 0.6f, getHeight() * 0.6f, 300, 200);
+
+    auto titleArea = getLocalBounds().removeFromTop(40).reduced(20, 5);
+    g.setColour(juce::Colours::white.withAlpha(0.9f));
+    g.setFont(20.0f);
+    g.drawText("Dual Track Mixer - Two Waveforms, One Player", titleArea, juce::Justification::centred);
+
+    const auto waveformArea = getWaveformArea();
+
+    for (const auto& panel : { waveformArea, getAnalyserArea() })
+    {
+        g.setColour(juce::Colours::black.withAlpha(0.3f));
+        g.fillRoundedRectangle(panel.toFloat(), 8.0f);
+        g.setColour(juce::Colours::white.withAlpha(0.2f));
+        g.drawRoundedRectangle(panel.toFloat(), 8.0f, 1.0f);
+    }
 
     g.setColour(juce::Colours::white.withAlpha(0.15f));
     for (int i = 0; i < 400; ++i)
     {
-        float x = juce::Random::getSystemRandom().nextFloat() * getWidth();
-        float y = juce::Random::getSystemRandom().nextFloat() * getHeight();
+        float x = random.nextFloat() * getWidth();
+        float y = random.nextFloat() * getHeight();
         g.fillEllipse(x, y, 0.3f, 0.3f);
     }
 
@@ -265,10 +264,26 @@ void MainComponent::resized()
     area.removeFromTop(40);
     area.removeFromTop(25);
     area.removeFromTop(240);
-    area.removeFromTop(30);
+    area.removeFromTop(100);
     area.removeFromBottom(20);
 
     playerGUI.setBounds(area.reduced(10, 5));
+
+    auto waveformArea = getWaveformArea();
+    waveformView1.setBounds(waveformArea.removeFromTop(waveformArea.getHeight() / 2).reduced(5, 5));
+    waveformView2.setBounds(waveformArea.reduced(5, 5));
+
+    spectrumView.setBounds(getAnalyserArea().reduced(5, 5));
+}
+
+juce::Rectangle<int> MainComponent::getWaveformArea() const
+{
+    return getLocalBounds().removeFromTop(240).reduced(20, 10);
+}
+
+juce::Rectangle<int> MainComponent::getAnalyserArea() const
+{
+    return getLocalBounds().withTrimmedTop(240).removeFromTop(165).reduced(20, 5);
 }
 
 void MainComponent::loadButtonClicked()
@@ -288,21 +303,19 @@ void MainComponent::loadButtonClicked()
             {
                 if (currentLoadingTrack == 1)
                 {
-                    player1.loadFile(file);
+                    player1.loadFileAsync(file);
                     playerGUI.setPlaybackState(false);
                     playerGUI.setLoopState(player1.isLoopingEnabled());
                     playerGUI.setMuteState(false);
 
-                    thumbnail1.setSource(new juce::FileInputSource(file));
-                    showWaveform1 = true;
+                    waveformView1.trackChanged(file);
 
                     currentLoadingTrack = 2;
                 }
                 else
                 {
-                    player2.loadFile(file);
-                    thumbnail2.setSource(new juce::FileInputSource(file));
-                    showWaveform2 = true;
+                    player2.loadFileAsync(file);
+                    waveformView2.trackChanged(file);
 
                     currentLoadingTrack = 1;
                 }
@@ -385,6 +398,19 @@ void MainComponent::speedChanged(float newSpeed)
     player2.setSpeed(newSpeed);
 }
 
+void MainComponent::speedModeChanged(int modeId)
+{
+    // 1 is plain varispeed; 2-4 keep pitch at increasing stretch quality.
+    const bool keepPitch = modeId > 1;
+    const auto quality = (TimeStretchSource::Quality)juce::jlimit(0, 2, modeId - 2);
+
+    for (auto* player : { &player1, &player2 })
+    {
+        player->setStretchQuality(quality);
+        player->setPitchPreserving(keepPitch);
+    }
+}
+
 void MainComponent::toggleMute()
 {
     isMuted = !isMuted;
@@ -427,9 +453,21 @@ void MainComponent::positionSliderMoved(double newSeconds)
     player2.setPosition(newSeconds);
 }
 
-void MainComponent::timerCallback()
+bool MainComponent::updateUi()
 {
-    repaint();
+    waveformView1.updatePlayhead();
+    waveformView2.updatePlayhead();
+
+    // The header text is repainted only when it reads differently.
+    auto headerText = getStatusText() + "\n" + getMixInfoText();
+    if (playlistLoaded)
+        headerText += "\n" + getPlaylistText();
+
+    if (headerText != lastHeaderText)
+    {
+        lastHeaderText = headerText;
+        repaint(getHeaderArea());
+    }
 
     double total1 = player1.getLengthInSeconds();
     double current1 = player1.getCurrentPosition();
@@ -441,6 +479,7 @@ void MainComponent::timerCallback()
 
     if (!std::isfinite(displayTotal) || displayTotal <= 0.0) displayTotal = 0.0;
 
+    // The setters below leave their widgets alone when nothing has changed.
     playerGUI.updatePositionDisplay(displayCurrent, displayTotal);
 
     bool anyPlaying = player1.isPlaying() || player2.isPlaying();
@@ -449,14 +488,41 @@ void MainComponent::timerCallback()
     playerGUI.setMarkerAState(player1.getMarkerA() >= 0);
     playerGUI.setMarkerBState(player1.getMarkerB() >= 0);
     playerGUI.setSegmentLoopState(player1.isSegmentLooping());
+
+    const bool exportingSlice = player1.isExportingSlice();
+    const bool exportingRegions = player1.isExportingRegions();
+
+    if (exportingSlice)
+        playerGUI.setSliceExportProgress(player1.getSliceExportProgress());
+
+    if (exportingRegions)
+        playerGUI.setRegionExportProgress(true, player1.getRegionExportProgress());
+
+    spectrumView.update();
+
+    const bool metersMoving = playerGUI.updateMeters(player1.getOutputMeter(), player2.getOutputMeter(),
+        deckManager.getMasterMeter());
+
+    return anyPlaying || exportingSlice || exportingRegions || metersMoving;
 }
 
 void MainComponent::SaveState()
 {
     if (propertiesFile)
     {
-        player1.SaveState(*propertiesFile, "player1");
-        player2.SaveState(*propertiesFile, "player2");
+        propertiesFile->setValue("numDecks", deckManager.getNumDecks());
+        propertiesFile->setValue("parallelDeckRendering", deckManager.isParallelRendering());
+
+        for (int i = 0; i < deckManager.getNumDecks(); ++i)
+            deckManager.getDeck(i).SaveState(*propertiesFile, "player" + juce::String(i + 1));
+
+        propertiesFile->setValue("decodedCacheMB", (int)(decodedCache->getMemoryBudget() / (1024 * 1024)));
+        propertiesFile->setValue("thumbnailCacheMB", (int)(thumbnailCache.getDiskBudget() / (1024 * 1024)));
+        propertiesFile->setValue("analysisCacheMB", (int)(SidecarCache::getDiskBudget() / (1024 * 1024)));
+
+        propertiesFile->setValue("spectrumSource", spectrumView.getSourceIndex());
+        propertiesFile->setValue("spectrumFftOrder", spectrumAnalyser.getFftOrder());
+        propertiesFile->setValue("spectrumOverlap", spectrumAnalyser.getOverlap());
     }
 }
 
@@ -464,20 +530,31 @@ void MainComponent::RestoreState()
 {
     if (propertiesFile)
     {
-        player1.RestoreState(*propertiesFile, "player1");
-        player2.RestoreState(*propertiesFile, "player2");
+        deckManager.setNumDecks(propertiesFile->getIntValue("numDecks", DeckManager::minDecks));
+        deckManager.setParallelRendering(propertiesFile->getBoolValue("parallelDeckRendering", true));
+
+        for (int i = 0; i < deckManager.getNumDecks(); ++i)
+            deckManager.getDeck(i).RestoreState(*propertiesFile, "player" + juce::String(i + 1));
+
+        const int cacheMegabytes = juce::jlimit(16, 4096, propertiesFile->getIntValue("decodedCacheMB", 256));
+        decodedCache->setMemoryBudget((size_t)cacheMegabytes * 1024 * 1024);
+
+        const int thumbnailMegabytes = juce::jlimit(1, 1024, propertiesFile->getIntValue("thumbnailCacheMB", 64));
+        thumbnailCache.setDiskBudget((juce::int64)thumbnailMegabytes * 1024 * 1024);
+
+        const int analysisMegabytes = juce::jlimit(1, 1024, propertiesFile->getIntValue("analysisCacheMB", 64));
+        SidecarCache::setDiskBudget((juce::int64)analysisMegabytes * 1024 * 1024);
+
+        spectrumAnalyser.setFftOrder(propertiesFile->getIntValue("spectrumFftOrder", 11));
+        spectrumAnalyser.setOverlap(propertiesFile->getIntValue("spectrumOverlap", 4));
+        spectrumView.setSourceIndex(propertiesFile->getIntValue("spectrumSource", 0));
 
         juce::String lastFilePath = propertiesFile->getValue("player1_lastFile");
         juce::File lastFile(lastFilePath);
 
         if (lastFile.existsAsFile())
         {
-            thumbnail1.setSource(new juce::FileInputSource(lastFile));
-            showWaveform1 = true;
-        }
-        else
-        {
-            showWaveform1 = false;
+            waveformView1.trackChanged(lastFile);
         }
     }
 }
@@ -518,6 +595,13 @@ void MainComponent::segmentLoopButtonClicked()
     }
 }
 
+void MainComponent::onsetMarkersButtonClicked()
+{
+    const bool newState = !player1.getAutoOnsetMarkers();
+    player1.setAutoOnsetMarkers(newState);
+    playerGUI.setOnsetMarkersState(newState);
+}
+
 void MainComponent::sliceButtonClicked()
 {
     bool success = player1.createSliceFromMarkers();
@@ -542,6 +626,13 @@ void MainComponent::sliceButtonClicked()
 
 void MainComponent::saveSliceButtonClicked()
 {
+    // While an export runs, this button cancels it.
+    if (player1.isExportingSlice())
+    {
+        player1.cancelSliceExport();
+        return;
+    }
+
     bool hasValidSlice = player1.hasValidSlice();
 
     if (!hasValidSlice)
@@ -552,29 +643,48 @@ void MainComponent::saveSliceButtonClicked()
         return;
     }
 
+    // Offer the source's own format first: PCM WAV/AIFF and MP3 slices are
+    // copied out of the file instead of being decoded and re-encoded.
+    const auto extension = player1.getSliceExportExtension();
+    const auto patterns = extension.equalsIgnoreCase(".wav") ? juce::String("*.wav") : "*" + extension + ";*.wav";
+
     fileChooser = std::make_unique<juce::FileChooser>(
-        "Save audio slice as WAV file...",
+        "Save audio slice as " + extension.substring(1).toUpperCase() + " file...",
         juce::File::getSpecialLocation(juce::File::userDocumentsDirectory),
-        "*.wav");
+        patterns);
 
     fileChooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles,
-        [this](const juce::FileChooser& chooser)
+        [this, extension](const juce::FileChooser& chooser)
         {
             auto file = chooser.getResult();
             if (file != juce::File{})
             {
-                if (!file.hasFileExtension(".wav"))
+                if (!file.hasFileExtension(".wav") && !file.hasFileExtension(extension))
                 {
-                    file = file.withFileExtension(".wav");
+                    file = file.withFileExtension(extension);
                 }
 
-                bool success = player1.saveSliceToFile(file);
-
-                if (success)
+                const bool started = player1.exportSliceAsync(file, [this, file](bool success)
+                    {
+                        updateSliceState();
+
+                        if (success)
+                        {
+                            juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon,
+                                "Slice Saved",
+                                "Audio slice saved successfully to:\n" + file.getFullPathName());
+                        }
+                        else
+                        {
+                            juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon,
+                                "Save Failed",
+                                "The audio slice was not saved. The export was cancelled, or the file could not be written.");
+                        }
+                    });
+
+                if (started)
                 {
-                    juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon,
-                        "Slice Saved",
-                        "Audio slice saved successfully to:\n" + file.getFullPathName());
+                    playerGUI.setSliceExportProgress(0.0f);
                 }
                 else
                 {
@@ -586,6 +696,51 @@ void MainComponent::saveSliceButtonClicked()
         });
 }
 
+void MainComponent::exportRegionsButtonClicked()
+{
+    if (player1.isExportingRegions())
+    {
+        player1.cancelRegionExport();
+        return;
+    }
+
+    if (player1.getMarkers().size() < 2)
+    {
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon,
+            "No Regions",
+            "Add at least two markers. Each pair of neighbouring markers is exported as one region.");
+        return;
+    }
+
+    fileChooser = std::make_unique<juce::FileChooser>(
+        "Choose a folder for the exported regions...",
+        juce::File::getSpecialLocation(juce::File::userDocumentsDirectory));
+
+    fileChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectDirectories,
+        [this](const juce::FileChooser& chooser)
+        {
+            auto directory = chooser.getResult();
+            if (directory == juce::File{})
+                return;
+
+            const bool started = player1.exportMarkerRegionsAsync(directory,
+                [this](const PlayerAudio::RegionExportSummary& summary)
+                {
+                    playerGUI.setRegionExportProgress(false, 0.0f);
+                    juce::AlertWindow::showMessageBoxAsync(
+                        summary.failed > 0 ? juce::AlertWindow::WarningIcon : juce::AlertWindow::InfoIcon,
+                        "Region Export", summary.toString());
+                });
+
+            if (started)
+                playerGUI.setRegionExportProgress(true, 0.0f);
+            else
+                juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon,
+                    "Region Export",
+                    "Could not start the export. Check that the folder can be written to.");
+        });
+}
+
 void MainComponent::updateSliceState()
 {
     playerGUI.setSliceState(player1.hasValidSlice());
@@ -598,17 +753,33 @@ void MainComponent::updateMetadataDisplay()
 
     juce::String metadataText;
 
+    auto withAnalysis = [](const PlayerAudio::Metadata& metadata)
+    {
+        juce::StringArray details;
+
+        if (metadata.beatGrid.isValid())
+            details.add(juce::String(metadata.beatGrid.bpm, 1) + " BPM");
+
+        if (metadata.loudness.valid)
+            details.add(juce::String(metadata.loudness.integratedLufs, 1) + " LUFS");
+
+        if (details.isEmpty())
+            return metadata.title;
+
+        return metadata.title + " (" + details.joinIntoString(", ") + ")";
+    };
+
     if (metadata1.title.isNotEmpty())
     {
-        metadataText = "T1: " + metadata1.title;
+        metadataText = "T1: " + withAnalysis(metadata1);
         if (metadata2.title.isNotEmpty())
         {
-            metadataText += " | T2: " + metadata2.title;
+            metadataText += " | T2: " + withAnalysis(metadata2);
         }
     }
     else if (metadata2.title.isNotEmpty())
     {
-        metadataText = "T2: " + metadata2.title;
+        metadataText = "T2: " + withAnalysis(metadata2);
     }
     else
     {
@@ -648,10 +819,12 @@ int MainComponent::getNumRows()
 void MainComponent::paintListBoxItem(int rowNumber, juce::Graphics& g,
     int width, int height, bool rowIsSelected)
 {
-    juce::Array<PlayerAudio::Marker> markers = player1.getMarkers();
+    const auto& markers = player1.getMarkers();
 
+    // The list box only asks for the rows it shows; each costs one O(log n) lookup.
     if (rowNumber < markers.size())
     {
+        const auto& marker = markers.getReference(rowNumber);
         auto textColour = juce::Colour(0xFFB0AFFF);
         auto highlightColour = juce::Colour(0xFF9370DB);
 
@@ -667,11 +840,11 @@ void MainComponent::paintListBoxItem(int rowNumber, juce::Graphics& g,
 
         g.setFont(14.0f);
 
-        int minutes = static_cast<int>(markers[rowNumber].time) / 60;
-        int seconds = static_cast<int>(markers[rowNumber].time) % 60;
+        int minutes = static_cast<int>(marker.time) / 60;
+        int seconds = static_cast<int>(marker.time) % 60;
         juce::String timeString = juce::String::formatted("%02d:%02d", minutes, seconds);
 
-        g.drawText(markers[rowNumber].name + " - " + timeString,
+        g.drawText(marker.name + " - " + timeString,
             8, 0, width - 8, height,
             juce::Justification::centredLeft);
     }
@@ -690,11 +863,23 @@ void MainComponent::changeListenerCallback(juce::ChangeBroadcaster* source)
         playerGUI.getMarkersList().repaint();
 
         updateMetadataDisplay();
+        waveformView1.repaint();
     }
     else if (source == &player2)
     {
         updateMetadataDisplay();
+        waveformView2.repaint();
+    }
+    else if (source == &thumbnail1)
+    {
+        waveformView1.repaint();
+    }
+    else if (source == &thumbnail2)
+    {
+        waveformView2.repaint();
     }
+
+    uiUpdates.wake();
 }
 
 void MainComponent::loadPlaylistButtonClicked()
@@ -802,20 +987,47 @@ void MainComponent::playTrack(int index)
     {
         currentPlaylistIndex = index;
 
-        player1.loadFile(playlist[index]);
+        player1.loadFileAsync(playlist[index], [this](bool loaded)
+            {
+                if (loaded)
+                    queueNextPlaylistTrack();
+            });
         playerGUI.setPlaybackState(false);
 
-        thumbnail1.setSource(new juce::FileInputSource(playlist[index]));
-        showWaveform1 = true;
+        waveformView1.trackChanged(playlist[index]);
 
         updatePlaylistDisplay();
         repaint();
     }
 }
 
+void MainComponent::queueNextPlaylistTrack()
+{
+    const int nextIndex = currentPlaylistIndex + 1;
+
+    if (playlistLoaded && currentPlaylistIndex >= 0 && nextIndex < playlist.size())
+        player1.queueNextFile(playlist[nextIndex]);
+    else
+        player1.clearQueuedFile();
+}
+
+void MainComponent::playlistTrackAdvanced()
+{
+    // player1 has already spliced into the queued track; just catch the UI up.
+    currentPlaylistIndex = playlist.indexOf(player1.getCurrentFile());
+
+    waveformView1.trackChanged(player1.getCurrentFile());
+
+    updatePlaylistDisplay();
+    updateMetadataDisplay();
+    queueNextPlaylistTrack();
+    repaint();
+}
+
 void MainComponent::updatePlaylistDisplay()
 {
-    playerGUI.getPlaylistBox().clear();
+    // Silent updates: a notification here would reload the selected track.
+    playerGUI.getPlaylistBox().clear(juce::dontSendNotification);
 
     for (int i = 0; i < playlist.size(); ++i)
     {
@@ -825,6 +1037,6 @@ void MainComponent::updatePlaylistDisplay()
 
     if (currentPlaylistIndex >= 0 && currentPlaylistIndex < playlist.size())
     {
-        playerGUI.getPlaylistBox().setSelectedId(currentPlaylistIndex + 1);
+        playerGUI.getPlaylistBox().setSelectedId(currentPlaylistIndex + 1, juce::dontSendNotification);
     }
 }
\ No newline at end of file
@@ -1,12 +1,24 @@
 #pragma once
 #include <JuceHeader.h>
+#include "Benchmarks.h"
+#include "DeckManager.h"
+#include "DiskThumbnailCache.h"
 #include "PlayerAudio.h"
 #include "PlayerGUI.h"
+#include "SpectrumView.h"
+#include "UiUpdateScheduler.h"
+#include "WaveformView.h"
+
+// Times MainComponent::paint() and logs the average every few seconds of
+// frames. Off unless defined as 1; --benchmark=paint gives the same figure
+// without a window.
+#ifndef AUDIO_PAINT_TIMING
+ #define AUDIO_PAINT_TIMING 0
+#endif
 
 class MainComponent : public juce::AudioAppComponent,
     public PlayerGUI::Listener,
     public juce::ChangeListener,
-    public juce::Timer,
     public juce::ListBoxModel
 {
 public:
@@ -20,6 +32,12 @@ public:
     void paint(juce::Graphics&) override;
     void resized() override;
 
+   #if AUDIO_BENCHMARKS
+    // Lets the paint benchmark time redrawing the background on every frame
+    // against blitting the cached image.
+    void setBackgroundCached(bool shouldCache) { backgroundCached = shouldCache; }
+   #endif
+
     void loadButtonClicked() override;
     void loadSecondTrackButtonClicked() override;
     void playButtonClicked() override;
@@ -29,6 +47,7 @@ public:
     void muteButtonClicked() override;
     void volumeChanged(float newVolume) override;
     void speedChanged(float newSpeed) override;
+    void speedModeChanged(int modeId) override;
     void forwardButtonClicked() override;
     void backwardButtonClicked() override;
     void goToEndButtonClicked() override;
@@ -37,12 +56,14 @@ public:
     void markerBButtonClicked() override;
     void clearMarkersButtonClicked() override;
     void segmentLoopButtonClicked() override;
+    void onsetMarkersButtonClicked() override;
     void sliceButtonClicked() override;
     void saveSliceButtonClicked() override;
 
 
     void addMarkerButtonClicked() override;
     void deleteMarkerButtonClicked() override;
+    void exportRegionsButtonClicked() override;
     void jumpToMarker(int index) override;
 
     void loadPlaylistButtonClicked() override;
@@ -50,8 +71,6 @@ public:
     void nextTrackButtonClicked() override;
     void playlistBoxChanged(int selectedId) override;
 
-    void timerCallback() override;
-
     int getNumRows() override;
     void paintListBoxItem(int rowNumber, juce::Graphics& g,
         int width, int height, bool rowIsSelected) override;
@@ -60,16 +79,27 @@ public:
     void changeListenerCallback(juce::ChangeBroadcaster* source) override;
 
 private:
-    PlayerAudio player1;
-    PlayerAudio player2;
+    DeckManager deckManager;
+
+    // The GUI drives the first two decks; any further decks are restored from
+    // the settings and mixed alongside them.
+    PlayerAudio& player1{ deckManager.getDeck(0) };
+    PlayerAudio& player2{ deckManager.getDeck(1) };
     PlayerGUI playerGUI;
 
     juce::AudioFormatManager formatManager;
-    juce::AudioThumbnailCache thumbnailCache{ 2 };
+    DiskThumbnailCache thumbnailCache{ 8, 64 * 1024 * 1024 };
     juce::AudioThumbnail thumbnail1{ 512, formatManager, thumbnailCache };
     juce::AudioThumbnail thumbnail2{ 512, formatManager, thumbnailCache };
-    bool showWaveform1 = false;
-    bool showWaveform2 = false;
+    juce::SharedResourcePointer<DecodedBlockCache> decodedCache;
+    WaveformView waveformView1{ player1, thumbnail1, "Track 1", juce::Colours::cyan, juce::Colours::blue };
+    WaveformView waveformView2{ player2, thumbnail2, "Track 2", juce::Colours::green, juce::Colours::lime };
+
+    // The mix as it leaves getNextAudioBlock, for the spectrum view.
+    AudioTap masterTap;
+    SpectrumAnalyser spectrumAnalyser;
+    SpectrumView spectrumView{ spectrumAnalyser, { { "Mix", &masterTap },
+        { "Track 1", &player1.getOutputTap() }, { "Track 2", &player2.getOutputTap() } } };
 
     std::unique_ptr<juce::FileChooser> fileChooser;
     std::unique_ptr<juce::PropertiesFile> propertiesFile;
@@ -77,12 +107,33 @@ private:
     bool isMuted = false;
     float previousVolume = 0.5f;
 
-    juce::MixerAudioSource mixerAudioSource;
     void toggleMute();
     void SaveState();
     void RestoreState();
     void updateSliceState();
     void updateMetadataDisplay();
+    juce::Rectangle<int> getWaveformArea() const;
+    juce::Rectangle<int> getAnalyserArea() const;
+    juce::Rectangle<int> getHeaderArea() const;
+    juce::String getPlaylistText() const;
+    juce::String getStatusText() const;
+    juce::String getMixInfoText() const;
+    void drawBackground(juce::Graphics& g) const;
+    void paintCachedBackground(juce::Graphics& g);
+
+    // Everything in paint() that doesn't change between frames, at the
+    // window's current size and display scale.
+    juce::Image backgroundCache;
+    float backgroundCacheScale = 0.0f;
+
+   #if AUDIO_BENCHMARKS
+    bool backgroundCached = true;
+   #endif
+
+   #if AUDIO_PAINT_TIMING
+    double averagePaintMilliseconds = 0.0;
+    int paintsSinceReport = 0;
+   #endif
 
     int currentLoadingTrack = 1;
 
@@ -94,8 +145,16 @@ private:
     void playNextInPlaylist();
     void playPreviousInPlaylist();
     void playTrack(int index);
+    void queueNextPlaylistTrack();
+    void playlistTrackAdvanced();
     void updatePlaylistDisplay(); 
 
+    // Runs at the display rate while a deck plays, an export runs or a meter
+    // is still falling back, and not at all otherwise.
+    bool updateUi();
+    juce::String lastHeaderText;
+    UiUpdateScheduler uiUpdates{ *this, [this] { return updateUi(); } };
+
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
\ No newline at end of file
@@ -0,0 +1,271 @@
+#include "MappedPcmSource.h"
+#include "SimdKernels.h"
+
+namespace
+{
+    constexpr double prefetchSeconds = 2.0;
+    constexpr int pageSize = 4096;
+
+    // Walks the RIFF chunks of a WAV file to the start of its sample data.
+    bool findWavDataChunk(const juce::File& file, juce::int64& dataStart, juce::int64& dataLength)
+    {
+        juce::FileInputStream in(file);
+
+        if (!in.openedOk() || in.readInt() != (int)juce::ByteOrder::littleEndianInt("RIFF"))
+            return false;
+
+        in.skipNextBytes(4);
+
+        if (in.readInt() != (int)juce::ByteOrder::littleEndianInt("WAVE"))
+            return false;
+
+        while (!in.isExhausted())
+        {
+            const auto chunkType = in.readInt();
+            const auto chunkLength = (juce::int64)(juce::uint32)in.readInt();
+
+            if (chunkType == (int)juce::ByteOrder::littleEndianInt("data"))
+            {
+                dataStart = in.getPosition();
+                dataLength = juce::jmin(chunkLength, in.getTotalLength() - dataStart);
+                return true;
+            }
+
+            in.skipNextBytes(chunkLength + (chunkLength & 1));
+        }
+
+        return false;
+    }
+}
+
+std::unique_ptr<MappedPcmSource> MappedPcmSource::create(juce::AudioFormatManager& formatManager,
+    const juce::File& file, juce::TimeSliceThread& thread)
+{
+    auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+    if (format == nullptr)
+        return nullptr;
+
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+
+    if (mapped == nullptr || mapped->sampleRate <= 0.0 || mapped->lengthInSamples <= 0
+        || !mapped->mapEntireFile())
+        return nullptr;
+
+    return std::unique_ptr<MappedPcmSource>(new MappedPcmSource(std::move(mapped), thread));
+}
+
+MappedPcmSource::MappedPcmSource(std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader,
+    juce::TimeSliceThread& thread)
+    : reader(std::move(mappedReader)),
+    backgroundThread(thread),
+    fileChannels((int)reader->numChannels)
+{
+    bytesPerFrame = juce::jmax(1, fileChannels * (int)reader->bitsPerSample / 8);
+
+    // Only little-endian WAV data is read directly; everything else goes
+    // through the mapped reader.
+    const bool isWav = reader->getFormatName() == "WAV file";
+    const bool isInt16 = !reader->usesFloatingPointData && reader->bitsPerSample == 16;
+    const bool isFloat32 = reader->usesFloatingPointData && reader->bitsPerSample == 32;
+
+    if (isWav && (fileChannels == 1 || fileChannels == 2) && (isInt16 || isFloat32))
+        mapSampleData(isInt16 ? Layout::int16 : Layout::float32);
+}
+
+void MappedPcmSource::mapSampleData(Layout candidate)
+{
+    juce::int64 dataStart = 0, dataLength = 0;
+    const int stride = fileChannels * (candidate == Layout::int16 ? 2 : 4);
+
+    if (!findWavDataChunk(reader->getFile(), dataStart, dataLength)
+        || dataLength < reader->lengthInSamples * stride)
+        return;
+
+    auto map = std::make_unique<juce::MemoryMappedFile>(reader->getFile(),
+        juce::Range<juce::int64>(dataStart, dataStart + reader->lengthInSamples * stride),
+        juce::MemoryMappedFile::readOnly, false);
+
+    if (map->getData() == nullptr)
+        return;
+
+    // The mapping starts on a page boundary at or before the data.
+    const char* data = static_cast<const char*>(map->getData()) + (dataStart - map->getRange().getStart());
+
+    // Check a few frames against the reader's own decoding, so an unusual
+    // header can only cost the fast path, not play noise.
+    for (auto frame : { (juce::int64)0, reader->lengthInSamples / 2, reader->lengthInSamples - 1 })
+    {
+        float expected[2] = {};
+        reader->getSample(frame, expected);
+
+        for (int ch = 0; ch < fileChannels; ++ch)
+        {
+            const char* sample = data + frame * stride + ch * (stride / fileChannels);
+            float actual = 0.0f;
+
+            if (candidate == Layout::int16)
+                actual = (float)(juce::int16)juce::ByteOrder::littleEndianShort(sample) * (1.0f / 32768.0f);
+            else
+                std::memcpy(&actual, sample, sizeof(float));
+
+            if (std::abs(actual - expected[ch]) > 1.0e-6f)
+                return;
+        }
+    }
+
+    sampleMap = std::move(map);
+    frameData = data;
+    bytesPerFrame = stride;
+    layout = candidate;
+}
+
+MappedPcmSource::~MappedPcmSource()
+{
+    releaseResources();
+}
+
+void MappedPcmSource::prepareToPlay(int, double)
+{
+    if (!isPrepared)
+    {
+        isPrepared = true;
+        backgroundThread.addTimeSliceClient(this);
+    }
+}
+
+void MappedPcmSource::releaseResources()
+{
+    if (isPrepared)
+    {
+        isPrepared = false;
+        backgroundThread.removeTimeSliceClient(this);
+    }
+}
+
+void MappedPcmSource::setNextReadPosition(juce::int64 newPosition)
+{
+    position = juce::jmax((juce::int64)0, newPosition);
+}
+
+juce::int64 MappedPcmSource::getNextReadPosition() const
+{
+    const auto length = reader->lengthInSamples;
+    const auto pos = position.load();
+    return (looping.load() && length > 0) ? pos % length : pos;
+}
+
+void MappedPcmSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const auto length = reader->lengthInSamples;
+    const bool shouldLoop = looping.load();
+    const auto start = position.load();
+    auto readPosition = shouldLoop ? start % length : start;
+    int done = 0;
+
+    while (done < bufferToFill.numSamples)
+    {
+        const int numThisTime = readPosition < length
+            ? (int)juce::jmin((juce::int64)(bufferToFill.numSamples - done), length - readPosition)
+            : 0;
+
+        if (numThisTime <= 0)
+        {
+            if (shouldLoop)
+            {
+                readPosition = 0;
+                continue;
+            }
+
+            for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+                bufferToFill.buffer->clear(ch, bufferToFill.startSample + done, bufferToFill.numSamples - done);
+            break;
+        }
+
+        readFrames(readPosition, numThisTime, *bufferToFill.buffer, bufferToFill.startSample + done);
+        done += numThisTime;
+        readPosition += numThisTime;
+    }
+
+    position = start + bufferToFill.numSamples;
+}
+
+void MappedPcmSource::readFrames(juce::int64 startFrame, int numFrames, juce::AudioBuffer<float>& dest, int destStart)
+{
+    const int destChannels = dest.getNumChannels();
+
+    if (layout == Layout::generic || destChannels < 2)
+    {
+        reader->read(&dest, destStart, numFrames, startFrame, true, true);
+        return;
+    }
+
+    const char* source = frameData + startFrame * bytesPerFrame;
+    auto* left = dest.getWritePointer(0, destStart);
+    auto* right = dest.getWritePointer(1, destStart);
+
+    if (layout == Layout::int16)
+    {
+        const auto* pcm = reinterpret_cast<const juce::int16*>(source);
+
+        if (fileChannels == 2)
+            SimdKernels::deinterleaveInt16Stereo(pcm, left, right, numFrames);
+        else
+            SimdKernels::convertInt16(pcm, left, numFrames);
+    }
+    else
+    {
+        const auto* samples = reinterpret_cast<const float*>(source);
+
+        if (fileChannels == 2)
+            SimdKernels::deinterleaveFloatStereo(samples, left, right, numFrames);
+        else
+            juce::FloatVectorOperations::copy(left, samples, numFrames);
+    }
+
+    if (fileChannels == 1)
+        juce::FloatVectorOperations::copy(right, left, numFrames);
+
+    for (int ch = 2; ch < destChannels; ++ch)
+        dest.clear(ch, destStart, numFrames);
+}
+
+void MappedPcmSource::touchRange(juce::int64 startSample, juce::int64 numSamples) const
+{
+    const auto end = juce::jmin(reader->lengthInSamples, startSample + numSamples);
+    const auto step = (juce::int64)juce::jmax(1, pageSize / bytesPerFrame);
+
+    // Touch whichever mapping the audio thread will actually read from.
+    for (auto sample = juce::jmax((juce::int64)0, startSample); sample < end; sample += step)
+    {
+        if (frameData != nullptr)
+            (void)*static_cast<const volatile char*>(frameData + sample * bytesPerFrame);
+        else
+            reader->touchSample(sample);
+    }
+}
+
+int MappedPcmSource::useTimeSlice()
+{
+    const auto length = reader->lengthInSamples;
+    const auto pos = getNextReadPosition();
+    const auto ahead = (juce::int64)(prefetchSeconds * reader->sampleRate);
+
+    // A seek outside the window already touched starts a fresh one.
+    if (pos < touchedStart || pos > touchedEnd)
+        touchedStart = touchedEnd = pos;
+
+    const auto target = pos + ahead;
+    const auto chunkEnd = juce::jmin(target, touchedEnd + ahead / 4);
+
+    if (touchedEnd < chunkEnd)
+    {
+        touchRange(touchedEnd, chunkEnd - touchedEnd);
+
+        if (looping.load() && chunkEnd > length)
+            touchRange(0, chunkEnd - length);
+
+        touchedEnd = chunkEnd;
+    }
+
+    return touchedEnd >= target ? 50 : 1;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Plays an uncompressed WAV or AIFF straight out of a memory-mapped file, so
+// a seek is just a new index and reads make no system calls. Common WAV
+// layouts (16-bit and 32-bit float, mono or stereo) map the data chunk
+// directly and are converted with the SIMD kernels; anything else goes
+// through the mapped reader's own read().
+//
+// The background thread touches the pages just ahead of the play position so
+// page faults land there rather than on the audio thread.
+class MappedPcmSource : public juce::PositionableAudioSource,
+    private juce::TimeSliceClient
+{
+public:
+    // Returns nullptr when the format can't be mapped or the mapping fails.
+    static std::unique_ptr<MappedPcmSource> create(juce::AudioFormatManager& formatManager,
+        const juce::File& file, juce::TimeSliceThread& thread);
+
+    ~MappedPcmSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override { return reader->lengthInSamples; }
+    bool isLooping() const override { return looping; }
+    void setLooping(bool shouldLoop) override { looping = shouldLoop; }
+
+    const juce::AudioFormatReader& getReader() const { return *reader; }
+    void touchRange(juce::int64 startSample, juce::int64 numSamples) const;
+
+private:
+    enum class Layout
+    {
+        int16,
+        float32,
+        generic
+    };
+
+    MappedPcmSource(std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader, juce::TimeSliceThread& thread);
+
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader;
+    std::unique_ptr<juce::MemoryMappedFile> sampleMap;
+    juce::TimeSliceThread& backgroundThread;
+    Layout layout = Layout::generic;
+    const char* frameData = nullptr;
+    int bytesPerFrame = 0;
+    int fileChannels = 0;
+
+    std::atomic<juce::int64> position{ 0 };
+    std::atomic<bool> looping{ false };
+    juce::int64 touchedStart = 0;
+    juce::int64 touchedEnd = 0;
+    bool isPrepared = false;
+
+    void mapSampleData(Layout candidate);
+    void readFrames(juce::int64 startFrame, int numFrames, juce::AudioBuffer<float>& dest, int destStart);
+    int useTimeSlice() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MappedPcmSource)
+};
@@ -0,0 +1,254 @@
+#include "MarkerIndex.h"
+
+void MarkerIndex::clear()
+{
+    nodes.clear();
+    freeNodes.clear();
+    root = -1;
+}
+
+int MarkerIndex::add(const Marker& marker)
+{
+    const int node = createNode(marker, (juce::uint32)random.nextInt());
+
+    int before, after;
+    splitByTime(root, marker.time, true, before, after);
+
+    const int index = sizeOf(before);
+    root = merge(merge(before, node), after);
+    return index;
+}
+
+void MarkerIndex::addAll(juce::Array<Marker> newMarkers)
+{
+    if (newMarkers.isEmpty())
+        return;
+
+    std::stable_sort(newMarkers.begin(), newMarkers.end(),
+        [](const Marker& a, const Marker& b) { return a.time < b.time; });
+
+    juce::Array<Marker> existing;
+    existing.ensureStorageAllocated(size());
+    appendInOrder(root, existing);
+
+    // Existing markers stay ahead of new ones at the same time, as with add().
+    juce::Array<Marker> sorted;
+    sorted.ensureStorageAllocated(existing.size() + newMarkers.size());
+    std::merge(existing.begin(), existing.end(), newMarkers.begin(), newMarkers.end(), std::back_inserter(sorted),
+        [](const Marker& a, const Marker& b) { return a.time < b.time; });
+
+    clear();
+    nodes.reserve((size_t)sorted.size());
+    root = buildBalanced(sorted, 0, sorted.size(), 0);
+}
+
+bool MarkerIndex::remove(int index)
+{
+    if (!juce::isPositiveAndBelow(index, size()))
+        return false;
+
+    int before, rest, node, after;
+    splitByIndex(root, index, before, rest);
+    splitByIndex(rest, 1, node, after);
+
+    nodes[(size_t)node].marker = {};
+    freeNodes.push_back(node);
+
+    root = merge(before, after);
+    return true;
+}
+
+const MarkerIndex::Marker& MarkerIndex::getReference(int index) const
+{
+    jassert(juce::isPositiveAndBelow(index, size()));
+
+    for (int node = root;;)
+    {
+        const auto& n = nodes[(size_t)node];
+        const int leftSize = sizeOf(n.left);
+
+        if (index == leftSize)
+            return n.marker;
+
+        if (index < leftSize)
+        {
+            node = n.left;
+        }
+        else
+        {
+            index -= leftSize + 1;
+            node = n.right;
+        }
+    }
+}
+
+int MarkerIndex::indexAtOrAfter(double time) const
+{
+    int index = 0;
+
+    for (int node = root; node >= 0;)
+    {
+        const auto& n = nodes[(size_t)node];
+
+        if (n.marker.time < time)
+        {
+            index += sizeOf(n.left) + 1;
+            node = n.right;
+        }
+        else
+        {
+            node = n.left;
+        }
+    }
+
+    return index;
+}
+
+int MarkerIndex::indexOfNearest(double time) const
+{
+    if (isEmpty())
+        return -1;
+
+    const int after = indexAtOrAfter(time);
+
+    if (after == 0)
+        return 0;
+
+    if (after == size())
+        return after - 1;
+
+    return time - getReference(after - 1).time <= getReference(after).time - time ? after - 1 : after;
+}
+
+juce::Range<int> MarkerIndex::getIndexRange(double start, double end) const
+{
+    const int first = indexAtOrAfter(start);
+    return { first, juce::jmax(first, indexAtOrAfter(end)) };
+}
+
+void MarkerIndex::update(int node)
+{
+    auto& n = nodes[(size_t)node];
+    n.size = 1 + sizeOf(n.left) + sizeOf(n.right);
+}
+
+int MarkerIndex::createNode(const Marker& marker, juce::uint32 priority)
+{
+    Node node;
+    node.marker = marker;
+    node.priority = priority;
+
+    if (!freeNodes.empty())
+    {
+        const int index = freeNodes.back();
+        freeNodes.pop_back();
+        nodes[(size_t)index] = std::move(node);
+        return index;
+    }
+
+    nodes.push_back(std::move(node));
+    return (int)nodes.size() - 1;
+}
+
+void MarkerIndex::splitByTime(int node, double time, bool includeEqual, int& before, int& after)
+{
+    if (node < 0)
+    {
+        before = after = -1;
+        return;
+    }
+
+    auto& n = nodes[(size_t)node];
+
+    if (n.marker.time < time || (includeEqual && n.marker.time == time))
+    {
+        splitByTime(n.right, time, includeEqual, n.right, after);
+        before = node;
+    }
+    else
+    {
+        splitByTime(n.left, time, includeEqual, before, n.left);
+        after = node;
+    }
+
+    update(node);
+}
+
+void MarkerIndex::splitByIndex(int node, int count, int& before, int& after)
+{
+    if (node < 0)
+    {
+        before = after = -1;
+        return;
+    }
+
+    auto& n = nodes[(size_t)node];
+    const int leftSize = sizeOf(n.left);
+
+    if (count <= leftSize)
+    {
+        splitByIndex(n.left, count, before, n.left);
+        after = node;
+    }
+    else
+    {
+        splitByIndex(n.right, count - leftSize - 1, n.right, after);
+        before = node;
+    }
+
+    update(node);
+}
+
+int MarkerIndex::merge(int before, int after)
+{
+    if (before < 0)
+        return after;
+
+    if (after < 0)
+        return before;
+
+    if (nodes[(size_t)before].priority > nodes[(size_t)after].priority)
+    {
+        nodes[(size_t)before].right = merge(nodes[(size_t)before].right, after);
+        update(before);
+        return before;
+    }
+
+    nodes[(size_t)after].left = merge(before, nodes[(size_t)after].left);
+    update(after);
+    return after;
+}
+
+int MarkerIndex::buildBalanced(const juce::Array<Marker>& sorted, int start, int end, int depth)
+{
+    if (start >= end)
+        return -1;
+
+    // Each level draws its priorities from a band below its parent's, which
+    // keeps the heap order while later inserts still land at random depths.
+    const auto band = (juce::uint32)1 << (31 - juce::jmin(depth, 31));
+    const auto priority = band | ((juce::uint32)random.nextInt() & (band - 1));
+
+    const int middle = start + (end - start) / 2;
+    const int node = createNode(sorted.getReference(middle), priority);
+
+    const int left = buildBalanced(sorted, start, middle, depth + 1);
+    const int right = buildBalanced(sorted, middle + 1, end, depth + 1);
+
+    auto& n = nodes[(size_t)node];
+    n.left = left;
+    n.right = right;
+    update(node);
+    return node;
+}
+
+void MarkerIndex::appendInOrder(int node, juce::Array<Marker>& sorted) const
+{
+    if (node < 0)
+        return;
+
+    const auto& n = nodes[(size_t)node];
+    appendInOrder(n.left, sorted);
+    sorted.add(n.marker);
+    appendInOrder(n.right, sorted);
+}
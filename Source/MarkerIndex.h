@@ -0,0 +1,73 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+// Markers kept in time order in a treap whose nodes also count their
+// subtrees, so inserting, removing, finding the n-th marker and finding
+// where a time falls are all O(log n). That keeps a list row, a waveform
+// column or a "nearest marker" lookup cheap with 100k markers loaded.
+// Markers at the same time keep the order they were added in.
+class MarkerIndex
+{
+public:
+    struct Marker
+    {
+        double time = 0.0;
+        juce::String name;
+    };
+
+    int size() const { return sizeOf(root); }
+    bool isEmpty() const { return root < 0; }
+    void clear();
+
+    // Returns the index the marker ended up at.
+    int add(const Marker& marker);
+
+    // Adds many at once in O(n + m log m), rebuilding the tree in a single
+    // pass instead of m separate inserts.
+    void addAll(juce::Array<Marker> newMarkers);
+
+    bool remove(int index);
+
+    // The index must be in range.
+    const Marker& getReference(int index) const;
+
+    // Index of the first marker at or after time; size() if there is none.
+    int indexAtOrAfter(double time) const;
+
+    // Index of the marker closest to time, or -1 when empty.
+    int indexOfNearest(double time) const;
+
+    // The markers in [start, end), as a range of indices.
+    juce::Range<int> getIndexRange(double start, double end) const;
+
+private:
+    struct Node
+    {
+        Marker marker;
+        juce::uint32 priority = 0;
+        int left = -1;
+        int right = -1;
+        int size = 1;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<int> freeNodes;
+    int root = -1;
+    juce::Random random;
+
+    int sizeOf(int node) const { return node < 0 ? 0 : nodes[(size_t)node].size; }
+    void update(int node);
+    int createNode(const Marker& marker, juce::uint32 priority);
+
+    // Splits a subtree into the markers before time (or at it, when
+    // includeEqual is set) and the rest.
+    void splitByTime(int node, double time, bool includeEqual, int& before, int& after);
+    void splitByIndex(int node, int count, int& before, int& after);
+    int merge(int before, int after);
+
+    int buildBalanced(const juce::Array<Marker>& sorted, int start, int end, int depth);
+    void appendInOrder(int node, juce::Array<Marker>& sorted) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MarkerIndex)
+};
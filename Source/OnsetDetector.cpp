@@ -0,0 +1,187 @@
+#include "OnsetDetector.h"
+#include "SidecarCache.h"
+#include "SimdKernels.h"
+
+namespace
+{
+    // Bump when the detector changes, so old results get re-analysed.
+    constexpr int cacheVersion = 1;
+
+    constexpr double targetRate = 11025.0;
+
+    // In frames of hopSize at about 11 kHz, each close to 12 ms.
+    constexpr int maxWindowBefore = 3;
+    constexpr int maxWindowAfter = 3;
+    constexpr int meanWindowBefore = 10;
+    constexpr int meanWindowAfter = 3;
+    constexpr int framesAfterNeeded = juce::jmax(maxWindowAfter, meanWindowAfter);
+    constexpr int minimumGap = 4;
+
+    // A peak must beat its neighbourhood by this much, and clear a floor set
+    // by the track's overall activity so noise in quiet passages stays out.
+    constexpr float localThreshold = 1.4f;
+    constexpr float globalThreshold = 0.3f;
+}
+
+OnsetDetector::OnsetDetector(double sampleRate, bool padStart)
+    : decimation(getDecimation(sampleRate)),
+    analysisRate(sampleRate / decimation),
+    frame(frameSize, true),
+    window(frameSize),
+    windowed(frameSize),
+    spectrum(2 * numBins),
+    magnitudes(numBins, true),
+    previousMagnitudes(numBins, true)
+{
+    for (int i = 0; i < frameSize; ++i)
+        window[i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float)i / (float)frameSize);
+
+    // Half a frame of silence in front puts frame n's centre at n * hopSize.
+    if (padStart)
+        frameFill = frameSize / 2;
+}
+
+int OnsetDetector::getDecimation(double sampleRate)
+{
+    return juce::jmax(1, juce::roundToInt(sampleRate / targetRate));
+}
+
+juce::int64 OnsetDetector::getFrameStartSample(double sampleRate, juce::int64 frameIndex)
+{
+    return (frameIndex * hopSize - (1 << fftOrder) / 2) * getDecimation(sampleRate);
+}
+
+juce::int64 OnsetDetector::getFrameEndSample(double sampleRate, juce::int64 frameIndex)
+{
+    return getFrameStartSample(sampleRate, frameIndex) + (juce::int64)(1 << fftOrder) * getDecimation(sampleRate);
+}
+
+void OnsetDetector::process(const float* samples, int numSamples, juce::Array<double>& onsets)
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        decimationSum += samples[i];
+
+        if (++decimationCount < decimation)
+            continue;
+
+        frame[frameFill++] = decimationSum / (float)decimation;
+        decimationSum = 0.0f;
+        decimationCount = 0;
+
+        if (frameFill == frameSize)
+        {
+            analyseFrame();
+            std::memmove(frame.get(), frame.get() + hopSize, sizeof(float) * (size_t)(frameSize - hopSize));
+            frameFill -= hopSize;
+        }
+    }
+
+    pickPeaks(flux.size() - framesAfterNeeded, onsets);
+}
+
+void OnsetDetector::finish(juce::Array<double>& onsets)
+{
+    // Run the last real samples through to the centre of a frame.
+    for (int remaining = frameSize / 2; remaining > 0;)
+    {
+        const int numThisTime = juce::jmin(remaining, frameSize - frameFill);
+        juce::FloatVectorOperations::clear(frame + frameFill, numThisTime);
+        frameFill += numThisTime;
+        remaining -= numThisTime;
+
+        if (frameFill == frameSize)
+        {
+            analyseFrame();
+            std::memmove(frame.get(), frame.get() + hopSize, sizeof(float) * (size_t)(frameSize - hopSize));
+            frameFill -= hopSize;
+        }
+    }
+
+    pickPeaks(flux.size(), onsets);
+}
+
+void OnsetDetector::analyseFrame()
+{
+    juce::FloatVectorOperations::multiply(windowed, frame, window, frameSize);
+    fft.perform(windowed, spectrum);
+    SimdKernels::compressedMagnitudes(spectrum, magnitudes, numBins);
+
+    const float value = SimdKernels::positiveDifferenceSum(magnitudes, previousMagnitudes, numBins);
+    magnitudes.swapWith(previousMagnitudes);
+
+    flux.add(value);
+    fluxTotal += value;
+}
+
+void OnsetDetector::pickPeaks(int endFrame, juce::Array<double>& onsets)
+{
+    const int numFrames = flux.size();
+    const float* values = flux.begin();
+    const float floor = globalThreshold * (float)(fluxTotal / juce::jmax(1, numFrames));
+
+    for (int n = nextFrameToPick; n < endFrame; ++n)
+    {
+        const float value = values[n];
+
+        if (value <= floor || n - lastOnsetFrame < minimumGap)
+            continue;
+
+        bool isPeak = true;
+        for (int k = juce::jmax(0, n - maxWindowBefore); k <= juce::jmin(numFrames - 1, n + maxWindowAfter) && isPeak; ++k)
+            isPeak = values[k] <= value;
+
+        if (!isPeak)
+            continue;
+
+        const int meanStart = juce::jmax(0, n - meanWindowBefore);
+        const int meanEnd = juce::jmin(numFrames, n + meanWindowAfter + 1);
+        float sum = 0.0f;
+
+        for (int k = meanStart; k < meanEnd; ++k)
+            sum += values[k];
+
+        if (value >= localThreshold * sum / (float)(meanEnd - meanStart))
+        {
+            onsets.add((double)n * hopSize / analysisRate);
+            lastOnsetFrame = n;
+        }
+    }
+
+    nextFrameToPick = juce::jmax(nextFrameToPick, endFrame);
+}
+
+bool OnsetDetector::loadFromCache(const juce::File& file, juce::Array<double>& onsets)
+{
+    juce::MemoryBlock data;
+    if (!SidecarCache::load(file, "onsets", data))
+        return false;
+
+    juce::MemoryInputStream in(data, false);
+
+    if (in.readInt() != cacheVersion)
+        return false;
+
+    const int numOnsets = in.readInt();
+    if (numOnsets < 0 || (juce::int64)numOnsets * 8 > in.getNumBytesRemaining())
+        return false;
+
+    onsets.ensureStorageAllocated(onsets.size() + numOnsets);
+
+    for (int i = 0; i < numOnsets; ++i)
+        onsets.add(in.readDouble());
+
+    return true;
+}
+
+void OnsetDetector::saveToCache(const juce::File& file, const juce::Array<double>& onsets)
+{
+    juce::MemoryOutputStream out;
+    out.writeInt(cacheVersion);
+    out.writeInt(onsets.size());
+
+    for (auto time : onsets)
+        out.writeDouble(time);
+
+    SidecarCache::save(file, "onsets", out.getMemoryBlock());
+}
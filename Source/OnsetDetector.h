@@ -0,0 +1,66 @@
+#pragma once
+#include <JuceHeader.h>
+#include "RealFft.h"
+
+// Finds note and drum onsets by spectral flux: how much the compressed
+// magnitude spectrum rises from one short frame to the next. Peaks in the
+// flux that stand out from their neighbourhood are reported as onsets.
+//
+// Audio is fed in as it is decoded and onsets come out as soon as the frames
+// after them have been seen, so a caller can publish them progressively. The
+// input is averaged down to about 11 kHz first; that keeps the attacks and
+// makes a long track cheap to analyse.
+class OnsetDetector
+{
+public:
+    static constexpr int fftOrder = 9;
+    static constexpr int hopSize = 128;
+
+    // Without padStart the first frame starts, rather than centres, on the
+    // first sample fed in; that is for picking up part way through a track.
+    explicit OnsetDetector(double sampleRate, bool padStart = true);
+
+    // Mono samples at the source rate. Onset times, in seconds from the
+    // first sample fed in, are appended to onsets.
+    void process(const float* samples, int numSamples, juce::Array<double>& onsets);
+
+    // Reports the onsets still waiting for frames after them.
+    void finish(juce::Array<double>& onsets);
+
+    // The onset strength, one value per hop, for tempo analysis.
+    const juce::Array<float>& getFlux() const { return flux; }
+    double getFrameRate() const { return analysisRate / hopSize; }
+
+    // Where a detector without padStart must be fed from, in source samples,
+    // for its first frame to line up with the given frame of a padded run.
+    static juce::int64 getFrameStartSample(double sampleRate, juce::int64 frameIndex);
+    static juce::int64 getFrameEndSample(double sampleRate, juce::int64 frameIndex);
+    static int getDecimation(double sampleRate);
+
+    // Results for a file, kept with the other per-file analysis.
+    static bool loadFromCache(const juce::File& file, juce::Array<double>& onsets);
+    static void saveToCache(const juce::File& file, const juce::Array<double>& onsets);
+
+private:
+    RealFft fft{ fftOrder };
+    const int frameSize = 1 << fftOrder;
+    const int numBins = frameSize / 2 + 1;
+
+    int decimation = 1;
+    double analysisRate = 0.0;
+    float decimationSum = 0.0f;
+    int decimationCount = 0;
+
+    juce::HeapBlock<float> frame, window, windowed, spectrum, magnitudes, previousMagnitudes;
+    int frameFill = 0;
+
+    juce::Array<float> flux;
+    double fluxTotal = 0.0;
+    int nextFrameToPick = 0;
+    int lastOnsetFrame = -1000000;
+
+    void analyseFrame();
+    void pickPeaks(int endFrame, juce::Array<double>& onsets);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OnsetDetector)
+};
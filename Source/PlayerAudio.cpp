@@ -1,97 +1,1332 @@
 #include "PlayerAudio.h"
+#include "OnsetDetector.h"
+
+class PlayerAudio::LoadJob : public juce::ThreadPoolJob
+{
+public:
+    LoadJob(PlayerAudio& ownerToUse, const juce::File& fileToLoad, int generationToUse, bool isQueuedLoad,
+        bool shouldLoop, bool shouldMapFile, double readAheadSecondsToUse, int blockSizeToUse,
+        std::function<void(bool)> callback)
+        : juce::ThreadPoolJob("Load " + fileToLoad.getFileName()),
+        owner(ownerToUse),
+        file(fileToLoad),
+        generation(generationToUse),
+        queued(isQueuedLoad),
+        looping(shouldLoop),
+        mapFile(shouldMapFile),
+        readAheadSeconds(readAheadSecondsToUse),
+        blockSize(blockSizeToUse),
+        onLoaded(std::move(callback))
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        auto result = std::make_unique<LoadResult>();
+        result->generation = generation;
+        result->onLoaded = std::move(onLoaded);
+        result->queued = queued;
+        result->stream = openStream(result->metadata);
+
+        if (!shouldExit())
+            owner.loadFinished(std::move(result));
+
+        return jobHasFinished;
+    }
+
+private:
+    PlayerAudio& owner;
+    const juce::File file;
+    const int generation;
+    const bool queued;
+    const bool looping;
+    const bool mapFile;
+    const double readAheadSeconds;
+    const int blockSize;
+    std::function<void(bool)> onLoaded;
+
+    std::unique_ptr<DeckStream> openStream(Metadata& metadata)
+    {
+        constexpr double preRollSeconds = 0.25;
+        constexpr int preRollTimeoutMs = 1000;
+
+        IndexedSeekReader* seekReader = nullptr;
+        std::unique_ptr<juce::AudioFormatReader> reader(owner.createDeckReader(file, &seekReader));
+        if (reader == nullptr || reader->sampleRate <= 0.0 || shouldExit())
+            return nullptr;
+
+        metadata = extractMetadata(reader.get(), file);
+
+        auto stream = std::make_unique<DeckStream>();
+        stream->file = file;
+        stream->sampleRate = reader->sampleRate;
+        stream->lengthInSamples = reader->lengthInSamples;
+
+        // Uncompressed files play straight from a mapping: no read-ahead buffer
+        // and no I/O on seeks. Pre-rolling is just faulting in the first pages.
+        std::unique_ptr<MappedPcmSource> mapped;
+        if (mapFile)
+            mapped = MappedPcmSource::create(owner.formatManager, file, *owner.readAheadThread);
+
+        if (mapped != nullptr && mapped->getTotalLength() == stream->lengthInSamples)
+        {
+            reader.reset();
+            mapped->setLooping(looping);
+            mapped->touchRange(0, (juce::int64)(preRollSeconds * stream->sampleRate));
+            stream->segmentLoopSource = std::make_unique<SegmentLoopSource>(mapped.get());
+            stream->fileSource = std::move(mapped);
+            stream->segmentLoopSource->prepareToPlay(blockSize, stream->sampleRate);
+            return stream;
+        }
+
+        const int numChannels = juce::jmax(2, (int)reader->numChannels);
+        const int bufferSize = juce::roundToInt(readAheadSeconds * stream->sampleRate);
+
+        stream->seekReader = seekReader;
+        stream->fileSource = std::make_unique<juce::AudioFormatReaderSource>(reader.release(), true);
+        stream->fileSource->setLooping(looping);
+        stream->readAheadSource = std::make_unique<ReadAheadSource>(stream->fileSource.get(), false,
+            *owner.readAheadThread, numChannels, bufferSize);
+        stream->segmentLoopSource = std::make_unique<SegmentLoopSource>(stream->readAheadSource.get());
+        stream->segmentLoopSource->prepareToPlay(blockSize, stream->sampleRate);
+
+        const int preRollSamples = (int)juce::jmin((juce::int64)(preRollSeconds * stream->sampleRate),
+            stream->lengthInSamples, (juce::int64)bufferSize / 2);
+        const auto deadline = juce::Time::getMillisecondCounter() + (juce::uint32)preRollTimeoutMs;
+
+        while (!shouldExit() && juce::Time::getMillisecondCounter() < deadline)
+            if (stream->readAheadSource->waitForBufferedSamples(preRollSamples, 20))
+                break;
+
+        return stream;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoadJob)
+};
+
+// Scans a compressed file for frame offsets once, after it has started
+// playing, and stores the result next to the other cached analysis.
+class PlayerAudio::SeekIndexJob : public juce::ThreadPoolJob
+{
+public:
+    SeekIndexJob(PlayerAudio& ownerToUse, const juce::File& fileToIndex, int generationToUse)
+        : juce::ThreadPoolJob("Index " + fileToIndex.getFileName()),
+        owner(ownerToUse),
+        file(fileToIndex),
+        generation(generationToUse)
+    {
+    }
+
+    const juce::File& getFile() const { return file; }
+    int getGeneration() const { return generation; }
+
+    JobStatus runJob() override
+    {
+        std::shared_ptr<const SeekIndex> index = SeekIndex::build(file, [this] { return shouldExit(); });
+
+        if (index != nullptr && !shouldExit())
+        {
+            index->saveToCache(file);
+            owner.seekIndexFinished(generation, file, std::move(index));
+        }
+
+        return jobHasFinished;
+    }
+
+private:
+    PlayerAudio& owner;
+    const juce::File file;
+    const int generation;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SeekIndexJob)
+};
+
+// Analyses the current track after it has loaded. One decode feeds
+// everything that isn't already cached: the waveform pyramid, the loudness
+// and the onsets, handed over a batch at a time so they appear while the
+// rest is still analysed, whose strength envelope then gives the beat grid.
+class PlayerAudio::TrackAnalysisJob : public juce::ThreadPoolJob
+{
+public:
+    struct Request
+    {
+        juce::File file;
+        bool reportOnsets = false;
+        bool buildWaveform = false;
+        bool measureLoudness = false;
+        int onsetGeneration = 0;
+        int beatGeneration = 0;
+        int waveformGeneration = 0;
+    };
+
+    TrackAnalysisJob(PlayerAudio& ownerToUse, const Request& requestToRun)
+        : juce::ThreadPoolJob("Analysis " + requestToRun.file.getFileName()),
+        owner(ownerToUse),
+        request(requestToRun)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        const auto& file = request.file;
+        juce::Array<double> onsets;
+        BeatGrid grid;
+        LoudnessMeter::Result loudness;
+
+        const bool haveOnsets = OnsetDetector::loadFromCache(file, onsets);
+        const bool haveGrid = BeatGrid::loadFromCache(file, grid);
+        const bool haveLoudness = !request.measureLoudness || LoudnessMeter::loadFromCache(file, loudness);
+        auto pyramid = request.buildWaveform ? WaveformPyramid::loadFromCache(file) : nullptr;
+        const bool havePyramid = !request.buildWaveform || pyramid != nullptr;
+
+        if (haveOnsets && request.reportOnsets)
+            owner.onsetsFound(request.onsetGeneration, std::move(onsets));
+
+        if (haveGrid)
+            owner.beatGridFound(request.beatGeneration, grid);
+
+        if (request.measureLoudness && haveLoudness)
+            owner.loudnessMeasured(file, loudness);
+
+        if (request.buildWaveform && havePyramid)
+            owner.waveformBuilt(request.waveformGeneration, std::move(pyramid));
+
+        const bool needDetector = !haveGrid || (request.reportOnsets && !haveOnsets);
+
+        if (!needDetector && haveLoudness && havePyramid)
+            return jobHasFinished;
+
+        std::unique_ptr<juce::AudioFormatReader> reader(owner.createWholeTrackReader(file));
+        if (reader == nullptr || reader->sampleRate <= 0.0)
+            return jobHasFinished;
+
+        constexpr int chunkSize = 65536;
+        constexpr double batchSeconds = 20.0;
+
+        // Onsets that came from the cache are still found, to keep the
+        // envelope going, but not handed over a second time.
+        const bool publishOnsets = request.reportOnsets && !haveOnsets;
+
+        const int numChannels = juce::jlimit(1, 2, (int)reader->numChannels);
+        std::unique_ptr<OnsetDetector> detector;
+        std::unique_ptr<LoudnessMeter> meter;
+        std::shared_ptr<WaveformPyramid> newPyramid;
+
+        if (needDetector)
+            detector = std::make_unique<OnsetDetector>(reader->sampleRate);
+
+        if (!haveLoudness)
+            meter = std::make_unique<LoudnessMeter>(reader->sampleRate, numChannels);
+
+        if (!havePyramid)
+            newPyramid = std::make_shared<WaveformPyramid>(reader->sampleRate, reader->lengthInSamples);
+
+        juce::AudioBuffer<float> buffer(numChannels, chunkSize);
+        juce::Array<double> allOnsets;
+        const auto batchSamples = (juce::int64)(batchSeconds * reader->sampleRate);
+        auto nextBatch = batchSamples;
+
+        onsets.clearQuick();
+
+        for (juce::int64 position = 0; position < reader->lengthInSamples;)
+        {
+            if (shouldExit())
+                return jobHasFinished;
+
+            const int numThisTime = (int)juce::jmin((juce::int64)chunkSize, reader->lengthInSamples - position);
+            if (!reader->read(&buffer, 0, numThisTime, position, true, true))
+                return jobHasFinished;
+
+            position += numThisTime;
+
+            if (newPyramid != nullptr)
+                newPyramid->addSamples(buffer, numThisTime);
+
+            if (meter != nullptr)
+                meter->process(buffer, numThisTime);
+
+            if (detector == nullptr)
+                continue;
+
+            // The detector takes mono, folded into the first channel last of all.
+            if (numChannels > 1)
+                buffer.addFrom(0, 0, buffer, 1, 0, numThisTime);
+
+            detector->process(buffer.getReadPointer(0), numThisTime, onsets);
+
+            if (position >= nextBatch && !onsets.isEmpty())
+            {
+                allOnsets.addArray(onsets);
+
+                if (publishOnsets)
+                    owner.onsetsFound(request.onsetGeneration, std::move(onsets));
+
+                onsets.clearQuick();
+                nextBatch = position + batchSamples;
+            }
+        }
+
+        if (newPyramid != nullptr)
+        {
+            newPyramid->finish();
+            newPyramid->saveToCache(file);
+            owner.waveformBuilt(request.waveformGeneration, std::move(newPyramid));
+        }
+
+        if (meter != nullptr)
+        {
+            loudness = meter->getResult();
+            LoudnessMeter::saveToCache(file, loudness);
+            owner.loudnessMeasured(file, loudness);
+        }
+
+        if (detector == nullptr)
+            return jobHasFinished;
+
+        detector->finish(onsets);
+        allOnsets.addArray(onsets);
+
+        if (!haveOnsets)
+            OnsetDetector::saveToCache(file, allOnsets);
+
+        if (publishOnsets && !onsets.isEmpty())
+            owner.onsetsFound(request.onsetGeneration, std::move(onsets));
+
+        if (!haveGrid)
+        {
+            const auto& flux = detector->getFlux();
+            grid = BeatGrid::estimate(flux.begin(), flux.size(), detector->getFrameRate());
+            BeatGrid::saveToCache(file, grid);
+            owner.beatGridFound(request.beatGeneration, grid);
+        }
+
+        return jobHasFinished;
+    }
+
+private:
+    PlayerAudio& owner;
+    const Request request;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackAnalysisJob)
+};
+
+// Measures a queued file's loudness for normalisation. The current track's
+// comes from its analysis pass instead.
+class PlayerAudio::LoudnessJob : public juce::ThreadPoolJob
+{
+public:
+    LoudnessJob(PlayerAudio& ownerToUse, const juce::File& fileToMeasure)
+        : juce::ThreadPoolJob("Loudness " + fileToMeasure.getFileName()),
+        owner(ownerToUse),
+        file(fileToMeasure)
+    {
+    }
+
+    const juce::File& getFile() const { return file; }
+
+    JobStatus runJob() override
+    {
+        LoudnessMeter::Result result;
+
+        if (LoudnessMeter::loadFromCache(file, result))
+        {
+            owner.loudnessMeasured(file, result);
+            return jobHasFinished;
+        }
+
+        std::unique_ptr<juce::AudioFormatReader> reader(owner.createWholeTrackReader(file));
+        if (reader == nullptr || reader->sampleRate <= 0.0)
+            return jobHasFinished;
+
+        constexpr int chunkSize = 65536;
+        const int numChannels = juce::jlimit(1, 2, (int)reader->numChannels);
+        LoudnessMeter meter(reader->sampleRate, numChannels);
+        juce::AudioBuffer<float> buffer(numChannels, chunkSize);
+
+        for (juce::int64 position = 0; position < reader->lengthInSamples;)
+        {
+            if (shouldExit())
+                return jobHasFinished;
+
+            const int numThisTime = (int)juce::jmin((juce::int64)chunkSize, reader->lengthInSamples - position);
+            if (!reader->read(&buffer, 0, numThisTime, position, true, true))
+                return jobHasFinished;
+
+            meter.process(buffer, numThisTime);
+            position += numThisTime;
+        }
+
+        result = meter.getResult();
+        LoudnessMeter::saveToCache(file, result);
+        owner.loudnessMeasured(file, result);
+        return jobHasFinished;
+    }
+
+private:
+    PlayerAudio& owner;
+    const juce::File file;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoudnessJob)
+};
+
+class PlayerAudio::LoopRegionJob : public juce::ThreadPoolJob
+{
+public:
+    LoopRegionJob(PlayerAudio& ownerToUse, const juce::File& fileToRead, juce::int64 startSample,
+        juce::int64 endSample, int fadeSamples, int serialToUse)
+        : juce::ThreadPoolJob("Loop region " + fileToRead.getFileName()),
+        owner(ownerToUse),
+        file(fileToRead),
+        start(startSample),
+        end(endSample),
+        fadeLength(fadeSamples),
+        serial(serialToUse)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        // Loops up to this long are held whole; longer ones keep just enough
+        // of their start to cover the input's seek back to A.
+        constexpr double maxWholeLoopSeconds = 30.0;
+        constexpr double preRollSeconds = 4.0;
+
+        // A separate reader keeps this off the stream that the read-ahead thread is using.
+        std::unique_ptr<juce::AudioFormatReader> reader(owner.createDeckReader(file));
+        if (reader == nullptr || reader->sampleRate <= 0.0 || shouldExit())
+            return jobHasFinished;
+
+        const auto length = end - start;
+        const auto headLength = length <= (juce::int64)(maxWholeLoopSeconds * reader->sampleRate)
+            ? length
+            : (juce::int64)(preRollSeconds * reader->sampleRate);
+
+        auto region = std::make_unique<LoopRegion>();
+        region->start = start;
+        region->end = end;
+        region->serial = serial;
+
+        const int numChannels = juce::jmax(2, (int)reader->numChannels);
+        region->head.setSize(numChannels, (int)headLength);
+
+        if (!reader->read(&region->head, 0, (int)headLength, start, true, true))
+            return jobHasFinished;
+
+        const auto tailLength = (int)juce::jmin((juce::int64)fadeLength, reader->lengthInSamples - end, length / 2);
+
+        if (tailLength > 0)
+        {
+            region->tail.setSize(numChannels, tailLength);
+
+            if (!reader->read(&region->tail, 0, tailLength, end, true, true))
+                region->tail.setSize(numChannels, 0);
+        }
+
+        if (!shouldExit())
+            owner.loopRegionBuilt(std::move(region));
+
+        return jobHasFinished;
+    }
+
+private:
+    PlayerAudio& owner;
+    const juce::File file;
+    const juce::int64 start, end;
+    const int fadeLength;
+    const int serial;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoopRegionJob)
+};
 
 PlayerAudio::PlayerAudio()
 {
-    formatManager.registerBasicFormats();
-    resampleSource.prepareToPlay(512, 44100.0);
+    formatManager.registerBasicFormats();
+
+    // A gapless splice to a file at another rate: the time-stretch carries on
+    // through it, and the resampler's ratio steps where the new file's first
+    // sample reaches it rather than at the start of the block.
+    deckTransport.onStreamSpliced = [this](int offsetInBlock)
+    {
+        timeStretch.setSourceSampleRateAtInput(deckTransport.getStream()->sampleRate, offsetInBlock);
+    };
+
+    timeStretch.onSourceRateChanged = [this](double newSampleRate, int offsetInBlock)
+    {
+        resampledSourceRate = newSampleRate;
+        resampleSource.setResamplingRatioAtInput(getResamplingRatio(), offsetInBlock);
+    };
+}
+
+PlayerAudio::~PlayerAudio()
+{
+    cancelPendingLoad();
+
+    // Every job reports back into members declared after its list, so they
+    // all stop here rather than in the lists' destructors.
+    loadJobs.removeAll();
+    indexJobs.removeAll();
+    loopRegionJobs.removeAll();
+    regionExportJobs.removeAll();
+    analysisJobs.removeAll();
+    loudnessJobs.removeAll();
+
+    if (sliceExportJob != nullptr)
+        exportPool->removeJob(sliceExportJob.get(), true, 10000);
+
+    sliceExportJob.reset();
+    cancelPendingUpdate();
+    stopTimer();
+
+    deckTransport.setStream(nullptr);
+    streams.clear();
+}
+
+void PlayerAudio::loadFileAsync(const juce::File& audioFile, std::function<void(bool)> onLoaded)
+{
+    if (!isValidAudioFile(audioFile))
+    {
+        if (onLoaded != nullptr)
+            onLoaded(false);
+        return;
+    }
+
+    cancelPendingLoad();
+
+    loadJobs.add(new LoadJob(*this, audioFile, loadGeneration.load(), false, isLooping,
+        memoryMappedPlayback, readAheadSeconds, juce::jmax(512, deviceBlockSize.load()), std::move(onLoaded)));
+}
+
+void PlayerAudio::queueNextFile(const juce::File& audioFile)
+{
+    clearQueuedFile();
+
+    if (!isValidAudioFile(audioFile))
+        return;
+
+    loadJobs.add(new LoadJob(*this, audioFile, queueGeneration.load(), true, isLooping,
+        memoryMappedPlayback, readAheadSeconds, juce::jmax(512, deviceBlockSize.load()), nullptr));
+}
+
+void PlayerAudio::clearQueuedFile()
+{
+    ++queueGeneration;
+
+    // The dequeued stream stays in `streams` and is freed by the usual
+    // serial check once a later stream has been applied.
+    if (queuedStreamSerial != 0)
+        pushQueuedStream(nullptr, 0);
+
+    queuedFile = juce::File();
+    queuedStreamSerial = 0;
+}
+
+void PlayerAudio::pushQueuedStream(DeckStream* stream, int serial)
+{
+    DeckCommand command;
+    command.type = DeckCommand::Type::queueStream;
+    command.serial = serial;
+    command.stream = stream;
+    sendCommand(command);
+}
+
+void PlayerAudio::cancelPendingLoad()
+{
+    // Loading a new file also invalidates whatever was queued behind the old one.
+    ++loadGeneration;
+    clearQueuedFile();
+
+    loadJobs.interruptAll();
+}
+
+void PlayerAudio::startSeekIndexJob(const DeckStream& stream)
+{
+    // Indexes for tracks that are no longer loaded or queued aren't worth finishing.
+    for (auto* job : indexJobs)
+        if (job->getGeneration() != indexGeneration)
+            job->signalJobShouldExit();
+
+    if (stream.seekReader == nullptr || stream.seekReader->hasIndex())
+        return;
+
+    for (auto* job : indexJobs)
+        if (job->getFile() == stream.file && !job->shouldExit())
+            return;
+
+    indexJobs.add(new SeekIndexJob(*this, stream.file, indexGeneration));
+}
+
+void PlayerAudio::seekIndexFinished(int generation, const juce::File& file, std::shared_ptr<const SeekIndex> index)
+{
+    // Called on the worker thread.
+    {
+        const juce::ScopedLock sl(loadResultLock);
+        completedIndexes.add({ generation, file, std::move(index) });
+    }
+
+    triggerAsyncUpdate();
+}
+
+void PlayerAudio::startTrackAnalysis()
+{
+    // Results still on their way from an earlier track are dropped by generation.
+    analysisJobs.signalAll();
+    clearOnsetMarkers();
+    ++beatGeneration;
+
+    if (currentFile == juce::File())
+        return;
+
+    TrackAnalysisJob::Request request;
+    request.file = currentFile;
+    request.reportOnsets = autoOnsetMarkers;
+    request.onsetGeneration = onsetGeneration;
+    request.beatGeneration = beatGeneration;
+
+    // A pass restarted for the same track keeps the pyramid it already has.
+    request.buildWaveform = waveform == nullptr;
+    request.waveformGeneration = waveformGeneration;
+
+    // A track that was measured while it was queued isn't measured again.
+    loudnessJobs.removeFinished();
+    request.measureLoudness = true;
+
+    for (auto* stream : streams)
+        if (stream->file == currentFile && stream->loudnessMeasured)
+            request.measureLoudness = false;
+
+    for (auto* job : loudnessJobs)
+        if (job->getFile() == currentFile && !job->shouldExit())
+            request.measureLoudness = false;
+
+    analysisJobs.add(new TrackAnalysisJob(*this, request));
+}
+
+void PlayerAudio::clearWaveform()
+{
+    ++waveformGeneration;
+    waveform.reset();
+}
+
+void PlayerAudio::clearOnsetMarkers()
+{
+    ++onsetGeneration;
+
+    if (!onsetMarkers.isEmpty())
+    {
+        onsetMarkers.clear();
+        sendChangeMessage();
+    }
+}
+
+void PlayerAudio::onsetsFound(int generation, juce::Array<double> onsets)
+{
+    // Called on the worker thread.
+    {
+        const juce::ScopedLock sl(loadResultLock);
+        completedOnsets.add({ generation, std::move(onsets) });
+    }
+
+    triggerAsyncUpdate();
+}
+
+void PlayerAudio::addOnsetMarkers(const juce::Array<OnsetResult>& results)
+{
+    juce::Array<Marker> newMarkers;
+
+    for (const auto& result : results)
+    {
+        if (result.generation != onsetGeneration)
+            continue;
+
+        for (auto time : result.onsets)
+            newMarkers.add({ time, {} });
+    }
+
+    if (!newMarkers.isEmpty())
+    {
+        onsetMarkers.addAll(newMarkers);
+        sendChangeMessage();
+    }
+}
+
+void PlayerAudio::beatGridFound(int generation, const BeatGrid& grid)
+{
+    // Called on the worker thread.
+    {
+        const juce::ScopedLock sl(loadResultLock);
+        completedBeatGrids.add({ generation, grid });
+    }
+
+    triggerAsyncUpdate();
+}
+
+void PlayerAudio::waveformBuilt(int generation, std::shared_ptr<const WaveformPyramid> newWaveform)
+{
+    // Called on the worker thread.
+    {
+        const juce::ScopedLock sl(loadResultLock);
+        completedWaveforms.add({ generation, std::move(newWaveform) });
+    }
+
+    triggerAsyncUpdate();
+}
+
+void PlayerAudio::startLoudnessJob(const DeckStream& stream)
+{
+    // Files that are neither playing nor queued any more aren't worth finishing.
+    for (auto* job : loudnessJobs)
+        if (job->getFile() != currentFile && job->getFile() != queuedFile)
+            job->signalJobShouldExit();
+
+    // A finished job for this file must not stop it being measured again.
+    loudnessJobs.removeFinished();
+
+    for (auto* job : loudnessJobs)
+        if (job->getFile() == stream.file && !job->shouldExit())
+            return;
+
+    loudnessJobs.add(new LoudnessJob(*this, stream.file));
+}
+
+void PlayerAudio::loudnessMeasured(const juce::File& file, const LoudnessMeter::Result& loudness)
+{
+    // Called on the worker thread.
+    {
+        const juce::ScopedLock sl(loadResultLock);
+        completedLoudness.add({ file, loudness });
+    }
+
+    triggerAsyncUpdate();
+}
+
+void PlayerAudio::applyLoudnessResults(const juce::Array<LoudnessResult>& results)
+{
+    for (const auto& result : results)
+    {
+        for (auto* stream : streams)
+        {
+            if (stream->file == result.file)
+            {
+                stream->loudness = result.loudness;
+                stream->loudnessMeasured = true;
+                updateNormalisationGain(*stream);
+            }
+        }
+
+        if (result.file == queuedFile)
+            queuedMetadata.loudness = result.loudness;
+
+        if (result.file == currentFile)
+        {
+            metadata.loudness = result.loudness;
+            sendChangeMessage();
+        }
+    }
+}
+
+void PlayerAudio::updateNormalisationGain(DeckStream& stream)
+{
+    if (!normaliseLoudness)
+        stream.normalisationGain = 1.0f;
+    else if (!stream.loudnessMeasured)
+        stream.normalisationGain = LoudnessMeter::getProvisionalGain(targetLoudness);
+    else
+        stream.normalisationGain = LoudnessMeter::getNormalisationGain(stream.loudness, targetLoudness);
+}
+
+void PlayerAudio::setLoudnessNormalisation(bool shouldNormalise)
+{
+    normaliseLoudness = shouldNormalise;
+
+    for (auto* stream : streams)
+        updateNormalisationGain(*stream);
+}
+
+void PlayerAudio::setTargetLoudness(double lufs)
+{
+    targetLoudness = juce::jlimit(-40.0, 0.0, lufs);
+
+    for (auto* stream : streams)
+        updateNormalisationGain(*stream);
+}
+
+void PlayerAudio::setAutoOnsetMarkers(bool shouldDetect)
+{
+    if (autoOnsetMarkers == shouldDetect)
+        return;
+
+    autoOnsetMarkers = shouldDetect;
+
+    // Turning onsets on needs another pass unless they are cached; the grid
+    // comes back from the cache if it was finished.
+    if (shouldDetect)
+        startTrackAnalysis();
+    else
+        clearOnsetMarkers();
+}
+
+juce::AudioFormatReader* PlayerAudio::createDeckReader(const juce::File& file, IndexedSeekReader** seekReader,
+    bool useSharedCache)
+{
+    juce::AudioFormatReader* reader = nullptr;
+    auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+
+    if (format == nullptr || !SeekIndex::canIndex(file))
+    {
+        reader = GaplessInfo::createTrimmedReader(formatManager, file);
+    }
+    else
+    {
+        std::unique_ptr<juce::InputStream> stream(file.createInputStream());
+        if (stream == nullptr)
+            return nullptr;
+
+        auto* formatReader = format->createReaderFor(stream.release(), true);
+        if (formatReader == nullptr)
+            return nullptr;
+
+        auto* indexed = new IndexedSeekReader(formatReader, *format, file);
+        indexed->setIndex(SeekIndex::loadFromCache(file));
+
+        if (seekReader != nullptr)
+            *seekReader = indexed;
+
+        reader = GaplessInfo::trimReader(indexed, file);
+    }
+
+    // Uncompressed files cost no more to read than to copy out of the cache.
+    if (reader == nullptr || !useSharedCache || file.hasFileExtension("wav;aif;aiff"))
+        return reader;
+
+    return new CachingAudioReader(reader, DecodedBlockCache::makeFileKey(file));
+}
+
+juce::AudioFormatReader* PlayerAudio::createSharedReader(const juce::File& file)
+{
+    return createDeckReader(file);
 }
 
-PlayerAudio::~PlayerAudio()
+juce::AudioFormatReader* PlayerAudio::createWholeTrackReader(const juce::File& file)
 {
-    transportSource.setSource(nullptr);
+    return createDeckReader(file, nullptr, false);
 }
 
-void PlayerAudio::loadFile(const juce::File& audioFile)
+void PlayerAudio::loadFinished(std::unique_ptr<LoadResult> result)
 {
-    if (!isValidAudioFile(audioFile))
+    // Called on the worker thread. A result for a superseded request is dropped here.
+    const bool queued = result->queued;
+
+    if (result->generation != (queued ? queueGeneration : loadGeneration).load())
         return;
 
-    if (auto* reader = formatManager.createReaderFor(audioFile))
     {
-        transportSource.stop();
-        transportSource.setSource(nullptr);
-        readerSource.reset();
-        readerSource = std::make_unique<juce::AudioFormatReaderSource>(reader, true);
-        readerSource->setLooping(isLooping);
-        transportSource.setSource(readerSource.get(), 0, nullptr, reader->sampleRate);
-        currentFile = audioFile;
+        const juce::ScopedLock sl(loadResultLock);
+        (queued ? completedQueue : completedLoad) = std::move(result);
+    }
+
+    triggerAsyncUpdate();
+}
 
-        sliceReady = false;
-        audioSlice.setSize(0, 0);
+void PlayerAudio::handleAsyncUpdate()
+{
+    std::unique_ptr<LoadResult> result, queuedResult;
+    std::unique_ptr<SliceExportJob::Result> exportResult;
+    juce::Array<SliceExportJob::Result> regionResults;
+    juce::Array<IndexResult> indexes;
+    juce::Array<OnsetResult> onsetResults;
+    juce::Array<BeatResult> beatResults;
+    juce::Array<LoudnessResult> loudnessResults;
+    juce::Array<WaveformResult> waveformResults;
+    juce::OwnedArray<LoopRegion> regions;
 
-        clearAllMarkers();
+    {
+        const juce::ScopedLock sl(loadResultLock);
+        result = std::move(completedLoad);
+        queuedResult = std::move(completedQueue);
+        exportResult = std::move(completedExport);
+        regionResults.swapWith(completedRegionExports);
+        indexes.swapWith(completedIndexes);
+        onsetResults.swapWith(completedOnsets);
+        beatResults.swapWith(completedBeatGrids);
+        loudnessResults.swapWith(completedLoudness);
+        waveformResults.swapWith(completedWaveforms);
+        regions.swapWith(completedLoopRegions);
+    }
 
-        setSpeed(1.0f);
+    if (!regions.isEmpty())
+        applyLoopRegions(regions);
 
-        extractMetadata(reader, audioFile);
+    for (const auto& waveformResult : waveformResults)
+    {
+        if (waveformResult.generation == waveformGeneration)
+        {
+            waveform = waveformResult.waveform;
+            sendChangeMessage();
+        }
+    }
 
-        sendChangeMessage();
+    if (!loudnessResults.isEmpty())
+        applyLoudnessResults(loudnessResults);
+
+    for (const auto& beatResult : beatResults)
+    {
+        if (beatResult.generation == beatGeneration)
+        {
+            metadata.beatGrid = beatResult.grid;
+            sendChangeMessage();
+        }
+    }
+
+    if (!onsetResults.isEmpty())
+        addOnsetMarkers(onsetResults);
+
+    if (!regionResults.isEmpty())
+        handleRegionExportResults(regionResults);
+
+    // isLoading() goes by whether a load job is still listed.
+    loadJobs.removeFinished();
+
+    if (exportResult != nullptr)
+    {
+        // runJob has returned by the time the pool stops listing the job.
+        exportPool->waitForJobToFinish(sliceExportJob.get(), 1000);
+        sliceExportJob.reset();
+
+        if (auto callback = std::move(sliceExportCallback))
+            callback(exportResult->succeeded);
     }
+
+    for (const auto& indexResult : indexes)
+        if (indexResult.generation == indexGeneration)
+            for (auto* stream : streams)
+                if (stream->seekReader != nullptr && stream->file == indexResult.file)
+                    stream->seekReader->setIndex(indexResult.index);
+
+    if (queuedResult != nullptr && queuedResult->stream != nullptr
+        && queuedResult->generation == queueGeneration.load())
+        commitQueuedStream(std::move(queuedResult->stream), queuedResult->metadata);
+
+    if (result == nullptr || result->generation != loadGeneration.load())
+        return;
+
+    const bool succeeded = result->stream != nullptr;
+
+    if (succeeded)
+        commitStream(std::move(result->stream), result->metadata);
+
+    if (result->onLoaded != nullptr)
+        result->onLoaded(succeeded);
+}
+
+void PlayerAudio::commitStream(std::unique_ptr<DeckStream> stream, const Metadata& newMetadata)
+{
+    releaseRetiredResources();
+
+    stream->serial = nextStreamSerial++;
+    currentFile = stream->file;
+    sourceSampleRate = stream->sampleRate;
+    lengthInSeconds = (double)stream->lengthInSamples / stream->sampleRate;
+    metadata = newMetadata;
+    currentPositionSeconds = 0.0;
+
+    // Until the analysis pass reports its loudness, the track plays at the
+    // provisional gain. A new track replaces both the old one and anything
+    // queued behind it, so no queued file is worth measuring any more.
+    updateNormalisationGain(*stream);
+    loudnessJobs.signalAll();
+    ++indexGeneration;
+    startSeekIndexJob(*stream);
+    pushCommand(DeckCommand::Type::stop);
+
+    DeckCommand command;
+    command.type = DeckCommand::Type::swapStream;
+    command.serial = stream->serial;
+    command.stream = streams.add(stream.release());
+    sendCommand(command);
+
+    sliceReady = false;
+
+    clearAllMarkers();
+    clearWaveform();
+    startTrackAnalysis();
+
+    setSpeed(1.0f);
+
+    pushSegmentState();
+    sendChangeMessage();
+
+    startTimer(250);
+}
+
+void PlayerAudio::commitQueuedStream(std::unique_ptr<DeckStream> stream, const Metadata& newMetadata)
+{
+    stream->serial = nextStreamSerial++;
+    queuedFile = stream->file;
+    queuedMetadata = newMetadata;
+    queuedStreamSerial = stream->serial;
+
+    updateNormalisationGain(*stream);
+    startLoudnessJob(*stream);
+    startSeekIndexJob(*stream);
+    pushQueuedStream(streams.add(stream.release()), queuedStreamSerial);
+
+    startTimer(50);
+}
+
+void PlayerAudio::handleTrackAdvanced()
+{
+    DeckStream* stream = nullptr;
+
+    for (auto* candidate : streams)
+        if (candidate->serial == queuedStreamSerial)
+            stream = candidate;
+
+    if (stream == nullptr)
+        return;
+
+    currentFile = stream->file;
+    sourceSampleRate = stream->sampleRate;
+    lengthInSeconds = (double)stream->lengthInSamples / stream->sampleRate;
+    metadata = queuedMetadata;
+
+    queuedFile = juce::File();
+    queuedStreamSerial = 0;
+
+    sliceReady = false;
+
+    clearMarkers();
+    clearAllMarkers();
+    clearWaveform();
+    startTrackAnalysis();
+
+    if (onTrackAdvanced != nullptr)
+        onTrackAdvanced();
+}
+
+void PlayerAudio::timerCallback()
+{
+    flushOverflowCommands();
+
+    if (queuedStreamSerial != 0 && appliedStreamSerial.load() >= queuedStreamSerial)
+        handleTrackAdvanced();
+
+    releaseRetiredResources();
+
+    if (streams.size() <= 1 && loopRegions.size() <= 1 && queuedStreamSerial == 0 && overflowCommands.empty())
+        stopTimer();
 }
 
 void PlayerAudio::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-    transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    deviceSampleRate = sampleRate;
+    deviceBlockSize = samplesPerBlockExpected;
+    // Prepares the whole chain: resampler, time-stretch, then the transport.
     resampleSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    resetRateConversion();
+    outputMeter.prepare(sampleRate);
 }
 
 void PlayerAudio::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
+    applyPendingCommands();
+    auto* streamBefore = deckTransport.getStream();
     resampleSource.getNextAudioBlock(bufferToFill);
-    checkSegmentLooping();
+
+    if (auto* stream = deckTransport.getStream())
+    {
+        // Spliced into the queued stream during this block; any change of
+        // rate has already been handed down the chain from the splice.
+        if (stream != streamBefore)
+            appliedStreamSerial = stream->serial;
+
+        currentPositionSeconds = (double)deckTransport.getNextReadPosition() / stream->sampleRate;
+    }
+
+    outputMeter.process(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+    outputTap.push(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
 }
 
 void PlayerAudio::releaseResources()
 {
-    transportSource.releaseResources();
     resampleSource.releaseResources();
 }
 
+bool PlayerAudio::pushCommand(DeckCommand::Type type, double first, double second, bool flag)
+{
+    DeckCommand command;
+    command.type = type;
+    command.first = first;
+    command.second = second;
+    command.flag = flag;
+    return sendCommand(command);
+}
+
+bool PlayerAudio::sendCommand(const DeckCommand& command)
+{
+    if (command.type == DeckCommand::Type::seek)
+        if (auto* stream = streams.getLast(); stream != nullptr && stream->readAheadSource != nullptr)
+            stream->readAheadSource->expectSeek();
+
+    // Anything already waiting must reach the audio thread first, or the
+    // commands would be applied out of order.
+    flushOverflowCommands();
+
+    if (overflowCommands.empty() && commandQueue.push(command))
+        return true;
+
+    // The queue only fills if the audio thread has stalled or the device is
+    // stopped; hold the command and let the timer retry.
+    ++deferredCommands;
+    overflowCommands.push_back(command);
+    startTimer(50);
+    return false;
+}
+
+void PlayerAudio::flushOverflowCommands()
+{
+    size_t numSent = 0;
+
+    while (numSent < overflowCommands.size() && commandQueue.push(overflowCommands[numSent]))
+        ++numSent;
+
+    overflowCommands.erase(overflowCommands.begin(), overflowCommands.begin() + (std::ptrdiff_t)numSent);
+}
+
+void PlayerAudio::pushSegmentState()
+{
+    releaseRetiredResources();
+
+    // The loop starts playing from the input straight away; its region follows
+    // once it has been decoded off the message thread.
+    loopRegionJobs.signalAll();
+
+    DeckCommand command;
+    command.type = DeckCommand::Type::setSegment;
+    command.serial = nextSegmentSerial++;
+    command.flag = segmentLooping && hasMarkers() && sourceSampleRate > 0.0;
+    requestedSegmentSerial = command.serial;
+
+    if (command.flag)
+    {
+        const auto startSample = (juce::int64)std::llround(markerA * sourceSampleRate);
+        const auto endSample = (juce::int64)std::llround(markerB * sourceSampleRate);
+
+        command.first = (double)startSample;
+        command.second = (double)endSample;
+        startLoopRegionJob(startSample, endSample, command.serial);
+    }
+
+    sendCommand(command);
+}
+
+void PlayerAudio::startLoopRegionJob(juce::int64 startSample, juce::int64 endSample, int serial)
+{
+    if (endSample <= startSample)
+        return;
+
+    const auto fadeLength = (int)std::llround(loopCrossfadeMs * 0.001 * sourceSampleRate);
+    loopRegionJobs.add(new LoopRegionJob(*this, currentFile, startSample, endSample, fadeLength, serial));
+}
+
+void PlayerAudio::loopRegionBuilt(std::unique_ptr<LoopRegion> region)
+{
+    // Called on the worker thread.
+    {
+        const juce::ScopedLock sl(loadResultLock);
+        completedLoopRegions.add(region.release());
+    }
+
+    triggerAsyncUpdate();
+}
+
+void PlayerAudio::applyLoopRegions(juce::OwnedArray<LoopRegion>& regions)
+{
+    while (!regions.isEmpty())
+    {
+        std::unique_ptr<LoopRegion> region(regions.removeAndReturn(regions.size() - 1));
+
+        // Built for a segment that has since been moved or switched off.
+        if (region->serial != requestedSegmentSerial)
+            continue;
+
+        DeckCommand command;
+        command.type = DeckCommand::Type::setSegment;
+        command.serial = nextSegmentSerial++;
+        command.flag = true;
+        command.first = (double)region->start;
+        command.second = (double)region->end;
+
+        region->serial = command.serial;
+        command.region = loopRegions.add(region.release());
+        sendCommand(command);
+    }
+}
+
+void PlayerAudio::releaseRetiredResources()
+{
+    // Commands are applied in order, so once the audio thread has taken serial N
+    // nothing older than it can still be referenced.
+    const int appliedSegment = appliedSegmentSerial.load();
+
+    for (int i = loopRegions.size(); --i >= 0;)
+        if (loopRegions.getUnchecked(i)->serial < appliedSegment)
+            loopRegions.remove(i);
+
+    const int appliedStream = appliedStreamSerial.load();
+
+    for (int i = streams.size(); --i >= 0;)
+        if (streams.getUnchecked(i)->serial < appliedStream)
+            streams.remove(i);
+}
+
+void PlayerAudio::setLoopCrossfadeMs(double milliseconds)
+{
+    loopCrossfadeMs = juce::jlimit(0.0, 50.0, milliseconds);
+    pushSegmentState();
+}
+
+void PlayerAudio::applyPendingCommands()
+{
+    commandQueue.drain([this](const DeckCommand& command) { applyCommand(command); });
+    applyContinuousParameters();
+}
+
+void PlayerAudio::applyContinuousParameters()
+{
+    // Read once per block, so only the latest slider value matters.
+    deckTransport.setGain(targetGain.load(std::memory_order_relaxed));
+
+    const double speed = (double)targetSpeed.load(std::memory_order_relaxed);
+
+    if (speed != liveSpeed)
+    {
+        liveSpeed = speed;
+        updateResamplingRatio();
+    }
+}
+
+void PlayerAudio::applyCommand(const DeckCommand& command)
+{
+    switch (command.type)
+    {
+    case DeckCommand::Type::play:
+        deckTransport.start();
+        break;
+
+    case DeckCommand::Type::stop:
+        deckTransport.stop();
+        break;
+
+    case DeckCommand::Type::seek:
+        if (auto* stream = deckTransport.getStream())
+        {
+            deckTransport.setNextReadPosition((juce::int64)(command.first * stream->sampleRate));
+            resetRateConversion();
+            currentPositionSeconds = command.first;
+        }
+        break;
+
+    case DeckCommand::Type::setLooping:
+        deckTransport.setLooping(command.flag);
+        break;
+
+    case DeckCommand::Type::setSegment:
+        if (auto* stream = deckTransport.getStream())
+            stream->segmentLoopSource->setSegment((juce::int64)command.first, (juce::int64)command.second,
+                command.flag, command.region);
+        appliedSegmentSerial = command.serial;
+        break;
+
+    case DeckCommand::Type::swapStream:
+        deckTransport.setStream(command.stream);
+        resetRateConversion();
+        currentPositionSeconds = 0.0;
+        appliedStreamSerial = command.serial;
+        break;
+
+    case DeckCommand::Type::queueStream:
+        deckTransport.setNextStream(command.stream);
+        break;
+
+    case DeckCommand::Type::setResamplingQuality:
+        resampleSource.setQuality((SincResamplingSource::Quality)juce::roundToInt(command.first));
+        break;
+
+    case DeckCommand::Type::setTimeStretch:
+        timeStretch.setQuality((TimeStretchSource::Quality)juce::roundToInt(command.first));
+        timeStretch.setEnabled(command.flag);
+
+        // Either change restarts the stretch, so a rate change it was still
+        // carrying is settled here.
+        resetRateConversion();
+        break;
+    }
+}
+
+double PlayerAudio::getResamplingRatio() const
+{
+    // The deck transport runs at the file's own rate, so file-to-device conversion and
+    // the speed control share the one resampler. With pitch preserved, the speed
+    // goes to the time-stretcher instead and the resampler only converts rate.
+    const double rateRatio = (resampledSourceRate > 0.0 && deviceSampleRate > 0.0)
+        ? resampledSourceRate / deviceSampleRate : 1.0;
+
+    return (timeStretch.isEnabled() ? 1.0 : liveSpeed) * rateRatio;
+}
+
+void PlayerAudio::updateResamplingRatio()
+{
+    timeStretch.setStretchRatio(liveSpeed);
+    resampleSource.setResamplingRatio(getResamplingRatio());
+}
+
+// Wherever the chain restarts anyway (a seek, a new stream, a new device),
+// both stages take the current stream's rate from its first sample on.
+void PlayerAudio::resetRateConversion()
+{
+    if (auto* stream = deckTransport.getStream())
+    {
+        resampledSourceRate = stream->sampleRate;
+        timeStretch.setSourceSampleRate(stream->sampleRate);
+    }
+
+    timeStretch.reset();
+    resampleSource.reset();
+    updateResamplingRatio();
+}
+
 void PlayerAudio::play()
 {
-    if (!transportSource.isPlaying())
-        transportSource.start();
+    pushCommand(DeckCommand::Type::play);
 }
 
 void PlayerAudio::stop()
 {
-    if (transportSource.isPlaying())
-        transportSource.stop();
+    pushCommand(DeckCommand::Type::stop);
 }
 
 void PlayerAudio::restart()
 {
-    transportSource.setPosition(0.0);
-    transportSource.start();
+    pushCommand(DeckCommand::Type::seek, 0.0);
+    pushCommand(DeckCommand::Type::play);
 }
 
 bool PlayerAudio::toggleLooping()
 {
     isLooping = !isLooping;
-    if (readerSource)
-        readerSource->setLooping(isLooping);
+    pushCommand(DeckCommand::Type::setLooping, 0.0, 0.0, isLooping);
     return isLooping;
 }
 
 bool PlayerAudio::isPlaying() const
 {
-    return transportSource.isPlaying();
+    return deckTransport.isPlaying();
 }
 
 void PlayerAudio::setVolume(float newVolume)
 {
     currentVolume = juce::jlimit(0.0f, 1.0f, newVolume);
-    transportSource.setGain(currentVolume);
+    targetGain = currentVolume;
 }
 
 float PlayerAudio::getVolume() const
@@ -102,75 +1337,138 @@ float PlayerAudio::getVolume() const
 void PlayerAudio::setSpeed(float newSpeed)
 {
     currentSpeed = juce::jlimit(0.5f, 2.0f, newSpeed);
-    resampleSource.setResamplingRatio(currentSpeed);
+    targetSpeed = currentSpeed;
+}
+
+void PlayerAudio::setPitchPreserving(bool shouldPreservePitch)
+{
+    pitchPreserving = shouldPreservePitch;
+    pushTimeStretchState();
+}
+
+void PlayerAudio::setStretchQuality(TimeStretchSource::Quality newQuality)
+{
+    stretchQuality = newQuality;
+    pushTimeStretchState();
+}
+
+void PlayerAudio::setResamplingQuality(SincResamplingSource::Quality newQuality)
+{
+    resamplingQuality = newQuality;
+    pushCommand(DeckCommand::Type::setResamplingQuality, (double)(int)resamplingQuality);
+}
+
+void PlayerAudio::pushTimeStretchState()
+{
+    pushCommand(DeckCommand::Type::setTimeStretch, (double)(int)stretchQuality, 0.0, pitchPreserving);
+}
+
+void PlayerAudio::setReadAheadSeconds(double seconds)
+{
+    readAheadSeconds = juce::jlimit(0.25, 30.0, seconds);
+}
+
+ReadAheadSource::Stats PlayerAudio::getStreamingStats() const
+{
+    if (auto* stream = streams.getLast())
+        if (stream->readAheadSource != nullptr)
+            return stream->readAheadSource->getStats();
+
+    return {};
+}
+
+void PlayerAudio::setPosition(double seconds)
+{
+    pushCommand(DeckCommand::Type::seek, seconds);
 }
 
 void PlayerAudio::backward(double seconds)
 {
-    auto newPosition = juce::jmax(0.0, transportSource.getCurrentPosition() - seconds);
-    transportSource.setPosition(newPosition);
+    auto newPosition = juce::jmax(0.0, getCurrentPosition() - seconds);
+    setPosition(newPosition);
 }
 
 void PlayerAudio::forward(double seconds)
 {
-    if (readerSource != nullptr)
+    if (lengthInSeconds > 0.0)
     {
-        auto totalLength = readerSource->getTotalLength() / readerSource->getAudioFormatReader()->sampleRate;
-        auto newPosition = juce::jmin(totalLength, transportSource.getCurrentPosition() + seconds);
-        transportSource.setPosition(newPosition);
+        auto newPosition = juce::jmin(lengthInSeconds, getCurrentPosition() + seconds);
+        setPosition(newPosition);
     }
 }
 
 void PlayerAudio::goToEnd()
 {
-    if (readerSource != nullptr)
+    if (lengthInSeconds > 0.0)
     {
-        double totalLength = transportSource.getLengthInSeconds();
-        transportSource.setPosition(juce::jmax(0.0, totalLength - 0.1));
+        setPosition(juce::jmax(0.0, lengthInSeconds - 0.1));
     }
 }
 
 void PlayerAudio::SaveState(juce::PropertiesFile& props, const juce::String& keyPrefix)
 {
     props.setValue(keyPrefix + "_lastFile", currentFile.getFullPathName());
-    props.setValue(keyPrefix + "_lastPosition", transportSource.getCurrentPosition());
+    props.setValue(keyPrefix + "_lastPosition", getCurrentPosition());
     props.setValue(keyPrefix + "_lastSpeed", currentSpeed);
+    props.setValue(keyPrefix + "_keepPitch", pitchPreserving);
+    props.setValue(keyPrefix + "_stretchQuality", (int)stretchQuality);
+    props.setValue(keyPrefix + "_resamplingQuality", (int)resamplingQuality);
+    props.setValue(keyPrefix + "_onsetMarkers", autoOnsetMarkers);
+    props.setValue(keyPrefix + "_normaliseLoudness", normaliseLoudness);
+    props.setValue(keyPrefix + "_targetLoudness", targetLoudness);
     props.saveIfNeeded();
 }
 
 void PlayerAudio::RestoreState(juce::PropertiesFile& props, const juce::String& keyPrefix)
 {
+    pitchPreserving = props.getBoolValue(keyPrefix + "_keepPitch", false);
+    stretchQuality = (TimeStretchSource::Quality)juce::jlimit(0, 2,
+        props.getIntValue(keyPrefix + "_stretchQuality", (int)TimeStretchSource::Quality::normal));
+    pushTimeStretchState();
+    setResamplingQuality((SincResamplingSource::Quality)juce::jlimit(0, 2,
+        props.getIntValue(keyPrefix + "_resamplingQuality", (int)SincResamplingSource::Quality::medium)));
+    autoOnsetMarkers = props.getBoolValue(keyPrefix + "_onsetMarkers", true);
+    setTargetLoudness(props.getDoubleValue(keyPrefix + "_targetLoudness", -18.0));
+    setLoudnessNormalisation(props.getBoolValue(keyPrefix + "_normaliseLoudness", true));
+
     juce::String lastFile = props.getValue(keyPrefix + "_lastFile", "");
     if (lastFile.isNotEmpty())
     {
         juce::File fileToLoad(lastFile);
         if (fileToLoad.existsAsFile() && isValidAudioFile(fileToLoad))
         {
-            loadFile(fileToLoad);
             double lastPosition = props.getDoubleValue(keyPrefix + "_lastPosition", 0.0);
             float lastSpeed = props.getDoubleValue(keyPrefix + "_lastSpeed", 1.0f);
-            transportSource.setPosition(lastPosition);
-            setSpeed(lastSpeed);
+            loadFileAsync(fileToLoad, [this, lastPosition, lastSpeed](bool loaded)
+                {
+                    if (loaded)
+                    {
+                        setPosition(lastPosition);
+                        setSpeed(lastSpeed);
+                    }
+                });
         }
     }
 }
 
 void PlayerAudio::setMarkerA()
 {
-    markerA = transportSource.getCurrentPosition();
+    markerA = getCurrentPosition();
     if (markerB > 0 && markerA > markerB)
     {
         std::swap(markerA, markerB);
     }
+    pushSegmentState();
 }
 
 void PlayerAudio::setMarkerB()
 {
-    markerB = transportSource.getCurrentPosition();
+    markerB = getCurrentPosition();
     if (markerA > 0 && markerB < markerA)
     {
         std::swap(markerA, markerB);
     }
+    pushSegmentState();
 }
 
 void PlayerAudio::clearMarkers()
@@ -178,88 +1476,198 @@ void PlayerAudio::clearMarkers()
     markerA = -1.0;
     markerB = -1.0;
     segmentLooping = false;
+    pushSegmentState();
 }
 
 void PlayerAudio::setSegmentLooping(bool shouldLoop)
 {
     segmentLooping = shouldLoop && hasMarkers();
-}
-
-void PlayerAudio::checkSegmentLooping()
-{
-    if (segmentLooping && hasMarkers() && transportSource.isPlaying())
-    {
-        double currentPos = transportSource.getCurrentPosition();
-        if (currentPos >= markerB)
-        {
-            transportSource.setPosition(markerA);
-        }
-    }
+    pushSegmentState();
 }
 
 bool PlayerAudio::createSliceFromMarkers()
 {
-    if (!hasMarkers() || readerSource == nullptr)
+    if (!hasMarkers() || lengthInSeconds <= 0.0 || isExportingSlice())
         return false;
 
+    // Nothing is read here; exporting streams the range straight from the file.
     sliceStart = markerA;
-    sliceEnd = markerB;
+    sliceEnd = juce::jmin(markerB, lengthInSeconds);
+    sliceReady = sliceEnd > sliceStart;
+    return sliceReady;
+}
 
-    auto* reader = readerSource->getAudioFormatReader();
-    if (reader == nullptr)
+bool PlayerAudio::exportSliceAsync(const juce::File& outputFile, std::function<void(bool)> onFinished)
+{
+    if (!hasValidSlice() || isExportingSlice() || sourceSampleRate <= 0.0)
         return false;
 
-    int sampleRate = reader->sampleRate;
-    int startSample = (int)(sliceStart * sampleRate);
-    int numSamples = (int)((sliceEnd - sliceStart) * sampleRate);
-
-    if (numSamples <= 0)
-        return false;
+    const auto startSample = (juce::int64)(sliceStart * sourceSampleRate);
+    const auto numSamples = (juce::int64)((sliceEnd - sliceStart) * sourceSampleRate);
 
-    audioSlice.setSize(reader->numChannels, numSamples);
+    sliceExportCallback = std::move(onFinished);
+    sliceExportJob = std::make_unique<SliceExportJob>(makeExportReaderFactory(), startSample, numSamples, outputFile,
+        [this](const SliceExportJob::Result& result)
+        {
+            {
+                const juce::ScopedLock sl(loadResultLock);
+                completedExport = std::make_unique<SliceExportJob::Result>(result);
+            }
 
-    if (!reader->read(&audioSlice, 0, numSamples, startSample, true, true))
-        return false;
+            triggerAsyncUpdate();
+        });
 
-    sliceReady = true;
+    sliceExportJob->setPassThroughSource(currentFile);
+    exportPool->addJob(sliceExportJob.get(), false);
     return true;
 }
 
-bool PlayerAudio::saveSliceToFile(const juce::File& outputFile)
+SliceExportJob::ReaderFactory PlayerAudio::makeExportReaderFactory()
 {
-    if (!sliceReady || audioSlice.getNumSamples() == 0)
-        return false;
+    // Each job opens its own reader when it starts, so the regions decode
+    // independently and only the running ones hold a file open.
+    return [this, file = currentFile] { return createWholeTrackReader(file); };
+}
 
-    juce::WavAudioFormat wavFormat;
-    std::unique_ptr<juce::AudioFormatWriter> writer;
+void PlayerAudio::cancelSliceExport()
+{
+    // The job notices at its next chunk and reports back as cancelled.
+    if (sliceExportJob != nullptr)
+        sliceExportJob->signalJobShouldExit();
+}
 
-    auto outputStream = outputFile.createOutputStream();
-    if (outputStream == nullptr)
-        return false;
+float PlayerAudio::getSliceExportProgress() const
+{
+    return sliceExportJob != nullptr ? sliceExportJob->getProgress() : 0.0f;
+}
 
-    auto* reader = readerSource->getAudioFormatReader();
-    if (reader == nullptr)
+bool PlayerAudio::exportMarkerRegionsAsync(const juce::File& directory,
+    std::function<void(const RegionExportSummary&)> onFinished)
+{
+    if (isExportingRegions() || markers.size() < 2 || lengthInSeconds <= 0.0 || sourceSampleRate <= 0.0
+        || !directory.createDirectory())
         return false;
 
-    writer.reset(wavFormat.createWriterFor(outputStream.release(),
-        reader->sampleRate,
-        audioSlice.getNumChannels(),
-        16,
-        juce::StringPairArray(),
-        0));
+    regionSummary = RegionExportSummary();
+    regionSummary.directory = directory;
+    regionExportCallback = std::move(onFinished);
+    regionExportStartMs = juce::Time::getMillisecondCounterHiRes();
+
+    const auto baseName = currentFile.getFileNameWithoutExtension();
 
-    if (writer != nullptr)
+    for (int i = 0; i + 1 < markers.size(); ++i)
     {
-        bool success = writer->writeFromAudioSampleBuffer(audioSlice, 0, audioSlice.getNumSamples());
-        return success;
+        const double start = markers.getReference(i).time;
+        const double end = juce::jmin(markers.getReference(i + 1).time, lengthInSeconds);
+
+        if (end <= start)
+            continue;
+
+        const auto name = juce::File::createLegalFileName(baseName + " - " + juce::String(i + 1).paddedLeft('0', 2)
+            + " " + markers.getReference(i).name);
+        const auto startSample = (juce::int64)(start * sourceSampleRate);
+        const auto numSamples = (juce::int64)((end - start) * sourceSampleRate);
+
+        auto job = std::make_unique<SliceExportJob>(makeExportReaderFactory(), startSample, numSamples,
+            directory.getChildFile(name).withFileExtension(getSliceExportExtension()),
+            [this](const SliceExportJob::Result& result)
+            {
+                {
+                    const juce::ScopedLock sl(loadResultLock);
+                    completedRegionExports.add(result);
+                }
+
+                triggerAsyncUpdate();
+            });
+
+        job->setPassThroughSource(currentFile);
+
+        // The export pool runs one per spare core; the rest wait there without
+        // holding up loads and analysis on the shared pool.
+        regionExportJobs.add(job.release());
+        ++regionSummary.numRegions;
     }
 
-    return false;
+    return regionSummary.numRegions > 0;
+}
+
+void PlayerAudio::cancelRegionExport()
+{
+    // Queued jobs still run, see the flag straight away and report as
+    // cancelled, so the summary always accounts for every region.
+    for (auto* job : regionExportJobs)
+        job->signalJobShouldExit();
+}
+
+float PlayerAudio::getRegionExportProgress() const
+{
+    if (regionSummary.numRegions <= 0)
+        return 0.0f;
+
+    // Jobs the list has already let go of were finished.
+    auto total = (float)(regionSummary.numRegions - regionExportJobs.size());
+    for (auto* job : regionExportJobs)
+        total += job->getProgress();
+
+    return total / (float)regionSummary.numRegions;
+}
+
+void PlayerAudio::handleRegionExportResults(const juce::Array<SliceExportJob::Result>& results)
+{
+    for (const auto& result : results)
+    {
+        if (result.succeeded)
+        {
+            ++regionSummary.succeeded;
+            regionSummary.files.add(result.file);
+        }
+        else if (result.cancelled)
+        {
+            ++regionSummary.cancelled;
+        }
+        else
+        {
+            ++regionSummary.failed;
+            regionSummary.errors.add(result.file.getFileName() + ": " + result.error);
+        }
+    }
+
+    if (regionSummary.succeeded + regionSummary.failed + regionSummary.cancelled < regionSummary.numRegions)
+        return;
+
+    regionExportJobs.removeAll(1000);
+    regionSummary.elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - regionExportStartMs) * 0.001;
+
+    if (auto callback = std::move(regionExportCallback))
+        callback(regionSummary);
+}
+
+juce::String PlayerAudio::RegionExportSummary::toString() const
+{
+    auto text = juce::String::formatted("Exported %d of %d regions in %.1f s", succeeded, numRegions, elapsedSeconds)
+        + "\nto " + directory.getFullPathName();
+
+    if (cancelled > 0)
+        text << "\n" << cancelled << " cancelled";
+
+    if (failed > 0)
+        text << "\n" << failed << " failed:\n" << errors.joinIntoString("\n");
+
+    return text;
+}
+
+juce::String PlayerAudio::getSliceExportExtension() const
+{
+    // Slices keep the source's container whenever they can be copied out of it.
+    if (SliceExportJob::canPassThrough(currentFile, currentFile.getFileExtension()))
+        return currentFile.getFileExtension();
+
+    return ".wav";
 }
 
 bool PlayerAudio::hasValidSlice() const
 {
-    return sliceReady && audioSlice.getNumSamples() > 0;
+    return sliceReady && sliceEnd > sliceStart;
 }
 
 juce::String PlayerAudio::getSliceInfo() const
@@ -284,20 +1692,25 @@ void PlayerAudio::addMarker(double time, const juce::String& name) {
     }
 
     markers.add(newMarker);
-    std::sort(markers.begin(), markers.end());
     sendChangeMessage();
 }
 
+void PlayerAudio::addMarkers(const juce::Array<Marker>& newMarkers) {
+    if (!newMarkers.isEmpty()) {
+        markers.addAll(newMarkers);
+        sendChangeMessage();
+    }
+}
+
 void PlayerAudio::removeMarker(int index) {
-    if (index >= 0 && index < markers.size()) {
-        markers.remove(index);
+    if (markers.remove(index)) {
         sendChangeMessage();
     }
 }
 
 void PlayerAudio::jumpToMarker(int index) {
     if (index >= 0 && index < markers.size()) {
-        transportSource.setPosition(markers[index].time);
+        setPosition(markers.getReference(index).time);
     }
 }
 
@@ -308,17 +1721,18 @@ void PlayerAudio::clearAllMarkers() {
 
 juce::String PlayerAudio::getMarkerInfo(int index) const {
     if (index >= 0 && index < markers.size()) {
-        int minutes = static_cast<int>(markers[index].time) / 60;
-        int seconds = static_cast<int>(markers[index].time) % 60;
+        const auto& marker = markers.getReference(index);
+        int minutes = static_cast<int>(marker.time) / 60;
+        int seconds = static_cast<int>(marker.time) % 60;
         juce::String timeString = juce::String::formatted("%02d:%02d", minutes, seconds);
-        return markers[index].name + " (" + timeString + ")";
+        return marker.name + " (" + timeString + ")";
     }
     return "";
 }
 
-void PlayerAudio::extractMetadata(juce::AudioFormatReader* reader, const juce::File& audioFile)
+PlayerAudio::Metadata PlayerAudio::extractMetadata(juce::AudioFormatReader* reader, const juce::File& audioFile)
 {
-    metadata = Metadata();
+    Metadata metadata;
     metadata.filename = audioFile.getFileName();
     metadata.duration = reader->lengthInSamples / reader->sampleRate;
 
@@ -330,6 +1744,8 @@ void PlayerAudio::extractMetadata(juce::AudioFormatReader* reader, const juce::F
 
     if (metadata.title.isEmpty())
         metadata.title = audioFile.getFileNameWithoutExtension();
+
+    return metadata;
 }
 bool PlayerAudio::isValidAudioFile(const juce::File& file) const
 {
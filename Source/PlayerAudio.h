@@ -1,15 +1,45 @@
 #pragma once
 #include <JuceHeader.h>
+#include "AudioTap.h"
+#include "BackgroundThreadPool.h"
+#include "BeatGrid.h"
+#include "DecodedBlockCache.h"
+#include "DeckCommandQueue.h"
+#include "DeckStream.h"
+#include "DeckTransport.h"
+#include "GaplessInfo.h"
+#include "IndexedSeekReader.h"
+#include "LevelMeter.h"
+#include "MarkerIndex.h"
+#include "PooledJobs.h"
+#include "ReadAheadSource.h"
+#include "SegmentLoopSource.h"
+#include "SincResamplingSource.h"
+#include "SliceExportJob.h"
+#include "TimeStretchSource.h"
+#include "WaveformPyramid.h"
 
 class PlayerAudio
     : public juce::AudioSource,
-    public juce::ChangeBroadcaster
+    public juce::ChangeBroadcaster,
+    private juce::AsyncUpdater,
+    private juce::Timer
 {
 public:
     PlayerAudio();
     ~PlayerAudio();
 
-    void loadFile(const juce::File& audioFile);
+    void loadFileAsync(const juce::File& audioFile, std::function<void(bool)> onLoaded = nullptr);
+    void cancelPendingLoad();
+    bool isLoading() const { return !loadJobs.isEmpty(); }
+
+    // Gapless follow-on: the queued file is opened and pre-rolled in the
+    // background, then spliced in when the current track runs out.
+    void queueNextFile(const juce::File& audioFile);
+    void clearQueuedFile();
+    juce::File getCurrentFile() const { return currentFile; }
+    juce::File getQueuedFile() const { return queuedFile; }
+    std::function<void()> onTrackAdvanced;
     void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
     void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
     void releaseResources() override;
@@ -27,10 +57,27 @@ public:
     float getVolume() const;
     void setSpeed(float newSpeed);
     float getSpeed() const { return currentSpeed; }
+    void setPitchPreserving(bool shouldPreservePitch);
+    bool isPitchPreserving() const { return pitchPreserving; }
+    void setStretchQuality(TimeStretchSource::Quality newQuality);
+    TimeStretchSource::Quality getStretchQuality() const { return stretchQuality; }
+    float getStretchCpuLoad() const { return timeStretch.getCpuLoad(); }
+
+    // Commands that found the audio thread's queue full and waited for the
+    // timer to resend them; non-zero only if the audio thread has stalled.
+    juce::int64 getDeferredCommandCount() const { return deferredCommands.load(); }
+
+    // The deck's output, after its volume and loudness normalisation but
+    // before the mixer's fader.
+    LevelMeter& getOutputMeter() { return outputMeter; }
+    AudioTap& getOutputTap() { return outputTap; }
+    void setResamplingQuality(SincResamplingSource::Quality newQuality);
+    SincResamplingSource::Quality getResamplingQuality() const { return resamplingQuality; }
     void goToEnd();
-    double getCurrentPosition() const { return transportSource.getCurrentPosition(); }
-    double getLengthInSeconds() const { return transportSource.getLengthInSeconds(); }
-    void setPosition(double seconds) { transportSource.setPosition(seconds); }
+    double getCurrentPosition() const { return currentPositionSeconds.load(); }
+    double getLengthInSeconds() const { return lengthInSeconds; }
+    double getSourceSampleRate() const { return sourceSampleRate; }
+    void setPosition(double seconds);
 
     void SaveState(juce::PropertiesFile& props, const juce::String& keyPrefix);
     void RestoreState(juce::PropertiesFile& props, const juce::String& keyPrefix);
@@ -43,28 +90,67 @@ public:
     double getMarkerA() const { return markerA; }
     double getMarkerB() const { return markerB; }
     bool hasMarkers() const { return markerA >= 0 && markerB > markerA; }
-    void checkSegmentLooping();
+    void setLoopCrossfadeMs(double milliseconds);
+    double getLoopCrossfadeMs() const { return loopCrossfadeMs; }
 
     bool createSliceFromMarkers();
-    bool saveSliceToFile(const juce::File& outputFile);
+
+    // Writes the slice to a WAV file on a worker thread. onFinished runs on
+    // the message thread; it is not called if the export can't start.
+    bool exportSliceAsync(const juce::File& outputFile, std::function<void(bool)> onFinished);
+    void cancelSliceExport();
+    bool isExportingSlice() const { return sliceExportJob != nullptr; }
+    float getSliceExportProgress() const;
+
+    struct RegionExportSummary
+    {
+        juce::File directory;
+        int numRegions = 0;
+        int succeeded = 0;
+        int failed = 0;
+        int cancelled = 0;
+        juce::Array<juce::File> files;
+        juce::StringArray errors;
+        double elapsedSeconds = 0.0;
+
+        juce::String toString() const;
+    };
+
+    // ".wav", or the source's own extension when slices of it can be copied
+    // out without decoding (PCM WAV/AIFF and MP3).
+    juce::String getSliceExportExtension() const;
+
+    // Exports the audio between each pair of consecutive markers to its own
+    // file in directory, all regions at once across the background pool.
+    // onFinished runs on the message thread once every region is done.
+    bool exportMarkerRegionsAsync(const juce::File& directory,
+        std::function<void(const RegionExportSummary&)> onFinished);
+    void cancelRegionExport();
+    bool isExportingRegions() const { return !regionExportJobs.isEmpty(); }
+    float getRegionExportProgress() const;
     bool hasValidSlice() const;
     juce::String getSliceInfo() const;
 
-    struct Marker {
-        double time;
-        juce::String name;
-        bool operator<(const Marker& other) const {
-            return time < other.time;
-        }
-    };
+    using Marker = MarkerIndex::Marker;
 
     void addMarker(double time, const juce::String& name = "");
+    // For beat grids and cue sheets: one rebuild and one change message.
+    void addMarkers(const juce::Array<Marker>& newMarkers);
     void removeMarker(int index);
     void jumpToMarker(int index);
     void clearAllMarkers();
-    const juce::Array<Marker>& getMarkers() const { return markers; }
+    const MarkerIndex& getMarkers() const { return markers; }
     juce::String getMarkerInfo(int index) const;
 
+    // Each track is scanned for onsets after it loads, and they arrive in
+    // batches as the scan goes. Results are cached per file. Onsets are a
+    // layer of their own: the waveform shows them, but they stay out of the
+    // marker list and region export. Switching this rescans or clears the
+    // current track.
+    void setAutoOnsetMarkers(bool shouldDetect);
+    bool getAutoOnsetMarkers() const { return autoOnsetMarkers; }
+    const MarkerIndex& getOnsetMarkers() const { return onsetMarkers; }
+
     struct Metadata {
         juce::String title;
         juce::String artist;
@@ -72,38 +158,242 @@ public:
         juce::String year;
         juce::String filename;
         double duration;
+        BeatGrid beatGrid;
+        LoudnessMeter::Result loudness;
 
         Metadata() : title(""), artist(""), album(""), year(""), filename(""), duration(0.0) {}
     };
 
     Metadata getMetadata() const { return metadata; }
 
+    // Tempo and beat positions of the current track. Analysed in the
+    // background after it loads (invalid until then, or if the track has no
+    // steady pulse); a change message goes out when it arrives.
+    const BeatGrid& getBeatGrid() const { return metadata.beatGrid; }
+
+    // Summary of the current track for the waveform view, read from the
+    // analysis cache or built by the analysis pass after it loads; nullptr
+    // until then. A change message goes
+    // out when it arrives.
+    std::shared_ptr<const WaveformPyramid> getWaveform() const { return waveform; }
+
+    // Each file is measured to EBU R128 after it loads or is queued, and its
+    // level offset to the target, within -1 dBTP, is applied on top of the
+    // volume. Until the measurement arrives a track plays at a cautious
+    // provisional gain, then glides to its own.
+    void setLoudnessNormalisation(bool shouldNormalise);
+    bool isLoudnessNormalisation() const { return normaliseLoudness; }
+    void setTargetLoudness(double lufs);
+    double getTargetLoudness() const { return targetLoudness; }
+
+    void setReadAheadSeconds(double seconds);
+    double getReadAheadSeconds() const { return readAheadSeconds; }
+    ReadAheadSource::Stats getStreamingStats() const;
+    void setMemoryMappedPlayback(bool shouldMap) { memoryMappedPlayback = shouldMap; }
+    bool isMemoryMappedPlayback() const { return memoryMappedPlayback; }
+
+    // A reader that decodes through the shared DecodedBlockCache, trimmed the
+    // same way as the deck. The caller owns it.
+    juce::AudioFormatReader* createSharedReader(const juce::File& file);
+
+    // For reading a whole track start to finish: analysis passes, exports and
+    // the thumbnail. It goes past the shared DecodedBlockCache, since one such
+    // pass would push out every block the decks are playing from.
+    juce::AudioFormatReader* createWholeTrackReader(const juce::File& file);
+
 private:
+    class LoadJob;
+    class SeekIndexJob;
+    class TrackAnalysisJob;
+    class LoudnessJob;
+    class LoopRegionJob;
+
+    struct LoadResult
+    {
+        int generation = 0;
+        std::unique_ptr<DeckStream> stream;
+        Metadata metadata;
+        std::function<void(bool)> onLoaded;
+        bool queued = false;
+    };
+
+    struct IndexResult
+    {
+        int generation = 0;
+        juce::File file;
+        std::shared_ptr<const SeekIndex> index;
+    };
+
+    struct OnsetResult
+    {
+        int generation = 0;
+        juce::Array<double> onsets;
+    };
+
+    struct BeatResult
+    {
+        int generation = 0;
+        BeatGrid grid;
+    };
+
+    struct WaveformResult
+    {
+        int generation = 0;
+        std::shared_ptr<const WaveformPyramid> waveform;
+    };
+
+    struct LoudnessResult
+    {
+        juce::File file;
+        LoudnessMeter::Result loudness;
+    };
+
     juce::AudioFormatManager formatManager;
-    juce::AudioTransportSource transportSource;
-    juce::ResamplingAudioSource resampleSource{ &transportSource, false, 2 };
-    std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+    juce::SharedResourcePointer<SharedReadAheadThread> readAheadThread;
+    juce::SharedResourcePointer<BackgroundThreadPool> backgroundPool;
+    juce::SharedResourcePointer<AnalysisThreadPool> analysisPool;
+    juce::SharedResourcePointer<ExportThreadPool> exportPool;
+    DeckTransport deckTransport;
+    TimeStretchSource timeStretch{ &deckTransport };
+    LevelMeter outputMeter;
+    AudioTap outputTap;
+    SincResamplingSource resampleSource{ &timeStretch };
+    double readAheadSeconds = 2.0;
+    bool memoryMappedPlayback = true;
+    double sourceSampleRate = 0.0;
+    double lengthInSeconds = 0.0;
 
     bool isLooping = false;
     float currentVolume = 1.0f;
     float currentSpeed = 1.0f;
+    bool pitchPreserving = false;
+    TimeStretchSource::Quality stretchQuality = TimeStretchSource::Quality::normal;
+    SincResamplingSource::Quality resamplingQuality = SincResamplingSource::Quality::medium;
 
     double markerA = -1.0;
     double markerB = -1.0;
     bool segmentLooping = false;
 
+    DeckCommandQueue commandQueue;
+    std::vector<DeckCommand> overflowCommands;
+    std::atomic<juce::int64> deferredCommands{ 0 };
+    std::atomic<float> targetGain{ 1.0f };
+    std::atomic<float> targetSpeed{ 1.0f };
+    double deviceSampleRate = 0.0;
+    std::atomic<int> deviceBlockSize{ 0 };
+    double liveSpeed = 1.0;
+
+    // The rate of the samples now reaching the resampler. After a splice it
+    // trails the transport's stream by whatever the time-stretch holds.
+    double resampledSourceRate = 0.0;
+    std::atomic<double> currentPositionSeconds{ 0.0 };
+
+    juce::OwnedArray<DeckStream> streams;
+    int nextStreamSerial = 1;
+    std::atomic<int> appliedStreamSerial{ 0 };
+
+    juce::OwnedArray<LoopRegion> loopRegions;
+    int nextSegmentSerial = 1;
+    int requestedSegmentSerial = 0;
+    std::atomic<int> appliedSegmentSerial{ 0 };
+    double loopCrossfadeMs = 0.0;
+
+    PooledJobs<LoopRegionJob> loopRegionJobs{ *backgroundPool };
+    juce::OwnedArray<LoopRegion> completedLoopRegions;
+
+    PooledJobs<LoadJob> loadJobs{ *backgroundPool };
+    std::atomic<int> loadGeneration{ 0 };
+    juce::CriticalSection loadResultLock;
+    std::unique_ptr<LoadResult> completedLoad;
+    std::unique_ptr<LoadResult> completedQueue;
+
+    PooledJobs<SeekIndexJob> indexJobs{ *backgroundPool };
+    juce::Array<IndexResult> completedIndexes;
+    int indexGeneration = 0;
+
+    PooledJobs<TrackAnalysisJob> analysisJobs{ *analysisPool };
+    juce::Array<OnsetResult> completedOnsets;
+    int onsetGeneration = 0;
+    bool autoOnsetMarkers = true;
+    juce::Array<BeatResult> completedBeatGrids;
+    int beatGeneration = 0;
+
+    juce::Array<WaveformResult> completedWaveforms;
+    std::shared_ptr<const WaveformPyramid> waveform;
+    int waveformGeneration = 0;
+
+    PooledJobs<LoudnessJob> loudnessJobs{ *backgroundPool };
+    juce::Array<LoudnessResult> completedLoudness;
+    bool normaliseLoudness = true;
+    double targetLoudness = -18.0;
+
+    std::atomic<int> queueGeneration{ 0 };
+    juce::File queuedFile;
+    Metadata queuedMetadata;
+    int queuedStreamSerial = 0;
+
     juce::File currentFile;
 
 
-    juce::AudioBuffer<float> audioSlice;
     bool sliceReady = false;
     double sliceStart = 0.0;
     double sliceEnd = 0.0;
+    std::unique_ptr<SliceExportJob> sliceExportJob;
+    std::function<void(bool)> sliceExportCallback;
+    std::unique_ptr<SliceExportJob::Result> completedExport;
+
+    PooledJobs<SliceExportJob> regionExportJobs{ *exportPool };
+    juce::Array<SliceExportJob::Result> completedRegionExports;
+    RegionExportSummary regionSummary;
+    std::function<void(const RegionExportSummary&)> regionExportCallback;
+    double regionExportStartMs = 0.0;
 
-    juce::Array<Marker> markers;
+    MarkerIndex markers;
+    MarkerIndex onsetMarkers;
 
     Metadata metadata;
 
-    void extractMetadata(juce::AudioFormatReader* reader, const juce::File& audioFile);
+    bool pushCommand(DeckCommand::Type type, double first = 0.0, double second = 0.0, bool flag = false);
+    bool sendCommand(const DeckCommand& command);
+    void flushOverflowCommands();
+    void pushSegmentState();
+    void applyPendingCommands();
+    void applyContinuousParameters();
+    void applyCommand(const DeckCommand& command);
+    void pushTimeStretchState();
+    double getResamplingRatio() const;
+    void updateResamplingRatio();
+    void resetRateConversion();
+    void startLoopRegionJob(juce::int64 startSample, juce::int64 endSample, int serial);
+    void loopRegionBuilt(std::unique_ptr<LoopRegion> region);
+    void applyLoopRegions(juce::OwnedArray<LoopRegion>& regions);
+    void releaseRetiredResources();
+
+    void loadFinished(std::unique_ptr<LoadResult> result);
+    void commitStream(std::unique_ptr<DeckStream> stream, const Metadata& newMetadata);
+    void commitQueuedStream(std::unique_ptr<DeckStream> stream, const Metadata& newMetadata);
+    void pushQueuedStream(DeckStream* stream, int serial);
+    void startSeekIndexJob(const DeckStream& stream);
+    void seekIndexFinished(int generation, const juce::File& file, std::shared_ptr<const SeekIndex> index);
+    void startTrackAnalysis();
+    void clearOnsetMarkers();
+    void onsetsFound(int generation, juce::Array<double> onsets);
+    void addOnsetMarkers(const juce::Array<OnsetResult>& results);
+    void beatGridFound(int generation, const BeatGrid& grid);
+    void clearWaveform();
+    void waveformBuilt(int generation, std::shared_ptr<const WaveformPyramid> newWaveform);
+    void startLoudnessJob(const DeckStream& stream);
+    void loudnessMeasured(const juce::File& file, const LoudnessMeter::Result& loudness);
+    void applyLoudnessResults(const juce::Array<LoudnessResult>& results);
+    void updateNormalisationGain(DeckStream& stream);
+    void handleTrackAdvanced();
+    SliceExportJob::ReaderFactory makeExportReaderFactory();
+    void handleRegionExportResults(const juce::Array<SliceExportJob::Result>& results);
+    void handleAsyncUpdate() override;
+    void timerCallback() override;
+
+    juce::AudioFormatReader* createDeckReader(const juce::File& file, IndexedSeekReader** seekReader = nullptr,
+        bool useSharedCache = true);
+    static Metadata extractMetadata(juce::AudioFormatReader* reader, const juce::File& audioFile);
     bool isValidAudioFile(const juce::File& file) const;
 };
\ No newline at end of file
@@ -15,6 +15,9 @@ PlayerGUI::PlayerGUI()
     metadataLabel.setText("No file loaded", juce::dontSendNotification);
     addAndMakeVisible(metadataLabel);
 
+    for (auto* meter : { &deck1Meter, &deck2Meter, &masterMeter })
+        addAndMakeVisible(meter);
+
 
     for (auto* button : { &loadButton, &loadSecondTrackButton, &stopButton })
     {
@@ -37,7 +40,7 @@ PlayerGUI::PlayerGUI()
         button->setAlpha(0.95f);
     }
 
-    for (auto* button : { &markerAButton, &markerBButton, &clearMarkersButton, &segmentLoopButton })
+    for (auto* button : { &markerAButton, &markerBButton, &clearMarkersButton, &segmentLoopButton, &onsetMarkersButton })
     {
         addAndMakeVisible(button);
         button->addListener(this);
@@ -82,6 +85,14 @@ PlayerGUI::PlayerGUI()
     deleteMarkerButton.setColour(juce::TextButton::textColourOnId, juce::Colours::white);
     deleteMarkerButton.setButtonText("Delete Marker");
 
+    addAndMakeVisible(exportRegionsButton);
+    exportRegionsButton.addListener(this);
+    exportRegionsButton.setColour(juce::TextButton::buttonColourId, accentColour);
+    exportRegionsButton.setColour(juce::TextButton::buttonOnColourId, activeColour);
+    exportRegionsButton.setColour(juce::TextButton::textColourOffId, textColour);
+    exportRegionsButton.setColour(juce::TextButton::textColourOnId, juce::Colours::white);
+    exportRegionsButton.setButtonText("Export Regions");
+
     addAndMakeVisible(markersList);
     markersList.setRowHeight(25);
     markersList.setColour(juce::ListBox::backgroundColourId, baseColour.withAlpha(0.7f));
@@ -121,6 +132,17 @@ PlayerGUI::PlayerGUI()
     speedLabel.setColour(juce::Label::textColourId, textColour);
     addAndMakeVisible(speedLabel);
 
+    speedModeBox.addItem("Varispeed", 1);
+    speedModeBox.addItem("Keep pitch (fast)", 2);
+    speedModeBox.addItem("Keep pitch (normal)", 3);
+    speedModeBox.addItem("Keep pitch (high)", 4);
+    speedModeBox.setSelectedId(1, juce::dontSendNotification);
+    speedModeBox.addListener(this);
+    speedModeBox.setColour(juce::ComboBox::backgroundColourId, baseColour);
+    speedModeBox.setColour(juce::ComboBox::textColourId, textColour);
+    speedModeBox.setColour(juce::ComboBox::arrowColourId, textColour);
+    addAndMakeVisible(speedModeBox);
+
     positionSlider.setRange(0.0, 1.0, 0.0001);
     positionSlider.setSliderStyle(juce::Slider::LinearHorizontal);
     positionSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
@@ -225,7 +247,7 @@ void PlayerGUI::resized()
     int abButtonHeight = 28;
     int abSpacing = 10;
 
-    int totalABWidth = (abButtonWidth + abSpacing) * 4 - abSpacing;
+    int totalABWidth = (abButtonWidth + abSpacing) * 5 - abSpacing;
     int abStartX = (abRow.getWidth() - totalABWidth) / 2;
 
     int abX = abStartX;
@@ -234,7 +256,8 @@ void PlayerGUI::resized()
     markerAButton.setBounds(abX, abY, abButtonWidth, abButtonHeight);        abX += abButtonWidth + abSpacing;
     markerBButton.setBounds(abX, abY, abButtonWidth, abButtonHeight);        abX += abButtonWidth + abSpacing;
     clearMarkersButton.setBounds(abX, abY, abButtonWidth, abButtonHeight);   abX += abButtonWidth + abSpacing;
-    segmentLoopButton.setBounds(abX, abY, abButtonWidth, abButtonHeight);
+    segmentLoopButton.setBounds(abX, abY, abButtonWidth, abButtonHeight);    abX += abButtonWidth + abSpacing;
+    onsetMarkersButton.setBounds(abX, abY, abButtonWidth, abButtonHeight);
 
     auto sliceRow = area.removeFromTop(35);
     sliceRow.reduce(margin, 0);
@@ -259,10 +282,18 @@ void PlayerGUI::resized()
     auto markersSection = area.removeFromTop(100);
     markersSection.reduce(margin, 4);
 
+    auto metersArea = markersSection.removeFromRight(120);
+    const int meterWidth = metersArea.getWidth() / 3;
+    deck1Meter.setBounds(metersArea.removeFromLeft(meterWidth).reduced(4, 0));
+    deck2Meter.setBounds(metersArea.removeFromLeft(meterWidth).reduced(4, 0));
+    masterMeter.setBounds(metersArea.reduced(4, 0));
+    markersSection.removeFromRight(margin);
+
     auto markerButtonsRow = markersSection.removeFromTop(28);
     int markerButtonWidth = 100;
     addMarkerButton.setBounds(markerButtonsRow.removeFromLeft(markerButtonWidth).reduced(2));
     deleteMarkerButton.setBounds(markerButtonsRow.removeFromLeft(markerButtonWidth).reduced(2));
+    exportRegionsButton.setBounds(markerButtonsRow.removeFromLeft(markerButtonWidth + 40).reduced(2));
 
     markersList.setBounds(markersSection.reduced(2));
 
@@ -284,6 +315,7 @@ void PlayerGUI::resized()
     auto speedArea = area.removeFromTop(35);
     speedArea.reduce(margin, 0);
     speedLabel.setBounds(speedArea.removeFromLeft(70));
+    speedModeBox.setBounds(speedArea.removeFromRight(170).reduced(2, 4));
     speedSlider.setBounds(speedArea);
 }
 
@@ -305,10 +337,12 @@ void PlayerGUI::buttonClicked(juce::Button* button)
     else if (button == &markerBButton)  listener->markerBButtonClicked();
     else if (button == &clearMarkersButton) listener->clearMarkersButtonClicked();
     else if (button == &segmentLoopButton) listener->segmentLoopButtonClicked();
+    else if (button == &onsetMarkersButton) listener->onsetMarkersButtonClicked();
     else if (button == &sliceButton)     listener->sliceButtonClicked();
     else if (button == &saveSliceButton) listener->saveSliceButtonClicked();
     else if (button == &addMarkerButton) listener->addMarkerButtonClicked();
     else if (button == &deleteMarkerButton) listener->deleteMarkerButtonClicked();
+    else if (button == &exportRegionsButton) listener->exportRegionsButtonClicked();
     else if (button == &loadPlaylistButton) listener->loadPlaylistButtonClicked();
     else if (button == &prevTrackButton) listener->prevTrackButtonClicked();
     else if (button == &nextTrackButton) listener->nextTrackButtonClicked();
@@ -432,8 +466,14 @@ void PlayerGUI::setSegmentLoopState(bool isActive)
     segmentLoopButton.setToggleState(isActive, juce::dontSendNotification);
 }
 
+void PlayerGUI::setOnsetMarkersState(bool isShown)
+{
+    onsetMarkersButton.setToggleState(isShown, juce::dontSendNotification);
+}
+
 void PlayerGUI::setSliceState(bool hasSlice)
 {
+    saveSliceButton.setButtonText("Save Slice");
     saveSliceButton.setEnabled(hasSlice);
     if (hasSlice)
     {
@@ -446,15 +486,47 @@ void PlayerGUI::setSliceState(bool hasSlice)
 }
 
 
+void PlayerGUI::setSliceExportProgress(float progress)
+{
+    saveSliceButton.setEnabled(true);
+    saveSliceButton.setButtonText("Cancel Export");
+    sliceInfoLabel.setText("Exporting slice... " + juce::String(juce::roundToInt(progress * 100.0f)) + "%",
+        juce::dontSendNotification);
+}
+
+void PlayerGUI::setRegionExportProgress(bool isExporting, float progress)
+{
+    exportRegionsButton.setButtonText(isExporting
+        ? "Cancel (" + juce::String(juce::roundToInt(progress * 100.0f)) + "%)"
+        : juce::String("Export Regions"));
+}
+
+void PlayerGUI::setSpeedMode(int modeId)
+{
+    speedModeBox.setSelectedId(modeId, juce::dontSendNotification);
+}
+
 void PlayerGUI::setMetadataDisplay(const juce::String& metadataText)
 {
     metadataLabel.setText(metadataText, juce::dontSendNotification);
 }
 
+bool PlayerGUI::updateMeters(LevelMeter& deck1, LevelMeter& deck2, LevelMeter& master)
+{
+    const bool deck1Moving = deck1Meter.update(deck1);
+    const bool deck2Moving = deck2Meter.update(deck2);
+    const bool masterMoving = masterMeter.update(master);
+    return deck1Moving || deck2Moving || masterMoving;
+}
+
 void PlayerGUI::comboBoxChanged(juce::ComboBox* comboBoxThatHasChanged)
 {
     if (comboBoxThatHasChanged == &playlistBox && listener)
     {
         listener->playlistBoxChanged(playlistBox.getSelectedId());
     }
+    else if (comboBoxThatHasChanged == &speedModeBox && listener)
+    {
+        listener->speedModeChanged(speedModeBox.getSelectedId());
+    }
 }
\ No newline at end of file
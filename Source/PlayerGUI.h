@@ -1,5 +1,6 @@
 #pragma once
 #include <JuceHeader.h>
+#include "LevelMeterComponent.h"
 
 class PlayerGUI : public juce::Component,
     public juce::Button::Listener,
@@ -21,6 +22,7 @@ public:
         virtual void muteButtonClicked() = 0;
         virtual void volumeChanged(float newVolume) = 0;
         virtual void speedChanged(float newSpeed) = 0;
+        virtual void speedModeChanged(int modeId) = 0;
         virtual void forwardButtonClicked() = 0;
         virtual void backwardButtonClicked() = 0;
         virtual void goToEndButtonClicked() = 0;
@@ -29,10 +31,12 @@ public:
         virtual void markerBButtonClicked() = 0;
         virtual void clearMarkersButtonClicked() = 0;
         virtual void segmentLoopButtonClicked() = 0;
+        virtual void onsetMarkersButtonClicked() = 0;
         virtual void sliceButtonClicked() = 0;
         virtual void saveSliceButtonClicked() = 0;
         virtual void addMarkerButtonClicked() = 0;
         virtual void deleteMarkerButtonClicked() = 0;
+        virtual void exportRegionsButtonClicked() = 0;
         virtual void jumpToMarker(int index) = 0;
 
         virtual void loadPlaylistButtonClicked() = 0;
@@ -45,6 +49,8 @@ public:
     ~PlayerGUI() override;
 
     void setSliceState(bool hasSlice);
+    void setSliceExportProgress(float progress);
+    void setRegionExportProgress(bool isExporting, float progress);
 
     void resized() override;
 
@@ -63,11 +69,17 @@ public:
     void setMarkerAState(bool isSet);
     void setMarkerBState(bool isSet);
     void setSegmentLoopState(bool isActive);
+    void setOnsetMarkersState(bool isShown);
+    void setSpeedMode(int modeId);
 
     juce::ListBox& getMarkersList() { return markersList; }
 
     void setMetadataDisplay(const juce::String& metadataText);
 
+    // Moves the level meters on; returns true while any is still falling
+    // back or showing a clip.
+    bool updateMeters(LevelMeter& deck1, LevelMeter& deck2, LevelMeter& master);
+
     void loadButtonIcons();
     juce::ComboBox& getPlaylistBox() { return playlistBox; }
 
@@ -88,6 +100,7 @@ private:
     juce::Label  volumeLabel{ "Volume" };
     juce::Slider speedSlider;
     juce::Label  speedLabel{ "Speed" };
+    juce::ComboBox speedModeBox;
 
     juce::Slider positionSlider;
     juce::Label currentTimeLabel;
@@ -104,6 +117,7 @@ private:
     juce::TextButton markerBButton{ "set B" };
     juce::TextButton clearMarkersButton{ "Clear" };
     juce::TextButton segmentLoopButton{ "A-B Loop" };
+    juce::TextButton onsetMarkersButton{ "Onsets" };
 
     juce::TextButton sliceButton{ "Create A-B Slice" };
     juce::TextButton saveSliceButton{ "Save Slice" };
@@ -111,8 +125,13 @@ private:
 
     juce::TextButton addMarkerButton{ "Add Marker" };
     juce::TextButton deleteMarkerButton{ "Delete Marker" };
+    juce::TextButton exportRegionsButton{ "Export Regions" };
     juce::ListBox markersList;
 
+    LevelMeterComponent deck1Meter{ "T1" };
+    LevelMeterComponent deck2Meter{ "T2" };
+    LevelMeterComponent masterMeter{ "Mix" };
+
     juce::Label metadataLabel;
 
 
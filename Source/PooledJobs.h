@@ -0,0 +1,69 @@
+#pragma once
+#include <JuceHeader.h>
+
+// The jobs of one kind that an owner has handed to a ThreadPool. The list
+// owns them but only deletes one once the pool has let go of it: finished
+// jobs are dropped whenever another is added, and removeAll() stops and
+// waits for the rest. Message thread only.
+template <typename JobType>
+class PooledJobs
+{
+public:
+    explicit PooledJobs(juce::ThreadPool& poolToUse)
+        : pool(poolToUse)
+    {
+    }
+
+    // The owner should have called removeAll() already, before anything the
+    // jobs report back to went away.
+    ~PooledJobs() { removeAll(); }
+
+    // Takes ownership and starts the job.
+    JobType* add(JobType* newJob)
+    {
+        removeFinished();
+        jobs.add(newJob);
+        pool.addJob(newJob, false);
+        return newJob;
+    }
+
+    void signalAll()
+    {
+        for (auto* job : jobs)
+            job->signalJobShouldExit();
+    }
+
+    // Asks every job to stop without waiting; each is dropped once it has.
+    void interruptAll()
+    {
+        for (auto* job : jobs)
+            pool.removeJob(job, true, 0);
+    }
+
+    void removeFinished()
+    {
+        for (int i = jobs.size(); --i >= 0;)
+            if (!pool.contains(jobs.getUnchecked(i)))
+                jobs.remove(i);
+    }
+
+    void removeAll(int timeoutMs = 10000)
+    {
+        for (auto* job : jobs)
+            pool.removeJob(job, true, timeoutMs);
+
+        jobs.clear();
+    }
+
+    bool isEmpty() const { return jobs.isEmpty(); }
+    int size() const { return jobs.size(); }
+
+    JobType** begin() const noexcept { return jobs.begin(); }
+    JobType** end() const noexcept { return jobs.end(); }
+
+private:
+    juce::ThreadPool& pool;
+    juce::OwnedArray<JobType> jobs;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PooledJobs)
+};
@@ -0,0 +1,244 @@
+#include "ReadAheadSource.h"
+
+namespace
+{
+    constexpr int maxChunkSize = 4096;
+    constexpr int minChunkSize = 1024;
+    constexpr int idleWaitMs = 10;
+    constexpr int seekPollMs = 1;
+    constexpr juce::uint32 seekWatchMs = 100;
+}
+
+ReadAheadSource::ReadAheadSource(juce::PositionableAudioSource* sourceToUse,
+    bool deleteSourceWhenDeleted,
+    juce::TimeSliceThread& thread,
+    int numChannels,
+    int bufferSizeSamples)
+    : source(sourceToUse, deleteSourceWhenDeleted),
+    backgroundThread(thread),
+    numberOfChannels(numChannels),
+    bufferSize(bufferSizeSamples)
+{
+    jassert(source != nullptr);
+    jassert(bufferSize > maxChunkSize);
+}
+
+ReadAheadSource::~ReadAheadSource()
+{
+    releaseResources();
+}
+
+void ReadAheadSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    backgroundThread.removeTimeSliceClient(this);
+
+    source->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    buffer.setSize(numberOfChannels, juce::jmax(bufferSize, samplesPerBlockExpected * 2));
+    buffer.clear();
+
+    bufferValidStart = 0;
+    bufferValidEnd = 0;
+    wasSourceLooping = source->isLooping();
+    seekPending = true;
+    isPrepared = true;
+
+    backgroundThread.addTimeSliceClient(this);
+}
+
+void ReadAheadSource::releaseResources()
+{
+    backgroundThread.removeTimeSliceClient(this);
+
+    if (isPrepared)
+        source->releaseResources();
+
+    buffer.setSize(numberOfChannels, 0);
+    isPrepared = false;
+}
+
+void ReadAheadSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const juce::SpinLock::ScopedLockType sl(bufferLock);
+
+    auto start = nextPlayPos.load();
+    const auto end = start + bufferToFill.numSamples;
+    const int validStart = (int)(juce::jlimit(bufferValidStart, bufferValidEnd, start) - start);
+    const int validEnd = (int)(juce::jlimit(bufferValidStart, bufferValidEnd, end) - start);
+
+    if (validStart > 0 || validEnd < bufferToFill.numSamples)
+    {
+        if (!seekPending)
+            ++underruns;
+    }
+    else
+    {
+        seekPending = false;
+    }
+
+    if (validStart >= validEnd)
+    {
+        bufferToFill.clearActiveBufferRegion();
+    }
+    else
+    {
+        if (validStart > 0)
+            bufferToFill.buffer->clear(bufferToFill.startSample, validStart);
+
+        if (validEnd < bufferToFill.numSamples)
+            bufferToFill.buffer->clear(bufferToFill.startSample + validEnd, bufferToFill.numSamples - validEnd);
+
+        const int size = buffer.getNumSamples();
+        const int numValid = validEnd - validStart;
+        const int startIndex = (int)((start + validStart) % size);
+        const int firstPart = juce::jmin(numValid, size - startIndex);
+
+        for (int chan = 0; chan < bufferToFill.buffer->getNumChannels(); ++chan)
+        {
+            const int sourceChan = juce::jmin(chan, buffer.getNumChannels() - 1);
+            const int destStart = bufferToFill.startSample + validStart;
+
+            bufferToFill.buffer->copyFrom(chan, destStart, buffer, sourceChan, startIndex, firstPart);
+
+            if (firstPart < numValid)
+                bufferToFill.buffer->copyFrom(chan, destStart + firstPart, buffer, sourceChan, 0, numValid - firstPart);
+        }
+    }
+
+    nextPlayPos.compare_exchange_strong(start, start + bufferToFill.numSamples);
+}
+
+void ReadAheadSource::setNextReadPosition(juce::int64 newPosition)
+{
+    nextPlayPos = newPosition;
+    seekPending = true;
+}
+
+void ReadAheadSource::expectSeek()
+{
+    seekExpectedUntilMs = juce::Time::getMillisecondCounter() + seekWatchMs;
+    backgroundThread.moveToFrontOfQueue(this);
+}
+
+juce::int64 ReadAheadSource::getNextReadPosition() const
+{
+    const auto pos = nextPlayPos.load();
+    const auto length = source->getTotalLength();
+
+    return (source->isLooping() && length > 0 && pos > 0) ? pos % length : pos;
+}
+
+ReadAheadSource::Stats ReadAheadSource::getStats() const
+{
+    Stats stats;
+    stats.underruns = underruns.load();
+
+    const juce::SpinLock::ScopedLockType sl(bufferLock);
+
+    const auto pos = nextPlayPos.load();
+    stats.bufferSize = buffer.getNumSamples();
+    stats.bufferedSamples = (pos >= bufferValidStart && pos < bufferValidEnd) ? (int)(bufferValidEnd - pos) : 0;
+    stats.fillLevel = stats.bufferSize > 0 ? (float)stats.bufferedSamples / (float)stats.bufferSize : 0.0f;
+    return stats;
+}
+
+bool ReadAheadSource::waitForBufferedSamples(int numSamples, int timeoutMs)
+{
+    const auto deadline = juce::Time::getMillisecondCounter() + (juce::uint32)timeoutMs;
+
+    while (getStats().bufferedSamples < numSamples)
+    {
+        const auto now = juce::Time::getMillisecondCounter();
+        if (now >= deadline)
+            return false;
+
+        bufferReadyEvent.wait((int)(deadline - now));
+    }
+
+    return true;
+}
+
+int ReadAheadSource::useTimeSlice()
+{
+    if (readNextChunk())
+        return 1;
+
+    // The audio thread applies a queued seek on its next block, which may be
+    // after this slice; look again shortly rather than idling past it.
+    const bool seekExpected = (juce::int32)(seekExpectedUntilMs.load() - juce::Time::getMillisecondCounter()) > 0;
+    return seekExpected ? seekPollMs : idleWaitMs;
+}
+
+bool ReadAheadSource::readNextChunk()
+{
+    const int size = buffer.getNumSamples();
+
+    if (size == 0)
+        return false;
+
+    juce::int64 sectionStart = 0, sectionEnd = 0;
+
+    {
+        const juce::SpinLock::ScopedLockType sl(bufferLock);
+
+        if (wasSourceLooping != source->isLooping())
+        {
+            wasSourceLooping = source->isLooping();
+            bufferValidStart = 0;
+            bufferValidEnd = 0;
+        }
+
+        const auto playPos = juce::jmax((juce::int64)0, nextPlayPos.load());
+        const auto wantedEnd = playPos + size - 4;
+
+        if (playPos < bufferValidStart || playPos >= bufferValidEnd)
+        {
+            // The playhead has left the buffered range, so start again from it.
+            sectionStart = playPos;
+            sectionEnd = juce::jmin(wantedEnd, playPos + maxChunkSize);
+            bufferValidStart = playPos;
+            bufferValidEnd = playPos;
+        }
+        else if (wantedEnd - bufferValidEnd >= minChunkSize)
+        {
+            sectionStart = bufferValidEnd;
+            sectionEnd = juce::jmin(wantedEnd, bufferValidEnd + maxChunkSize);
+
+            // The slots about to be written still hold samples from one lap
+            // earlier; stop handing those out before overwriting them.
+            bufferValidStart = juce::jmax(bufferValidStart, sectionEnd - size);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    const int startIndex = (int)(sectionStart % size);
+    const int numSamples = (int)(sectionEnd - sectionStart);
+    const int firstPart = juce::jmin(numSamples, size - startIndex);
+
+    readBufferSection(sectionStart, firstPart, startIndex);
+
+    if (firstPart < numSamples)
+        readBufferSection(sectionStart + firstPart, numSamples - firstPart, 0);
+
+    {
+        const juce::SpinLock::ScopedLockType sl(bufferLock);
+
+        if (bufferValidEnd == sectionStart)
+            bufferValidEnd = sectionEnd;
+    }
+
+    bufferReadyEvent.signal();
+    return true;
+}
+
+void ReadAheadSource::readBufferSection(juce::int64 start, int length, int bufferOffset)
+{
+    if (source->getNextReadPosition() != start)
+        source->setNextReadPosition(start);
+
+    juce::AudioSourceChannelInfo info(&buffer, bufferOffset, length);
+    source->getNextAudioBlock(info);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <JuceHeader.h>
+
+class SharedReadAheadThread : public juce::TimeSliceThread
+{
+public:
+    SharedReadAheadThread() : juce::TimeSliceThread("Deck read-ahead")
+    {
+        startThread(juce::Thread::Priority::high);
+    }
+
+    ~SharedReadAheadThread() override
+    {
+        stopThread(2000);
+    }
+};
+
+class ReadAheadSource : public juce::PositionableAudioSource,
+    private juce::TimeSliceClient
+{
+public:
+    struct Stats
+    {
+        int underruns = 0;
+        int bufferedSamples = 0;
+        int bufferSize = 0;
+        float fillLevel = 0.0f;
+    };
+
+    ReadAheadSource(juce::PositionableAudioSource* sourceToUse,
+        bool deleteSourceWhenDeleted,
+        juce::TimeSliceThread& thread,
+        int numChannels,
+        int bufferSizeSamples);
+    ~ReadAheadSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+
+    // Message thread: a seek is queued for the audio thread. Wakes the
+    // background thread and has it poll briefly instead of idling, so it
+    // starts reading as soon as the new position lands.
+    void expectSeek();
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override { return source->getTotalLength(); }
+    bool isLooping() const override { return source->isLooping(); }
+    void setLooping(bool shouldLoop) override { source->setLooping(shouldLoop); }
+
+    Stats getStats() const;
+    void resetStats() { underruns = 0; }
+    bool waitForBufferedSamples(int numSamples, int timeoutMs);
+
+private:
+    juce::OptionalScopedPointer<juce::PositionableAudioSource> source;
+    juce::TimeSliceThread& backgroundThread;
+    int numberOfChannels;
+    int bufferSize;
+
+    juce::AudioBuffer<float> buffer;
+    juce::SpinLock bufferLock;
+    juce::int64 bufferValidStart = 0;
+    juce::int64 bufferValidEnd = 0;
+    std::atomic<juce::int64> nextPlayPos{ 0 };
+    bool wasSourceLooping = false;
+    bool isPrepared = false;
+
+    std::atomic<int> underruns{ 0 };
+    std::atomic<bool> seekPending{ true };
+    std::atomic<juce::uint32> seekExpectedUntilMs{ 0 };
+    juce::WaitableEvent bufferReadyEvent;
+
+    int useTimeSlice() override;
+    bool readNextChunk();
+    void readBufferSection(juce::int64 start, int length, int bufferOffset);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ReadAheadSource)
+};
@@ -0,0 +1,169 @@
+#include "RealFft.h"
+#include "SimdKernels.h"
+
+namespace
+{
+    // One run of radix-2 butterflies: (a, b) -> (a + w b, a - w b).
+    void butterflies(float* aRe, float* aIm, float* bRe, float* bIm, const float* wRe, const float* wIm, int count) noexcept
+    {
+        int j = 0;
+
+       #if AUDIO_SIMD_SSE
+        for (; j + 4 <= count; j += 4)
+        {
+            const __m128 br = _mm_loadu_ps(bRe + j), bi = _mm_loadu_ps(bIm + j);
+            const __m128 wr = _mm_loadu_ps(wRe + j), wi = _mm_loadu_ps(wIm + j);
+            const __m128 ar = _mm_loadu_ps(aRe + j), ai = _mm_loadu_ps(aIm + j);
+            const __m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+            const __m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+
+            _mm_storeu_ps(bRe + j, _mm_sub_ps(ar, tr));
+            _mm_storeu_ps(bIm + j, _mm_sub_ps(ai, ti));
+            _mm_storeu_ps(aRe + j, _mm_add_ps(ar, tr));
+            _mm_storeu_ps(aIm + j, _mm_add_ps(ai, ti));
+        }
+       #elif AUDIO_SIMD_NEON
+        for (; j + 4 <= count; j += 4)
+        {
+            const float32x4_t br = vld1q_f32(bRe + j), bi = vld1q_f32(bIm + j);
+            const float32x4_t wr = vld1q_f32(wRe + j), wi = vld1q_f32(wIm + j);
+            const float32x4_t ar = vld1q_f32(aRe + j), ai = vld1q_f32(aIm + j);
+            const float32x4_t tr = vmlsq_f32(vmulq_f32(br, wr), bi, wi);
+            const float32x4_t ti = vmlaq_f32(vmulq_f32(br, wi), bi, wr);
+
+            vst1q_f32(bRe + j, vsubq_f32(ar, tr));
+            vst1q_f32(bIm + j, vsubq_f32(ai, ti));
+            vst1q_f32(aRe + j, vaddq_f32(ar, tr));
+            vst1q_f32(aIm + j, vaddq_f32(ai, ti));
+        }
+       #endif
+
+        for (; j < count; ++j)
+        {
+            const float tr = bRe[j] * wRe[j] - bIm[j] * wIm[j];
+            const float ti = bRe[j] * wIm[j] + bIm[j] * wRe[j];
+
+            bRe[j] = aRe[j] - tr;
+            bIm[j] = aIm[j] - ti;
+            aRe[j] += tr;
+            aIm[j] += ti;
+        }
+    }
+}
+
+RealFft::RealFft(int order)
+    : size(1 << juce::jlimit(2, 20, order)),
+    half(size / 2),
+    bitReversed((size_t)half),
+    unpackRe((size_t)half),
+    unpackIm((size_t)half),
+    workRe((size_t)half),
+    workIm((size_t)half)
+{
+    int bits = 0;
+    while ((1 << bits) < half)
+        ++bits;
+
+    for (int i = 0; i < half; ++i)
+    {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b)
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+
+        bitReversed[(size_t)i] = reversed;
+    }
+
+    // The first two stages have trivial twiddles and are done by hand.
+    for (int length = 8; length <= half; length <<= 1)
+    {
+        for (int j = 0; j < length / 2; ++j)
+        {
+            const double angle = -juce::MathConstants<double>::twoPi * j / length;
+            twiddleRe.push_back((float)std::cos(angle));
+            twiddleIm.push_back((float)std::sin(angle));
+        }
+    }
+
+    for (int k = 0; k < half; ++k)
+    {
+        const double angle = -juce::MathConstants<double>::twoPi * k / size;
+        unpackRe[(size_t)k] = (float)std::cos(angle);
+        unpackIm[(size_t)k] = (float)std::sin(angle);
+    }
+}
+
+void RealFft::perform(const float* input, float* output)
+{
+    auto* re = workRe.data();
+    auto* im = workIm.data();
+
+    // Even samples go in the real parts and odd ones in the imaginary parts.
+    for (int i = 0; i < half; ++i)
+    {
+        const int target = bitReversed[(size_t)i];
+        re[target] = input[2 * i];
+        im[target] = input[2 * i + 1];
+    }
+
+    // Lengths 2 and 4 together: twiddles of 1 and -i.
+    if (half >= 4)
+    {
+        for (int i = 0; i < half; i += 4)
+        {
+            const float r0 = re[i] + re[i + 1], i0 = im[i] + im[i + 1];
+            const float r1 = re[i] - re[i + 1], i1 = im[i] - im[i + 1];
+            const float r2 = re[i + 2] + re[i + 3], i2 = im[i + 2] + im[i + 3];
+            const float r3 = re[i + 2] - re[i + 3], i3 = im[i + 2] - im[i + 3];
+
+            re[i] = r0 + r2;
+            im[i] = i0 + i2;
+            re[i + 2] = r0 - r2;
+            im[i + 2] = i0 - i2;
+            re[i + 1] = r1 + i3;
+            im[i + 1] = i1 - r3;
+            re[i + 3] = r1 - i3;
+            im[i + 3] = i1 + r3;
+        }
+    }
+    else
+    {
+        const float r = re[0], i = im[0];
+        re[0] = r + re[1];
+        im[0] = i + im[1];
+        re[1] = r - re[1];
+        im[1] = i - im[1];
+    }
+
+    const float* wRe = twiddleRe.data();
+    const float* wIm = twiddleIm.data();
+
+    for (int length = 8; length <= half; length <<= 1)
+    {
+        const int halfLength = length / 2;
+
+        for (int start = 0; start < half; start += length)
+            butterflies(re + start, im + start, re + start + halfLength, im + start + halfLength, wRe, wIm, halfLength);
+
+        wRe += halfLength;
+        wIm += halfLength;
+    }
+
+    // Separate the spectra of the even and odd samples and combine them.
+    output[0] = re[0] + im[0];
+    output[1] = 0.0f;
+    output[2 * half] = re[0] - im[0];
+    output[2 * half + 1] = 0.0f;
+
+    for (int k = 1; k < half; ++k)
+    {
+        const float evenRe = 0.5f * (re[k] + re[half - k]);
+        const float evenIm = 0.5f * (im[k] - im[half - k]);
+        const float oddRe = 0.5f * (im[k] + im[half - k]);
+        const float oddIm = -0.5f * (re[k] - re[half - k]);
+
+        const float wr = unpackRe[(size_t)k];
+        const float wi = unpackIm[(size_t)k];
+        output[2 * k] = evenRe + oddRe * wr - oddIm * wi;
+        output[2 * k + 1] = evenIm + oddRe * wi + oddIm * wr;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+// Forward FFT of real input, for the analysis jobs and the spectrum display.
+// The input is packed into a complex FFT of half the size and unpacked
+// afterwards, so a transform costs roughly half of a complex one. Not
+// normalised. Holds its own scratch space: one instance per thread.
+class RealFft
+{
+public:
+    // The size is 1 << order; order must be at least 2.
+    explicit RealFft(int order);
+
+    int getSize() const { return size; }
+    int getNumBins() const { return size / 2 + 1; }
+
+    // Reads getSize() samples and writes getNumBins() (re, im) pairs, so
+    // output needs room for 2 * getNumBins() floats.
+    void perform(const float* input, float* output);
+
+private:
+    const int size;
+    const int half;
+    std::vector<int> bitReversed;
+
+    // Stage by stage, so each stage's butterflies read their twiddles in
+    // order and vectorise.
+    std::vector<float> twiddleRe, twiddleIm;
+    std::vector<float> unpackRe, unpackIm;
+    std::vector<float> workRe, workIm;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RealFft)
+};
@@ -0,0 +1,513 @@
+#include "SeekIndex.h"
+#include "SidecarCache.h"
+
+namespace
+{
+    constexpr int cacheVersion = 1;
+    constexpr int resyncLimit = 1 << 16;
+
+    juce::int64 getId3v2Size(juce::InputStream& in)
+    {
+        juce::uint8 header[10] = {};
+        in.setPosition(0);
+
+        if (in.read(header, 10) != 10 || header[0] != 'I' || header[1] != 'D' || header[2] != '3')
+            return 0;
+
+        const juce::int64 size = ((juce::int64)(header[6] & 0x7f) << 21) | ((header[7] & 0x7f) << 14)
+            | ((header[8] & 0x7f) << 7) | (header[9] & 0x7f);
+
+        return 10 + size + ((header[5] & 0x10) != 0 ? 10 : 0);
+    }
+
+    //==========================================================================
+    struct Mp3FrameHeader
+    {
+        int frameBytes = 0;
+        int samplesPerFrame = 0;
+        int sampleRate = 0;
+        int sideInfoSize = 0;
+    };
+
+    bool parseMp3Header(const juce::uint8* h, Mp3FrameHeader& header)
+    {
+        static const int mpeg1Bitrates[] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+        static const int mpeg2Bitrates[] = { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 };
+        static const int sampleRates[3][3] = { { 11025, 12000, 8000 }, { 22050, 24000, 16000 }, { 44100, 48000, 32000 } };
+
+        if (h[0] != 0xff || (h[1] & 0xe0) != 0xe0)
+            return false;
+
+        const int version = (h[1] >> 3) & 0x03;
+        const int layer = (h[1] >> 1) & 0x03;
+        const int bitrateIndex = h[2] >> 4;
+        const int sampleRateIndex = (h[2] >> 2) & 0x03;
+
+        // Layer III only; version 1 and the 0/15 bitrate codes are reserved or free-format.
+        if (version == 1 || layer != 1 || bitrateIndex == 0 || bitrateIndex == 15 || sampleRateIndex == 3)
+            return false;
+
+        const bool isMpeg1 = version == 3;
+        const bool isMono = ((h[3] >> 6) & 0x03) == 3;
+        const int bitrate = (isMpeg1 ? mpeg1Bitrates : mpeg2Bitrates)[bitrateIndex] * 1000;
+
+        header.sampleRate = sampleRates[version == 0 ? 0 : version - 1][sampleRateIndex];
+        header.samplesPerFrame = isMpeg1 ? 1152 : 576;
+        header.frameBytes = (header.samplesPerFrame / 8) * bitrate / header.sampleRate + ((h[2] >> 1) & 0x01);
+        header.sideInfoSize = isMpeg1 ? (isMono ? 17 : 32) : (isMono ? 9 : 17);
+        return true;
+    }
+
+    // Finds the next position where a frame header is followed by another one
+    // at the expected distance, which rules out most false syncs in audio data.
+    juce::int64 findMp3Frame(juce::InputStream& in, juce::int64 start, int sampleRate, Mp3FrameHeader& header)
+    {
+        juce::uint8 h[4];
+
+        for (auto pos = start; pos < start + resyncLimit; ++pos)
+        {
+            if (!in.setPosition(pos) || in.read(h, 4) != 4)
+                return -1;
+
+            if (!parseMp3Header(h, header) || (sampleRate != 0 && header.sampleRate != sampleRate))
+                continue;
+
+            Mp3FrameHeader next;
+            if (in.setPosition(pos + header.frameBytes) && in.read(h, 4) == 4
+                && parseMp3Header(h, next) && next.sampleRate == header.sampleRate)
+                return pos;
+        }
+
+        return -1;
+    }
+
+    bool isInfoFrame(juce::InputStream& in, juce::int64 framePos, const Mp3FrameHeader& header)
+    {
+        char tag[4] = {};
+
+        if (in.setPosition(framePos + 4 + header.sideInfoSize) && in.read(tag, 4) == 4
+            && (std::memcmp(tag, "Xing", 4) == 0 || std::memcmp(tag, "Info", 4) == 0))
+            return true;
+
+        return in.setPosition(framePos + 36) && in.read(tag, 4) == 4 && std::memcmp(tag, "VBRI", 4) == 0;
+    }
+
+    // Position of the first frame that decodes to audio, or -1.
+    juce::int64 findFirstMp3AudioFrame(juce::InputStream& in, Mp3FrameHeader& header)
+    {
+        auto pos = findMp3Frame(in, getId3v2Size(in), 0, header);
+
+        // Decoders skip the Xing/VBRI frame, so it takes no place in the timeline.
+        if (pos >= 0 && isInfoFrame(in, pos, header))
+            pos += header.frameBytes;
+
+        return pos;
+    }
+
+    std::unique_ptr<SeekIndex> buildMp3Index(juce::InputStream& in, const std::function<bool()>& shouldExit)
+    {
+        Mp3FrameHeader header;
+        auto pos = findFirstMp3AudioFrame(in, header);
+        if (pos < 0)
+            return nullptr;
+
+        auto index = std::make_unique<SeekIndex>();
+        index->format = SeekIndex::Format::mp3;
+        index->preRollSamples = 2 * header.samplesPerFrame;
+
+        const int sampleRate = header.sampleRate;
+
+        juce::int64 samples = 0;
+        juce::int64 nextEntry = 0;
+        juce::uint8 h[4];
+
+        for (int frame = 0;; ++frame)
+        {
+            if ((frame & 1023) == 0 && shouldExit())
+                return nullptr;
+
+            if (!in.setPosition(pos) || in.read(h, 4) != 4)
+                break;
+
+            if (!parseMp3Header(h, header) || header.sampleRate != sampleRate)
+            {
+                pos = findMp3Frame(in, pos + 1, sampleRate, header);
+                if (pos < 0)
+                    break;
+            }
+
+            if (samples >= nextEntry)
+            {
+                index->entries.add({ samples, pos });
+                nextEntry += sampleRate;
+            }
+
+            samples += header.samplesPerFrame;
+            pos += header.frameBytes;
+        }
+
+        index->totalSamples = samples;
+        return index;
+    }
+
+    //==========================================================================
+    juce::uint8 crc8(const juce::uint8* data, int length)
+    {
+        juce::uint8 crc = 0;
+
+        for (int i = 0; i < length; ++i)
+        {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (juce::uint8)((crc & 0x80) != 0 ? (crc << 1) ^ 0x07 : crc << 1);
+        }
+
+        return crc;
+    }
+
+    struct FlacFrameHeader
+    {
+        int headerBytes = 0;
+        int blockSize = 0;
+        juce::int64 number = 0;
+        bool variableBlockSize = false;
+    };
+
+    // Parses and CRC-checks a frame header; `available` bounds the bytes at h.
+    bool parseFlacHeader(const juce::uint8* h, int available, FlacFrameHeader& header)
+    {
+        if (available < 16 || h[0] != 0xff || (h[1] & 0xfe) != 0xf8)
+            return false;
+
+        const int blockSizeCode = h[2] >> 4;
+        const int sampleRateCode = h[2] & 0x0f;
+        const int channelCode = h[3] >> 4;
+        const int sampleSizeCode = (h[3] >> 1) & 0x07;
+
+        if (blockSizeCode == 0 || sampleRateCode == 15 || channelCode > 10 || sampleSizeCode == 3 || (h[3] & 0x01) != 0)
+            return false;
+
+        // The frame or sample number is UTF-8 style coded.
+        int pos = 4;
+        juce::int64 number = h[pos];
+        int extraBytes = 0;
+
+        if (number >= 0x80)
+        {
+            if ((number & 0xc0) != 0xc0 || number == 0xff)
+                return false;
+
+            while ((number << (extraBytes + 1)) & 0x80)
+                ++extraBytes;
+
+            number &= 0x7f >> (extraBytes + 1);
+
+            for (int i = 1; i <= extraBytes; ++i)
+            {
+                if ((h[pos + i] & 0xc0) != 0x80)
+                    return false;
+
+                number = (number << 6) | (h[pos + i] & 0x3f);
+            }
+        }
+
+        pos += 1 + extraBytes;
+
+        if (blockSizeCode == 1)
+            header.blockSize = 192;
+        else if (blockSizeCode <= 5)
+            header.blockSize = 576 << (blockSizeCode - 2);
+        else if (blockSizeCode == 6)
+            header.blockSize = h[pos++] + 1;
+        else if (blockSizeCode == 7)
+        {
+            header.blockSize = ((h[pos] << 8) | h[pos + 1]) + 1;
+            pos += 2;
+        }
+        else
+            header.blockSize = 256 << (blockSizeCode - 8);
+
+        if (sampleRateCode == 12)
+            pos += 1;
+        else if (sampleRateCode == 13 || sampleRateCode == 14)
+            pos += 2;
+
+        if (crc8(h, pos) != h[pos])
+            return false;
+
+        header.headerBytes = pos + 1;
+        header.number = number;
+        header.variableBlockSize = (h[1] & 0x01) != 0;
+        return true;
+    }
+
+    std::unique_ptr<SeekIndex> buildFlacIndex(juce::InputStream& in, const std::function<bool()>& shouldExit)
+    {
+        auto pos = getId3v2Size(in);
+        char magic[4] = {};
+
+        if (!in.setPosition(pos) || in.read(magic, 4) != 4 || std::memcmp(magic, "fLaC", 4) != 0)
+            return nullptr;
+
+        juce::uint8 streamInfo[34] = {};
+        bool hasStreamInfo = false;
+
+        for (bool isLast = false; !isLast;)
+        {
+            juce::uint8 blockHeader[4];
+            if (in.read(blockHeader, 4) != 4)
+                return nullptr;
+
+            isLast = (blockHeader[0] & 0x80) != 0;
+            const int type = blockHeader[0] & 0x7f;
+            const int length = (blockHeader[1] << 16) | (blockHeader[2] << 8) | blockHeader[3];
+
+            if (type == 0 && length == 34)
+            {
+                if (in.read(streamInfo, 34) != 34)
+                    return nullptr;
+
+                hasStreamInfo = true;
+            }
+            else if (!in.setPosition(in.getPosition() + length))
+            {
+                return nullptr;
+            }
+        }
+
+        if (!hasStreamInfo)
+            return nullptr;
+
+        const int maxBlockSize = (streamInfo[2] << 8) | streamInfo[3];
+        const int sampleRate = (streamInfo[10] << 12) | (streamInfo[11] << 4) | (streamInfo[12] >> 4);
+        const juce::int64 totalSamples = ((juce::int64)(streamInfo[13] & 0x0f) << 32)
+            | ((juce::int64)streamInfo[14] << 24) | (streamInfo[15] << 16) | (streamInfo[16] << 8) | streamInfo[17];
+
+        if (sampleRate <= 0)
+            return nullptr;
+
+        auto index = std::make_unique<SeekIndex>();
+        index->format = SeekIndex::Format::flac;
+        index->totalSamples = totalSamples;
+
+        const juce::uint8 streamInfoHeader[] = { 'f', 'L', 'a', 'C', 0x80, 0x00, 0x00, 34 };
+        index->streamHeader.append(streamInfoHeader, sizeof(streamInfoHeader));
+        index->streamHeader.append(streamInfo, sizeof(streamInfo));
+
+        // Frames carry no length, so scan every byte for a sync code; a
+        // candidate only counts if its CRC matches and it starts exactly where
+        // the previous frame's samples end.
+        constexpr int chunkSize = 1 << 20;
+        constexpr int overlap = 32;
+        juce::HeapBlock<juce::uint8> buffer(chunkSize + overlap);
+        juce::int64 bufferStart = in.getPosition();
+        int bufferFill = 0;
+        juce::int64 expectedSample = 0;
+        juce::int64 nextEntry = 0;
+
+        for (;;)
+        {
+            if (shouldExit())
+                return nullptr;
+
+            const int bytesRead = in.read(buffer + bufferFill, chunkSize);
+            if (bytesRead <= 0)
+                break;
+
+            bufferFill += bytesRead;
+            const bool atEnd = in.isExhausted();
+            const int scanEnd = atEnd ? bufferFill : bufferFill - overlap;
+            int i = 0;
+
+            while (i < scanEnd)
+            {
+                FlacFrameHeader header;
+
+                if (buffer[i] == 0xff && parseFlacHeader(buffer + i, bufferFill - i, header))
+                {
+                    const auto sample = header.variableBlockSize ? header.number : header.number * maxBlockSize;
+
+                    if (sample == expectedSample)
+                    {
+                        if (sample >= nextEntry)
+                        {
+                            index->entries.add({ sample, bufferStart + i });
+                            nextEntry += sampleRate;
+                        }
+
+                        expectedSample = sample + header.blockSize;
+                        i += header.headerBytes;
+                        continue;
+                    }
+                }
+
+                ++i;
+            }
+
+            if (atEnd)
+                break;
+
+            std::memmove(buffer, buffer + i, (size_t)(bufferFill - i));
+            bufferStart += i;
+            bufferFill -= i;
+        }
+
+        if (index->totalSamples <= 0)
+            index->totalSamples = expectedSample;
+
+        if (index->entries.isEmpty())
+            return nullptr;
+
+        return index;
+    }
+}
+
+//==============================================================================
+const SeekIndex::Entry* SeekIndex::findEntryBefore(juce::int64 sample) const
+{
+    auto* begin = entries.begin();
+    auto* end = entries.end();
+    auto* it = std::upper_bound(begin, end, sample, [](juce::int64 s, const Entry& e) { return s < e.sample; });
+
+    return it == begin ? nullptr : it - 1;
+}
+
+bool SeekIndex::findMp3FrameRange(juce::InputStream& in, const SeekIndex* index, juce::int64 startSample,
+    juce::int64 endSample, Mp3FrameRange& range)
+{
+    Mp3FrameHeader header;
+    auto pos = findFirstMp3AudioFrame(in, header);
+    if (pos < 0 || endSample <= startSample)
+        return false;
+
+    const int sampleRate = header.sampleRate;
+    juce::int64 samples = 0;
+
+    // Entries are frame starts, so the walk can begin at the last one before the cut.
+    if (index != nullptr && index->format == Format::mp3)
+    {
+        if (auto* entry = index->findEntryBefore(startSample))
+        {
+            samples = entry->sample;
+            pos = entry->byteOffset;
+        }
+    }
+
+    range = {};
+    range.startByte = -1;
+    juce::uint8 h[4];
+
+    for (;;)
+    {
+        if (!in.setPosition(pos) || in.read(h, 4) != 4)
+            break;
+
+        if (!parseMp3Header(h, header) || header.sampleRate != sampleRate)
+        {
+            const auto next = findMp3Frame(in, pos + 1, sampleRate, header);
+            if (next < 0)
+                break;
+
+            pos = next;
+        }
+
+        if (range.startByte < 0 && samples + header.samplesPerFrame > startSample)
+        {
+            range.startByte = pos;
+            range.firstSample = samples;
+        }
+
+        if (samples >= endSample)
+            break;
+
+        samples += header.samplesPerFrame;
+        pos += header.frameBytes;
+    }
+
+    if (range.startByte < 0)
+        return false;
+
+    // The last frame may be cut short by the end of the file.
+    range.endByte = juce::jmin(pos, in.getTotalLength());
+    range.numSamples = samples - range.firstSample;
+    return range.endByte > range.startByte;
+}
+
+bool SeekIndex::canIndex(const juce::File& file)
+{
+    return file.hasFileExtension("mp3") || file.hasFileExtension("flac");
+}
+
+std::unique_ptr<SeekIndex> SeekIndex::build(const juce::File& file, const std::function<bool()>& shouldExit)
+{
+    juce::FileInputStream fileStream(file);
+    if (!fileStream.openedOk())
+        return nullptr;
+
+    juce::BufferedInputStream in(fileStream, 1 << 16);
+
+    if (file.hasFileExtension("mp3"))
+        return buildMp3Index(in, shouldExit);
+
+    if (file.hasFileExtension("flac"))
+        return buildFlacIndex(in, shouldExit);
+
+    return nullptr;
+}
+
+std::unique_ptr<SeekIndex> SeekIndex::loadFromCache(const juce::File& file)
+{
+    juce::MemoryBlock data;
+    if (!SidecarCache::load(file, "seekindex", data))
+        return nullptr;
+
+    juce::MemoryInputStream in(data, false);
+
+    if (in.readInt() != cacheVersion)
+        return nullptr;
+
+    auto index = std::make_unique<SeekIndex>();
+    index->format = in.readByte() == 1 ? Format::flac : Format::mp3;
+    index->totalSamples = in.readInt64();
+    index->preRollSamples = in.readInt();
+
+    const int headerSize = in.readInt();
+    if (headerSize < 0 || headerSize > 64 || in.readIntoMemoryBlock(index->streamHeader, headerSize) != (size_t)headerSize)
+        return nullptr;
+
+    const int numEntries = in.readInt();
+    if (numEntries <= 0 || (juce::int64)numEntries * 16 > in.getNumBytesRemaining())
+        return nullptr;
+
+    index->entries.ensureStorageAllocated(numEntries);
+
+    for (int i = 0; i < numEntries; ++i)
+    {
+        Entry entry;
+        entry.sample = in.readInt64();
+        entry.byteOffset = in.readInt64();
+        index->entries.add(entry);
+    }
+
+    return index;
+}
+
+void SeekIndex::saveToCache(const juce::File& file) const
+{
+    juce::MemoryOutputStream out;
+    out.writeInt(cacheVersion);
+    out.writeByte(format == Format::flac ? 1 : 0);
+    out.writeInt64(totalSamples);
+    out.writeInt(preRollSamples);
+    out.writeInt((int)streamHeader.getSize());
+    out.write(streamHeader.getData(), streamHeader.getSize());
+    out.writeInt(entries.size());
+
+    for (const auto& entry : entries)
+    {
+        out.writeInt64(entry.sample);
+        out.writeInt64(entry.byteOffset);
+    }
+
+    SidecarCache::save(file, "seekindex", out.getMemoryBlock());
+}
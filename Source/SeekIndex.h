@@ -0,0 +1,60 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Byte offsets of decodable frames at roughly one-second intervals through a
+// compressed file, so a seek can restart the decoder near the target instead
+// of scanning from the top.
+struct SeekIndex
+{
+    struct Entry
+    {
+        juce::int64 sample = 0;
+        juce::int64 byteOffset = 0;
+    };
+
+    enum class Format
+    {
+        mp3,
+        flac
+    };
+
+    Format format = Format::mp3;
+    juce::int64 totalSamples = 0;
+
+    // MP3 frames may borrow bits from earlier ones, so decoding restarts a
+    // couple of frames early and discards them.
+    int preRollSamples = 0;
+
+    // FLAC decoders need the stream header before any frame; this is "fLaC"
+    // plus STREAMINFO, replayed in front of the restart offset.
+    juce::MemoryBlock streamHeader;
+
+    juce::Array<Entry> entries;
+
+    // Last entry at or before the given sample, or nullptr if none.
+    const Entry* findEntryBefore(juce::int64 sample) const;
+
+    struct Mp3FrameRange
+    {
+        juce::int64 startByte = 0;
+        juce::int64 endByte = 0;
+        juce::int64 firstSample = 0;
+        juce::int64 numSamples = 0;
+    };
+
+    // Finds the whole frames covering [startSample, endSample) of the decoded
+    // timeline, so they can be copied out without re-encoding. firstSample is
+    // where the range starts, at or before startSample. The index is optional
+    // and only saves scanning from the top.
+    static bool findMp3FrameRange(juce::InputStream& in, const SeekIndex* index, juce::int64 startSample,
+        juce::int64 endSample, Mp3FrameRange& range);
+
+    static bool canIndex(const juce::File& file);
+
+    // Scans the whole file; returns nullptr if it isn't a stream we understand
+    // or shouldExit() asks to stop.
+    static std::unique_ptr<SeekIndex> build(const juce::File& file, const std::function<bool()>& shouldExit);
+
+    static std::unique_ptr<SeekIndex> loadFromCache(const juce::File& file);
+    void saveToCache(const juce::File& file) const;
+};
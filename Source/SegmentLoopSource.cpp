@@ -0,0 +1,153 @@
+#include "SegmentLoopSource.h"
+
+SegmentLoopSource::SegmentLoopSource(juce::PositionableAudioSource* inputSource)
+    : input(inputSource)
+{
+    jassert(input != nullptr);
+}
+
+void SegmentLoopSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    inputPosition = -1;
+}
+
+void SegmentLoopSource::releaseResources()
+{
+    input->releaseResources();
+}
+
+void SegmentLoopSource::setNextReadPosition(juce::int64 newPosition)
+{
+    position = newPosition;
+    crossfading = false;
+}
+
+juce::int64 SegmentLoopSource::getNextReadPosition() const
+{
+    const auto pos = position.load();
+    const auto length = input->getTotalLength();
+
+    return (input->isLooping() && length > 0 && pos > 0) ? pos % length : pos;
+}
+
+void SegmentLoopSource::setSegment(juce::int64 startSample, juce::int64 endSample, bool shouldLoop, const LoopRegion* region)
+{
+    loopStart = startSample;
+    loopEnd = endSample;
+    loopEnabled = shouldLoop && startSample >= 0 && endSample > startSample;
+    loopRegion = region;
+    crossfading = false;
+}
+
+void SegmentLoopSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    auto pos = position.load();
+    int done = 0;
+
+    while (done < bufferToFill.numSamples)
+    {
+        int numThisTime = bufferToFill.numSamples - done;
+        bool fromRegion = false;
+
+        if (loopEnabled)
+        {
+            if (pos >= loopEnd)
+            {
+                pos = loopStart;
+                wrapToStart();
+            }
+
+            numThisTime = (int)juce::jmin((juce::int64)numThisTime, loopEnd - pos);
+
+            if (loopRegion != nullptr && pos >= loopRegion->start && pos < loopRegion->getHeadEnd())
+            {
+                numThisTime = (int)juce::jmin((juce::int64)numThisTime, loopRegion->getHeadEnd() - pos);
+                fromRegion = true;
+            }
+        }
+
+        juce::AudioSourceChannelInfo section(bufferToFill.buffer, bufferToFill.startSample + done, numThisTime);
+
+        if (fromRegion)
+            readFromRegion(section, pos);
+        else
+            readFromInput(section, pos);
+
+        if (crossfading)
+            applyCrossfade(section, pos);
+
+        pos += numThisTime;
+        done += numThisTime;
+    }
+
+    position = pos;
+}
+
+void SegmentLoopSource::wrapToStart()
+{
+    if (loopRegion == nullptr)
+        return;
+
+    crossfading = loopRegion->tail.getNumSamples() > 0;
+
+    // Send the input to the end of the head now, so it refills while the head
+    // plays from memory and is ready by the time it's needed.
+    if (!loopRegion->coversWholeLoop() && inputPosition != loopRegion->getHeadEnd())
+    {
+        input->setNextReadPosition(loopRegion->getHeadEnd());
+        inputPosition = loopRegion->getHeadEnd();
+    }
+}
+
+void SegmentLoopSource::readFromInput(const juce::AudioSourceChannelInfo& info, juce::int64 startPosition)
+{
+    if (inputPosition != startPosition)
+        input->setNextReadPosition(startPosition);
+
+    input->getNextAudioBlock(info);
+    inputPosition = startPosition + info.numSamples;
+}
+
+void SegmentLoopSource::readFromRegion(const juce::AudioSourceChannelInfo& info, juce::int64 startPosition)
+{
+    const auto& samples = loopRegion->head;
+    const int offset = (int)(startPosition - loopRegion->start);
+
+    for (int chan = 0; chan < info.buffer->getNumChannels(); ++chan)
+    {
+        const int sourceChan = juce::jmin(chan, samples.getNumChannels() - 1);
+        info.buffer->copyFrom(chan, info.startSample, samples, sourceChan, offset, info.numSamples);
+    }
+}
+
+void SegmentLoopSource::applyCrossfade(const juce::AudioSourceChannelInfo& info, juce::int64 startPosition)
+{
+    const auto& tail = loopRegion->tail;
+    const int fadeLength = tail.getNumSamples();
+    const int offset = (int)(startPosition - loopStart);
+    const int numToFade = juce::jmin(info.numSamples, fadeLength - offset);
+
+    if (offset < 0 || numToFade <= 0)
+    {
+        crossfading = false;
+        return;
+    }
+
+    // Equal-power: A fades in while the audio that would have followed B
+    // fades out.
+    for (int chan = 0; chan < info.buffer->getNumChannels(); ++chan)
+    {
+        auto* dest = info.buffer->getWritePointer(chan, info.startSample);
+        const auto* overrun = tail.getReadPointer(juce::jmin(chan, tail.getNumChannels() - 1), offset);
+
+        for (int i = 0; i < numToFade; ++i)
+        {
+            const float angle = juce::MathConstants<float>::halfPi * ((float)(offset + i) + 0.5f) / (float)fadeLength;
+            dest[i] = dest[i] * std::sin(angle) + overrun[i] * std::cos(angle);
+        }
+    }
+
+    if (offset + numToFade >= fadeLength)
+        crossfading = false;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Pre-decoded audio for one A/B loop, built on a worker thread.
+//
+// `head` starts at A. For loops short enough to hold in memory it covers the
+// whole of [A, B); for longer ones it covers the first few seconds, which is
+// played from memory after each wrap while the input stream seeks back and
+// refills behind it. `tail` is the audio just past B, faded out against the
+// head after a wrap.
+struct LoopRegion
+{
+    juce::AudioBuffer<float> head;
+    juce::AudioBuffer<float> tail;
+    juce::int64 start = 0;
+    juce::int64 end = 0;
+    int serial = 0;
+
+    juce::int64 getHeadEnd() const { return start + head.getNumSamples(); }
+    bool coversWholeLoop() const { return getHeadEnd() >= end; }
+};
+
+class SegmentLoopSource : public juce::PositionableAudioSource
+{
+public:
+    explicit SegmentLoopSource(juce::PositionableAudioSource* inputSource);
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override { return input->getTotalLength(); }
+    bool isLooping() const override { return input->isLooping(); }
+    void setLooping(bool shouldLoop) override { input->setLooping(shouldLoop); }
+
+    void setSegment(juce::int64 startSample, juce::int64 endSample, bool shouldLoop, const LoopRegion* region);
+
+private:
+    juce::PositionableAudioSource* input;
+
+    std::atomic<juce::int64> position{ 0 };
+    juce::int64 inputPosition = -1;
+
+    juce::int64 loopStart = 0;
+    juce::int64 loopEnd = 0;
+    bool loopEnabled = false;
+    const LoopRegion* loopRegion = nullptr;
+    bool crossfading = false;
+
+    void wrapToStart();
+    void readFromInput(const juce::AudioSourceChannelInfo& info, juce::int64 startPosition);
+    void readFromRegion(const juce::AudioSourceChannelInfo& info, juce::int64 startPosition);
+    void applyCrossfade(const juce::AudioSourceChannelInfo& info, juce::int64 startPosition);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SegmentLoopSource)
+};
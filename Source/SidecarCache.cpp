@@ -0,0 +1,187 @@
+#include "SidecarCache.h"
+
+namespace
+{
+    const juce::String fileSuffix = ".bin";
+
+    std::atomic<juce::int64> diskBudget{ (juce::int64)64 * 1024 * 1024 };
+    juce::CriticalSection trimLock;
+
+    juce::String getKey(const juce::File& audioFile)
+    {
+        return audioFile.getFullPathName() + "|" + juce::String(audioFile.getSize())
+            + "|" + juce::String(audioFile.getLastModificationTime().toMilliseconds());
+    }
+
+    juce::File getCacheFileForKey(const juce::String& key, const juce::String& kind)
+    {
+        const auto hash = juce::String::toHexString(key.hashCode64());
+        return SidecarCache::getCacheDirectory().getChildFile(kind).getChildFile(hash + fileSuffix);
+    }
+
+    bool loadWithKey(const juce::String& key, const juce::String& kind, juce::MemoryBlock& data)
+    {
+        if (key.isEmpty())
+            return false;
+
+        juce::FileInputStream stream(getCacheFileForKey(key, kind));
+        if (!stream.openedOk())
+            return false;
+
+        // The full key is stored too, so a hash collision reads as a miss.
+        if (stream.readString() != key)
+            return false;
+
+        const auto size = stream.readInt64();
+        if (size < 0 || size > stream.getNumBytesRemaining())
+            return false;
+
+        data.setSize((size_t)size);
+        if (stream.read(data.getData(), (int)size) != (int)size)
+            return false;
+
+        // The modification time doubles as the last-used time for trimming.
+        getCacheFileForKey(key, kind).setLastModificationTime(juce::Time::getCurrentTime());
+        return true;
+    }
+
+    bool saveWithKey(const juce::String& key, const juce::String& kind, const juce::MemoryBlock& data)
+    {
+        if (key.isEmpty())
+            return false;
+
+        const auto target = getCacheFileForKey(key, kind);
+        if (!target.getParentDirectory().createDirectory())
+            return false;
+
+        juce::TemporaryFile temp(target);
+
+        {
+            juce::FileOutputStream stream(temp.getFile());
+            if (!stream.openedOk())
+                return false;
+
+            stream.writeString(key);
+            stream.writeInt64((juce::int64)data.getSize());
+            stream.write(data.getData(), data.getSize());
+            stream.flush();
+
+            if (stream.getStatus().failed())
+                return false;
+        }
+
+        if (!temp.overwriteTargetFileWithTemporary())
+            return false;
+
+        SidecarCache::trimToBudget();
+        return true;
+    }
+}
+
+juce::File SidecarCache::getCacheDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("MyAudioPlayerData")
+        .getChildFile("Cache");
+}
+
+juce::File SidecarCache::getCacheFile(const juce::File& audioFile, const juce::String& kind)
+{
+    return getCacheFileForKey(getKey(audioFile), kind);
+}
+
+void SidecarCache::setDiskBudget(juce::int64 newBudgetBytes)
+{
+    diskBudget = juce::jmax((juce::int64)0, newBudgetBytes);
+    trimToBudget();
+}
+
+juce::int64 SidecarCache::getDiskBudget()
+{
+    return diskBudget.load();
+}
+
+void SidecarCache::trimToBudget()
+{
+    struct Entry
+    {
+        juce::File file;
+        juce::int64 size;
+        juce::Time lastUsed;
+    };
+
+    // Saves arrive from several worker threads; one trim at a time is enough.
+    const juce::ScopedLock sl(trimLock);
+
+    std::vector<Entry> entries;
+    juce::int64 total = 0;
+
+    for (const auto& folder : getCacheDirectory().findChildFiles(juce::File::findDirectories, false))
+    {
+        for (const auto& file : folder.findChildFiles(juce::File::findFiles, false, "*" + fileSuffix))
+        {
+            entries.push_back({ file, file.getSize(), file.getLastModificationTime() });
+            total += entries.back().size;
+        }
+    }
+
+    const auto budget = diskBudget.load();
+    if (total <= budget)
+        return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+
+    for (const auto& entry : entries)
+    {
+        if (total <= budget)
+            break;
+
+        if (entry.file.deleteFile())
+            total -= entry.size;
+    }
+}
+
+bool SidecarCache::load(const juce::File& audioFile, const juce::String& kind, juce::MemoryBlock& data)
+{
+    return loadWithKey(getKey(audioFile), kind, data);
+}
+
+bool SidecarCache::save(const juce::File& audioFile, const juce::String& kind, const juce::MemoryBlock& data)
+{
+    return saveWithKey(getKey(audioFile), kind, data);
+}
+
+juce::String SidecarCache::getFingerprint(const juce::File& audioFile)
+{
+    juce::FileInputStream stream(audioFile);
+    if (!stream.openedOk())
+        return {};
+
+    constexpr int sampleBytes = 65536;
+    const auto totalLength = stream.getTotalLength();
+    juce::HeapBlock<juce::uint8> buffer(sampleBytes);
+    juce::uint64 hash = 14695981039346656037ull;
+
+    for (auto offset : { (juce::int64)0, (totalLength - sampleBytes) / 2, totalLength - sampleBytes })
+    {
+        if (!stream.setPosition(juce::jmax((juce::int64)0, offset)))
+            return {};
+
+        const int numRead = stream.read(buffer, sampleBytes);
+
+        for (int i = 0; i < numRead; ++i)
+            hash = (hash ^ buffer[i]) * 1099511628211ull;
+    }
+
+    return juce::String(totalLength) + ":" + juce::String::toHexString((juce::int64)hash);
+}
+
+bool SidecarCache::loadByFingerprint(const juce::File& audioFile, const juce::String& kind, juce::MemoryBlock& data)
+{
+    return loadWithKey(getFingerprint(audioFile), kind, data);
+}
+
+bool SidecarCache::saveByFingerprint(const juce::File& audioFile, const juce::String& kind, const juce::MemoryBlock& data)
+{
+    return saveWithKey(getFingerprint(audioFile), kind, data);
+}
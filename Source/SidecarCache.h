@@ -0,0 +1,30 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Small per-file analysis results (seek indexes and the like) kept in the
+// app's data folder. Entries are keyed by path, size and modification time,
+// so an edited or replaced file simply misses and gets re-analysed.
+//
+// The folder is held to a disk budget: each save evicts the least recently
+// used entries once the total goes over it. Thumbnails have their own budget
+// in DiskThumbnailCache and aren't counted here.
+namespace SidecarCache
+{
+    juce::File getCacheDirectory();
+    juce::File getCacheFile(const juce::File& audioFile, const juce::String& kind);
+
+    void setDiskBudget(juce::int64 newBudgetBytes);
+    juce::int64 getDiskBudget();
+    void trimToBudget();
+
+    bool load(const juce::File& audioFile, const juce::String& kind, juce::MemoryBlock& data);
+    bool save(const juce::File& audioFile, const juce::String& kind, const juce::MemoryBlock& data);
+
+    // The file's size and a hash of its start, middle and end. Results kept
+    // under it survive the file being renamed, moved or copied, which suits
+    // analysis that is slow to redo (tempo, loudness).
+    juce::String getFingerprint(const juce::File& audioFile);
+
+    bool loadByFingerprint(const juce::File& audioFile, const juce::String& kind, juce::MemoryBlock& data);
+    bool saveByFingerprint(const juce::File& audioFile, const juce::String& kind, const juce::MemoryBlock& data);
+}
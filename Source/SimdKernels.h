@@ -0,0 +1,417 @@
+#pragma once
+#include <JuceHeader.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define AUDIO_SIMD_SSE 1
+ #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+ #define AUDIO_SIMD_NEON 1
+ #include <arm_neon.h>
+#endif
+
+// Small hand-vectorised loops used on the audio thread and in the analysis
+// jobs where JUCE's FloatVectorOperations has no equivalent. Each has a scalar tail, so any
+// length and alignment is fine.
+namespace SimdKernels
+{
+    inline float dotProduct(const float* a, const float* b, int numSamples) noexcept
+    {
+        int i = 0;
+        float sum = 0.0f;
+
+       #if AUDIO_SIMD_SSE
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, _mm_add_ps(acc0, acc1));
+        sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+       #elif AUDIO_SIMD_NEON
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+            acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        }
+
+        const float32x4_t acc = vaddq_f32(acc0, acc1);
+        sum = (vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1))
+            + (vgetq_lane_f32(acc, 2) + vgetq_lane_f32(acc, 3));
+       #endif
+
+        for (; i < numSamples; ++i)
+            sum += a[i] * b[i];
+
+        return sum;
+    }
+
+    // dest[i] += source[i] * window[i]
+    inline void addWindowed(float* dest, const float* source, const float* window, int numSamples) noexcept
+    {
+        int i = 0;
+
+       #if AUDIO_SIMD_SSE
+        for (; i + 4 <= numSamples; i += 4)
+            _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i),
+                _mm_mul_ps(_mm_loadu_ps(source + i), _mm_loadu_ps(window + i))));
+       #elif AUDIO_SIMD_NEON
+        for (; i + 4 <= numSamples; i += 4)
+            vst1q_f32(dest + i, vmlaq_f32(vld1q_f32(dest + i), vld1q_f32(source + i), vld1q_f32(window + i)));
+       #endif
+
+        for (; i < numSamples; ++i)
+            dest[i] += source[i] * window[i];
+    }
+
+    // Little-endian 16-bit PCM to float in [-1, 1).
+    inline void convertInt16(const juce::int16* source, float* dest, int numSamples) noexcept
+    {
+        constexpr float scale = 1.0f / 32768.0f;
+        int i = 0;
+
+       #if AUDIO_SIMD_SSE
+        const __m128 scaleVec = _mm_set1_ps(scale);
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            const __m128i pcm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+            const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(pcm, pcm), 16);
+            const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(pcm, pcm), 16);
+            _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scaleVec));
+            _mm_storeu_ps(dest + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scaleVec));
+        }
+       #elif AUDIO_SIMD_NEON
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            const int16x8_t pcm = vld1q_s16(source + i);
+            vst1q_f32(dest + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(pcm))), scale));
+            vst1q_f32(dest + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(pcm))), scale));
+        }
+       #endif
+
+        for (; i < numSamples; ++i)
+            dest[i] = (float)source[i] * scale;
+    }
+
+    // Interleaved little-endian 16-bit stereo to two float channels.
+    inline void deinterleaveInt16Stereo(const juce::int16* source, float* left, float* right, int numFrames) noexcept
+    {
+        constexpr float scale = 1.0f / 32768.0f;
+        int i = 0;
+
+       #if AUDIO_SIMD_SSE
+        const __m128 scaleVec = _mm_set1_ps(scale);
+
+        for (; i + 4 <= numFrames; i += 4)
+        {
+            const __m128i pcm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * i));
+            const __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(pcm, pcm), 16));
+            const __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(pcm, pcm), 16));
+            _mm_storeu_ps(left + i, _mm_mul_ps(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)), scaleVec));
+            _mm_storeu_ps(right + i, _mm_mul_ps(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)), scaleVec));
+        }
+       #elif AUDIO_SIMD_NEON
+        for (; i + 8 <= numFrames; i += 8)
+        {
+            const int16x8x2_t pcm = vld2q_s16(source + 2 * i);
+            vst1q_f32(left + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(pcm.val[0]))), scale));
+            vst1q_f32(left + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(pcm.val[0]))), scale));
+            vst1q_f32(right + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(pcm.val[1]))), scale));
+            vst1q_f32(right + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(pcm.val[1]))), scale));
+        }
+       #endif
+
+        for (; i < numFrames; ++i)
+        {
+            left[i] = (float)source[2 * i] * scale;
+            right[i] = (float)source[2 * i + 1] * scale;
+        }
+    }
+
+    // Interleaved float stereo to two channels.
+    inline void deinterleaveFloatStereo(const float* source, float* left, float* right, int numFrames) noexcept
+    {
+        int i = 0;
+
+       #if AUDIO_SIMD_SSE
+        for (; i + 4 <= numFrames; i += 4)
+        {
+            const __m128 a = _mm_loadu_ps(source + 2 * i);
+            const __m128 b = _mm_loadu_ps(source + 2 * i + 4);
+            _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+       #elif AUDIO_SIMD_NEON
+        for (; i + 4 <= numFrames; i += 4)
+        {
+            const float32x4x2_t frames = vld2q_f32(source + 2 * i);
+            vst1q_f32(left + i, frames.val[0]);
+            vst1q_f32(right + i, frames.val[1]);
+        }
+       #endif
+
+        for (; i < numFrames; ++i)
+        {
+            left[i] = source[2 * i];
+            right[i] = source[2 * i + 1];
+        }
+    }
+
+    // dest[i] += source[i] * gain, with gain moving linearly from startGain
+    // towards endGain across the block.
+    inline void addWithRamp(float* dest, const float* source, float startGain, float endGain, int numSamples) noexcept
+    {
+        if (startGain == endGain)
+        {
+            juce::FloatVectorOperations::addWithMultiply(dest, source, startGain, numSamples);
+            return;
+        }
+
+        const float step = (endGain - startGain) / (float)juce::jmax(1, numSamples);
+        int i = 0;
+
+       #if AUDIO_SIMD_SSE
+        __m128 gain = _mm_setr_ps(startGain, startGain + step, startGain + 2.0f * step, startGain + 3.0f * step);
+        const __m128 gainStep = _mm_set1_ps(4.0f * step);
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), _mm_mul_ps(_mm_loadu_ps(source + i), gain)));
+            gain = _mm_add_ps(gain, gainStep);
+        }
+       #elif AUDIO_SIMD_NEON
+        const float initial[4] = { startGain, startGain + step, startGain + 2.0f * step, startGain + 3.0f * step };
+        float32x4_t gain = vld1q_f32(initial);
+        const float32x4_t gainStep = vdupq_n_f32(4.0f * step);
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            vst1q_f32(dest + i, vmlaq_f32(vld1q_f32(dest + i), vld1q_f32(source + i), gain));
+            gain = vaddq_f32(gain, gainStep);
+        }
+       #endif
+
+        for (; i < numSamples; ++i)
+            dest[i] += source[i] * (startGain + step * (float)i);
+    }
+
+    // dest[i] = |bins[i]|^0.5 for interleaved (re, im) pairs. The square root
+    // of the magnitude compresses the spectrum much like a log would, at the
+    // cost of two square roots.
+    inline void compressedMagnitudes(const float* bins, float* dest, int numBins) noexcept
+    {
+        int i = 0;
+
+       #if AUDIO_SIMD_SSE
+        for (; i + 4 <= numBins; i += 4)
+        {
+            const __m128 a = _mm_loadu_ps(bins + 2 * i);
+            const __m128 b = _mm_loadu_ps(bins + 2 * i + 4);
+            const __m128 a2 = _mm_mul_ps(a, a);
+            const __m128 b2 = _mm_mul_ps(b, b);
+            const __m128 power = _mm_add_ps(_mm_shuffle_ps(a2, b2, _MM_SHUFFLE(2, 0, 2, 0)),
+                _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(3, 1, 3, 1)));
+            _mm_storeu_ps(dest + i, _mm_sqrt_ps(_mm_sqrt_ps(power)));
+        }
+       #elif AUDIO_SIMD_NEON && defined(__aarch64__)
+        for (; i + 4 <= numBins; i += 4)
+        {
+            const float32x4x2_t v = vld2q_f32(bins + 2 * i);
+            const float32x4_t power = vmlaq_f32(vmulq_f32(v.val[0], v.val[0]), v.val[1], v.val[1]);
+            vst1q_f32(dest + i, vsqrtq_f32(vsqrtq_f32(power)));
+        }
+       #endif
+
+        for (; i < numBins; ++i)
+            dest[i] = std::sqrt(std::sqrt(bins[2 * i] * bins[2 * i] + bins[2 * i + 1] * bins[2 * i + 1]));
+    }
+
+    // dest[i] = |bins[i]|^2 for interleaved (re, im) pairs.
+    inline void powerSpectrum(const float* bins, float* dest, int numBins) noexcept
+    {
+        int i = 0;
+
+       #if AUDIO_SIMD_SSE
+        for (; i + 4 <= numBins; i += 4)
+        {
+            const __m128 a = _mm_loadu_ps(bins + 2 * i);
+            const __m128 b = _mm_loadu_ps(bins + 2 * i + 4);
+            const __m128 a2 = _mm_mul_ps(a, a);
+            const __m128 b2 = _mm_mul_ps(b, b);
+            _mm_storeu_ps(dest + i, _mm_add_ps(_mm_shuffle_ps(a2, b2, _MM_SHUFFLE(2, 0, 2, 0)),
+                _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(3, 1, 3, 1))));
+        }
+       #elif AUDIO_SIMD_NEON && defined(__aarch64__)
+        for (; i + 4 <= numBins; i += 4)
+        {
+            const float32x4x2_t v = vld2q_f32(bins + 2 * i);
+            vst1q_f32(dest + i, vmlaq_f32(vmulq_f32(v.val[0], v.val[0]), v.val[1], v.val[1]));
+        }
+       #endif
+
+        for (; i < numBins; ++i)
+            dest[i] = bins[2 * i] * bins[2 * i] + bins[2 * i + 1] * bins[2 * i + 1];
+    }
+
+    // Sum of max(0, current[i] - previous[i]): the rise in energy between two
+    // spectra, ignoring bins that fell.
+    inline float positiveDifferenceSum(const float* current, const float* previous, int numSamples) noexcept
+    {
+        int i = 0;
+        float sum = 0.0f;
+
+       #if AUDIO_SIMD_SSE
+        const __m128 zero = _mm_setzero_ps();
+        __m128 acc = zero;
+
+        for (; i + 4 <= numSamples; i += 4)
+            acc = _mm_add_ps(acc, _mm_max_ps(zero, _mm_sub_ps(_mm_loadu_ps(current + i), _mm_loadu_ps(previous + i))));
+
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, acc);
+        sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+       #elif AUDIO_SIMD_NEON
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        float32x4_t acc = zero;
+
+        for (; i + 4 <= numSamples; i += 4)
+            acc = vaddq_f32(acc, vmaxq_f32(zero, vsubq_f32(vld1q_f32(current + i), vld1q_f32(previous + i))));
+
+        sum = (vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1))
+            + (vgetq_lane_f32(acc, 2) + vgetq_lane_f32(acc, 3));
+       #endif
+
+        for (; i < numSamples; ++i)
+            sum += juce::jmax(0.0f, current[i] - previous[i]);
+
+        return sum;
+    }
+
+    // Smallest and largest sample and the sum of squares, in one pass.
+    // numSamples must be at least 1.
+    inline float minMaxSumSquares(const float* source, int numSamples, float& minimum, float& maximum) noexcept
+    {
+        int i = 0;
+        float low = source[0], high = source[0], sum = 0.0f;
+
+       #if AUDIO_SIMD_SSE
+        if (numSamples >= 4)
+        {
+            __m128 lows = _mm_loadu_ps(source), highs = lows, acc = _mm_setzero_ps();
+
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                const __m128 v = _mm_loadu_ps(source + i);
+                lows = _mm_min_ps(lows, v);
+                highs = _mm_max_ps(highs, v);
+                acc = _mm_add_ps(acc, _mm_mul_ps(v, v));
+            }
+
+            alignas(16) float lanes[4];
+            _mm_store_ps(lanes, lows);
+            low = juce::jmin(juce::jmin(lanes[0], lanes[1]), juce::jmin(lanes[2], lanes[3]));
+            _mm_store_ps(lanes, highs);
+            high = juce::jmax(juce::jmax(lanes[0], lanes[1]), juce::jmax(lanes[2], lanes[3]));
+            _mm_store_ps(lanes, acc);
+            sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        }
+       #elif AUDIO_SIMD_NEON
+        if (numSamples >= 4)
+        {
+            float32x4_t lows = vld1q_f32(source), highs = lows, acc = vdupq_n_f32(0.0f);
+
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                const float32x4_t v = vld1q_f32(source + i);
+                lows = vminq_f32(lows, v);
+                highs = vmaxq_f32(highs, v);
+                acc = vmlaq_f32(acc, v, v);
+            }
+
+            low = juce::jmin(juce::jmin(vgetq_lane_f32(lows, 0), vgetq_lane_f32(lows, 1)),
+                juce::jmin(vgetq_lane_f32(lows, 2), vgetq_lane_f32(lows, 3)));
+            high = juce::jmax(juce::jmax(vgetq_lane_f32(highs, 0), vgetq_lane_f32(highs, 1)),
+                juce::jmax(vgetq_lane_f32(highs, 2), vgetq_lane_f32(highs, 3)));
+            sum = (vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1))
+                + (vgetq_lane_f32(acc, 2) + vgetq_lane_f32(acc, 3));
+        }
+       #endif
+
+        for (; i < numSamples; ++i)
+        {
+            low = juce::jmin(low, source[i]);
+            high = juce::jmax(high, source[i]);
+            sum += source[i] * source[i];
+        }
+
+        minimum = low;
+        maximum = high;
+        return sum;
+    }
+
+    // Largest magnitude of the signal interpolated to four times its rate.
+    // coefficients holds numTaps groups of four, one tap for each output
+    // phase, and input must have numTaps - 1 samples of history before it.
+    // The four phases of an output sample are computed side by side.
+    inline float oversampledPeak(const float* input, int numSamples, const float* coefficients, int numTaps) noexcept
+    {
+        float peak = 0.0f;
+
+       #if AUDIO_SIMD_SSE
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        __m128 peaks = _mm_setzero_ps();
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            __m128 acc = _mm_setzero_ps();
+
+            for (int k = 0; k < numTaps; ++k)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(input[n - k]), _mm_loadu_ps(coefficients + 4 * k)));
+
+            peaks = _mm_max_ps(peaks, _mm_andnot_ps(signMask, acc));
+        }
+
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, peaks);
+        peak = juce::jmax(juce::jmax(lanes[0], lanes[1]), juce::jmax(lanes[2], lanes[3]));
+       #elif AUDIO_SIMD_NEON
+        float32x4_t peaks = vdupq_n_f32(0.0f);
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            float32x4_t acc = vdupq_n_f32(0.0f);
+
+            for (int k = 0; k < numTaps; ++k)
+                acc = vmlaq_n_f32(acc, vld1q_f32(coefficients + 4 * k), input[n - k]);
+
+            peaks = vmaxq_f32(peaks, vabsq_f32(acc));
+        }
+
+        peak = juce::jmax(juce::jmax(vgetq_lane_f32(peaks, 0), vgetq_lane_f32(peaks, 1)),
+            juce::jmax(vgetq_lane_f32(peaks, 2), vgetq_lane_f32(peaks, 3)));
+       #else
+        for (int n = 0; n < numSamples; ++n)
+        {
+            for (int phase = 0; phase < 4; ++phase)
+            {
+                float sum = 0.0f;
+
+                for (int k = 0; k < numTaps; ++k)
+                    sum += input[n - k] * coefficients[4 * k + phase];
+
+                peak = juce::jmax(peak, std::abs(sum));
+            }
+        }
+       #endif
+
+        return peak;
+    }
+}
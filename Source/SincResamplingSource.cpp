@@ -0,0 +1,338 @@
+#include "SincResamplingSource.h"
+#include "SimdKernels.h"
+
+namespace
+{
+    constexpr int numPhases = 256;
+    constexpr double minRatio = 1.0 / 32.0;
+    constexpr double maxRatio = 8.0;
+    constexpr int maxChunkSize = 512;
+
+    double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+
+            if (term < sum * 1.0e-12)
+                break;
+        }
+
+        return sum;
+    }
+}
+
+SincResamplingSource::Kernel SincResamplingSource::buildKernel(int halfTaps, double cutoff, double beta)
+{
+    Kernel kernel;
+    kernel.halfTaps = halfTaps;
+
+    const int rowLength = 2 * halfTaps;
+    kernel.table.resize((size_t)((numPhases + 1) * rowLength));
+
+    const double windowScale = 1.0 / besselI0(beta);
+
+    for (int phase = 0; phase <= numPhases; ++phase)
+    {
+        auto* row = kernel.table.data() + (size_t)(phase * rowLength);
+        double rowSum = 0.0;
+
+        for (int col = 0; col < rowLength; ++col)
+        {
+            const double x = (col - halfTaps + 1) - (double)phase / numPhases;
+            const double r = x / halfTaps;
+            double value = 0.0;
+
+            if (std::abs(r) < 1.0)
+            {
+                const double arg = juce::MathConstants<double>::pi * cutoff * x;
+                const double sinc = std::abs(arg) < 1.0e-9 ? 1.0 : std::sin(arg) / arg;
+                value = cutoff * sinc * besselI0(beta * std::sqrt(1.0 - r * r)) * windowScale;
+            }
+
+            row[col] = (float)value;
+            rowSum += value;
+        }
+
+        // Unity gain at every phase, otherwise the fractional position would
+        // modulate the level.
+        if (rowSum != 0.0)
+            for (int col = 0; col < rowLength; ++col)
+                row[col] = (float)(row[col] / rowSum);
+    }
+
+    return kernel;
+}
+
+float SincResamplingSource::Kernel::lookup(double x) const noexcept
+{
+    if (x <= -halfTaps || x > halfTaps)
+        return 0.0f;
+
+    const int tap = (int)std::ceil(x);
+    const double phasePosition = (tap - x) * numPhases;
+    const int phase = juce::jmin(numPhases - 1, (int)phasePosition);
+    const float fraction = (float)(phasePosition - phase);
+    const int col = tap + halfTaps - 1;
+
+    const float a = getRow(phase)[col];
+    const float b = getRow(phase + 1)[col];
+    return a + fraction * (b - a);
+}
+
+SincResamplingSource::SincResamplingSource(juce::AudioSource* inputSource, int numChannels)
+    : input(inputSource),
+    numberOfChannels(numChannels)
+{
+    jassert(input != nullptr);
+
+    kernels[(size_t)Quality::low] = buildKernel(4, 0.80, 5.0);
+    kernels[(size_t)Quality::medium] = buildKernel(8, 0.90, 7.0);
+    kernels[(size_t)Quality::high] = buildKernel(16, 0.94, 9.0);
+}
+
+void SincResamplingSource::setResamplingRatio(double samplesInPerOutputSample)
+{
+    jassert(samplesInPerOutputSample > 0.0);
+    const double newRatio = juce::jlimit(minRatio, maxRatio, samplesInPerOutputSample);
+
+    if (pendingRatioPosition >= 0)
+        pendingRatio = newRatio;
+    else
+        ratio = newRatio;
+}
+
+void SincResamplingSource::setResamplingRatioAtInput(double samplesInPerOutputSample, int offsetInPull)
+{
+    jassert(samplesInPerOutputSample > 0.0);
+    pendingRatio = juce::jlimit(minRatio, maxRatio, samplesInPerOutputSample);
+    pendingRatioPosition = pullStart + juce::jmax(0, offsetInPull);
+}
+
+void SincResamplingSource::setQuality(Quality newQuality)
+{
+    // Every tier fits the history kept for the widest one, so this can switch
+    // mid-stream without a reset.
+    quality = newQuality;
+}
+
+int SincResamplingSource::getHistoryLength() const
+{
+    return (int)std::ceil(kernels[(size_t)Quality::high].halfTaps * maxRatio) + 1;
+}
+
+void SincResamplingSource::reset()
+{
+    // Start with silent history so the first output sample has a full kernel
+    // behind it.
+    const int history = getHistoryLength();
+    inputBuffer.clear();
+    inputCount = history;
+    readPosition = (double)history;
+    pendingRatioPosition = -1;
+    lastRatio = ratio;
+}
+
+void SincResamplingSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    const int history = getHistoryLength();
+    inputCapacity = (int)std::ceil(maxChunkSize * maxRatio) + 4 * history + 16;
+    inputBuffer.setSize(numberOfChannels, inputCapacity);
+    coefficients.allocate((size_t)(2 * history), true);
+
+    input->prepareToPlay(juce::roundToInt(samplesPerBlockExpected * ratio), sampleRate * ratio);
+    reset();
+}
+
+void SincResamplingSource::releaseResources()
+{
+    input->releaseResources();
+    inputBuffer.setSize(numberOfChannels, 0);
+    inputCapacity = 0;
+}
+
+void SincResamplingSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (inputCapacity == 0)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    const int numSamples = bufferToFill.numSamples;
+    const int history = getHistoryLength();
+    int done = 0;
+
+    // At exactly 1:1 the kernel only costs cycles, so copy straight through.
+    // The history stays buffered so a later ratio change picks up seamlessly.
+    if (ratio == 1.0 && lastRatio == 1.0 && pendingRatioPosition < 0)
+    {
+        // A varispeed excursion can leave a fractional position; snapping it
+        // moves the stream by less than half a sample, once.
+        readPosition = std::floor(readPosition + 0.5);
+        const int outputChannels = juce::jmin(numberOfChannels, bufferToFill.buffer->getNumChannels());
+
+        while (done < numSamples)
+        {
+            const int chunk = juce::jmin(maxChunkSize, numSamples - done);
+            const int base = (int)readPosition;
+
+            pullInput(base + chunk + history + 2);
+
+            // The input changed rate inside this chunk; the rest of the block
+            // goes through the kernel so the ratio can step at that sample.
+            if (pendingRatioPosition >= 0)
+                break;
+
+            for (int ch = 0; ch < outputChannels; ++ch)
+                bufferToFill.buffer->copyFrom(ch, bufferToFill.startSample + done, inputBuffer, ch, base, chunk);
+
+            readPosition += chunk;
+
+            const int firstNeeded = (int)readPosition - history - 1;
+            if (firstNeeded > 0)
+                discardInput(firstNeeded);
+
+            done += chunk;
+        }
+
+        if (done == numSamples)
+        {
+            for (int ch = outputChannels; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+                bufferToFill.buffer->clear(ch, bufferToFill.startSample, numSamples);
+
+            return;
+        }
+    }
+
+    double ratioStep = (ratio - lastRatio) / juce::jmax(1, numSamples - done);
+    double currentRatio = lastRatio;
+
+    while (done < numSamples)
+    {
+        const int chunk = juce::jmin(maxChunkSize, numSamples - done);
+        const double chunkMaxRatio = juce::jmax(currentRatio, currentRatio + ratioStep * chunk);
+
+        pullInput((int)std::ceil(readPosition + chunk * chunkMaxRatio) + history + 2);
+
+        for (int i = 0; i < chunk; ++i)
+        {
+            if (pendingRatioPosition >= 0 && readPosition >= pendingRatioPosition)
+            {
+                currentRatio = applyPendingRatio(chunk - i);
+                ratioStep = 0.0;
+            }
+
+            renderSample(bufferToFill, done + i, currentRatio);
+            readPosition += currentRatio;
+            currentRatio += ratioStep;
+        }
+
+        const int firstNeeded = (int)readPosition - history - 1;
+        if (firstNeeded > 0)
+            discardInput(firstNeeded);
+
+        done += chunk;
+    }
+
+    lastRatio = ratio;
+
+    for (int ch = numberOfChannels; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+        bufferToFill.buffer->clear(ch, bufferToFill.startSample, numSamples);
+}
+
+// Steps straight to the pending ratio, cancelling any ramp still under way,
+// and pulls enough input to finish the chunk at the new ratio.
+double SincResamplingSource::applyPendingRatio(int samplesLeftInChunk)
+{
+    ratio = lastRatio = pendingRatio;
+    pendingRatioPosition = -1;
+
+    pullInput((int)std::ceil(readPosition + samplesLeftInChunk * ratio) + getHistoryLength() + 2);
+    return ratio;
+}
+
+void SincResamplingSource::renderSample(const juce::AudioSourceChannelInfo& bufferToFill, int outputIndex,
+    double currentRatio)
+{
+    const auto& kernel = getKernel();
+    const int base = (int)readPosition;
+    const int outputChannels = juce::jmin(numberOfChannels, bufferToFill.buffer->getNumChannels());
+    const int destIndex = bufferToFill.startSample + outputIndex;
+
+    if (currentRatio <= 1.0)
+    {
+        // The cutoff is fixed, so every tap shares the same fractional phase and
+        // the kernel is a blend of two precomputed rows.
+        const double phasePosition = (readPosition - base) * numPhases;
+        const int phase = juce::jmin(numPhases - 1, (int)phasePosition);
+        const float fraction = (float)(phasePosition - phase);
+        const int rowLength = 2 * kernel.halfTaps;
+        const int first = base - kernel.halfTaps + 1;
+
+        for (int ch = 0; ch < outputChannels; ++ch)
+        {
+            const float* samples = inputBuffer.getReadPointer(ch, first);
+            const float a = SimdKernels::dotProduct(samples, kernel.getRow(phase), rowLength);
+            const float b = SimdKernels::dotProduct(samples, kernel.getRow(phase + 1), rowLength);
+            bufferToFill.buffer->setSample(ch, destIndex, a + fraction * (b - a));
+        }
+
+        return;
+    }
+
+    // Downsampling: stretch the kernel by the ratio so it cuts off at the output
+    // Nyquist instead of the input's.
+    const double scale = 1.0 / currentRatio;
+    const int halfWidth = (int)std::ceil(kernel.halfTaps * currentRatio);
+    const int first = base - halfWidth + 1;
+    const int count = 2 * halfWidth;
+    float sum = 0.0f;
+
+    for (int k = 0; k < count; ++k)
+    {
+        const float coefficient = kernel.lookup((first + k - readPosition) * scale);
+        coefficients[k] = coefficient;
+        sum += coefficient;
+    }
+
+    const float gain = sum != 0.0f ? 1.0f / sum : 0.0f;
+
+    for (int ch = 0; ch < outputChannels; ++ch)
+        bufferToFill.buffer->setSample(ch, destIndex,
+            gain * SimdKernels::dotProduct(inputBuffer.getReadPointer(ch, first), coefficients, count));
+}
+
+void SincResamplingSource::pullInput(int samplesNeeded)
+{
+    samplesNeeded = juce::jmin(samplesNeeded, inputCapacity);
+    const int numToRead = samplesNeeded - inputCount;
+
+    if (numToRead > 0)
+    {
+        pullStart = inputCount;
+        input->getNextAudioBlock(juce::AudioSourceChannelInfo(&inputBuffer, inputCount, numToRead));
+        inputCount = samplesNeeded;
+    }
+}
+
+void SincResamplingSource::discardInput(int numSamples)
+{
+    numSamples = juce::jmin(numSamples, inputCount);
+    const int remaining = inputCount - numSamples;
+
+    for (int ch = 0; ch < numberOfChannels; ++ch)
+    {
+        auto* data = inputBuffer.getWritePointer(ch);
+        std::memmove(data, data + numSamples, sizeof(float) * (size_t)remaining);
+    }
+
+    inputCount = remaining;
+    readPosition -= numSamples;
+
+    if (pendingRatioPosition >= 0)
+        pendingRatioPosition = juce::jmax(0, pendingRatioPosition - numSamples);
+}
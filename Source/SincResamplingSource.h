@@ -0,0 +1,84 @@
+#pragma once
+#include <JuceHeader.h>
+
+// The deck's single resampling stage: file-rate conversion and varispeed
+// share one ratio. Kaiser-windowed sinc, stored as a polyphase table and
+// interpolated between phases.
+//
+// A steady 1:1 ratio copies straight through. Upsampling takes two SIMD dot
+// products per channel against adjacent table rows. Downsampling widens the kernel by the ratio so the cutoff
+// follows the output Nyquist; those coefficients are built once per output
+// sample and shared across channels.
+class SincResamplingSource : public juce::AudioSource
+{
+public:
+    enum class Quality
+    {
+        low,
+        medium,
+        high
+    };
+
+    SincResamplingSource(juce::AudioSource* inputSource, int numChannels = 2);
+
+    // Input samples consumed per output sample, as for juce::ResamplingAudioSource.
+    // Changes are ramped across the next block. While a change from
+    // setResamplingRatioAtInput() is pending, this replaces the pending ratio.
+    void setResamplingRatio(double samplesInPerOutputSample);
+    double getResamplingRatio() const { return ratio; }
+
+    // For an input whose sample rate changes mid-block: called from inside the
+    // input's getNextAudioBlock, with the offset of the first sample at the
+    // new rate from that call's startSample. The ratio steps to the new value
+    // when the read position reaches that sample, without a ramp.
+    void setResamplingRatioAtInput(double samplesInPerOutputSample, int offsetInPull);
+
+    void setQuality(Quality newQuality);
+    Quality getQuality() const { return quality; }
+
+    void reset();
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+private:
+    struct Kernel
+    {
+        int halfTaps = 0;
+        std::vector<float> table;
+
+        float lookup(double x) const noexcept;
+        const float* getRow(int phase) const noexcept { return table.data() + (size_t)phase * (size_t)(2 * halfTaps); }
+    };
+
+    juce::AudioSource* input;
+    const int numberOfChannels;
+
+    std::array<Kernel, 3> kernels;
+    Quality quality = Quality::medium;
+
+    double ratio = 1.0;
+    double lastRatio = 1.0;
+
+    juce::AudioBuffer<float> inputBuffer;
+    int inputCount = 0;
+    int inputCapacity = 0;
+    int pullStart = 0;
+    double readPosition = 0.0;
+
+    double pendingRatio = 1.0;
+    int pendingRatioPosition = -1;
+
+    juce::HeapBlock<float> coefficients;
+
+    static Kernel buildKernel(int halfTaps, double cutoff, double beta);
+    const Kernel& getKernel() const { return kernels[(size_t)quality]; }
+    int getHistoryLength() const;
+    void pullInput(int samplesNeeded);
+    void discardInput(int numSamples);
+    double applyPendingRatio(int samplesLeftInChunk);
+    void renderSample(const juce::AudioSourceChannelInfo& bufferToFill, int outputIndex, double currentRatio);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SincResamplingSource)
+};
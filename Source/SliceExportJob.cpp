@@ -0,0 +1,455 @@
+#include "SliceExportJob.h"
+#include "GaplessInfo.h"
+#include "SeekIndex.h"
+
+namespace
+{
+    // Where the sample frames of a PCM file live, plus the chunks that
+    // describe them, copied unchanged into the new file.
+    struct PcmLayout
+    {
+        bool isAiff = false;
+        bool isAifc = false;
+        juce::int64 dataStart = 0;
+        juce::int64 numFrames = 0;
+        int frameBytes = 0;
+        juce::MemoryBlock formatChunk;
+    };
+
+    juce::String getContainer(const juce::String& extension)
+    {
+        const auto ext = extension.trimCharactersAtStart(".").toLowerCase();
+        return ext == "aif" ? juce::String("aiff") : ext;
+    }
+
+    bool parseWav(juce::InputStream& in, PcmLayout& layout)
+    {
+        char riff[12];
+        if (in.read(riff, 12) != 12 || std::memcmp(riff, "RIFF", 4) != 0 || std::memcmp(riff + 8, "WAVE", 4) != 0)
+            return false;
+
+        juce::int64 dataSize = -1;
+
+        while (dataSize < 0 || layout.formatChunk.isEmpty())
+        {
+            juce::uint8 chunk[8];
+            if (in.read(chunk, 8) != 8)
+                return false;
+
+            const auto size = (juce::int64)juce::ByteOrder::littleEndianInt(chunk + 4);
+            const auto bodyStart = in.getPosition();
+
+            if (std::memcmp(chunk, "fmt ", 4) == 0)
+            {
+                if (size < 16 || size > 1024 || in.readIntoMemoryBlock(layout.formatChunk, (int)size) != (size_t)size)
+                    return false;
+            }
+            else if (std::memcmp(chunk, "data", 4) == 0)
+            {
+                layout.dataStart = bodyStart;
+                dataSize = juce::jmin(size, in.getTotalLength() - bodyStart);
+            }
+
+            if (!in.setPosition(bodyStart + size + (size & 1)))
+                return false;
+        }
+
+        // Integer or float PCM only; compressed WAVs go through the decoder.
+        const auto* fmt = static_cast<const juce::uint8*>(layout.formatChunk.getData());
+        int formatTag = juce::ByteOrder::littleEndianShort(fmt);
+
+        if (formatTag == 0xfffe && layout.formatChunk.getSize() >= 26)
+            formatTag = juce::ByteOrder::littleEndianShort(fmt + 24);
+
+        layout.frameBytes = juce::ByteOrder::littleEndianShort(fmt + 12);
+        layout.numFrames = layout.frameBytes > 0 ? dataSize / layout.frameBytes : 0;
+
+        return (formatTag == 1 || formatTag == 3) && layout.frameBytes > 0;
+    }
+
+    bool parseAiff(juce::InputStream& in, PcmLayout& layout)
+    {
+        char form[12];
+        if (in.read(form, 12) != 12 || std::memcmp(form, "FORM", 4) != 0)
+            return false;
+
+        layout.isAiff = true;
+        layout.isAifc = std::memcmp(form + 8, "AIFC", 4) == 0;
+
+        if (!layout.isAifc && std::memcmp(form + 8, "AIFF", 4) != 0)
+            return false;
+
+        juce::int64 dataSize = -1;
+
+        while (dataSize < 0 || layout.formatChunk.isEmpty())
+        {
+            juce::uint8 chunk[8];
+            if (in.read(chunk, 8) != 8)
+                return false;
+
+            const auto size = (juce::int64)juce::ByteOrder::bigEndianInt(chunk + 4);
+            const auto bodyStart = in.getPosition();
+
+            if (std::memcmp(chunk, "COMM", 4) == 0)
+            {
+                if (size < 18 || size > 1024 || in.readIntoMemoryBlock(layout.formatChunk, (int)size) != (size_t)size)
+                    return false;
+            }
+            else if (std::memcmp(chunk, "SSND", 4) == 0)
+            {
+                if (size < 8)
+                    return false;
+
+                const auto offset = (juce::int64)(juce::uint32)in.readIntBigEndian();
+                layout.dataStart = bodyStart + 8 + offset;
+                dataSize = juce::jmin(size - 8 - offset, in.getTotalLength() - layout.dataStart);
+            }
+
+            if (!in.setPosition(bodyStart + size + (size & 1)))
+                return false;
+        }
+
+        const auto* comm = static_cast<const juce::uint8*>(layout.formatChunk.getData());
+        const int numChannels = juce::ByteOrder::bigEndianShort(comm);
+        const int bitsPerSample = juce::ByteOrder::bigEndianShort(comm + 6);
+
+        if (layout.isAifc)
+        {
+            if (layout.formatChunk.getSize() < 22)
+                return false;
+
+            const auto* compression = reinterpret_cast<const char*>(comm + 18);
+            if (std::memcmp(compression, "NONE", 4) != 0 && std::memcmp(compression, "sowt", 4) != 0
+                && std::memcmp(compression, "fl32", 4) != 0 && std::memcmp(compression, "FL32", 4) != 0)
+                return false;
+        }
+
+        layout.frameBytes = numChannels * ((bitsPerSample + 7) / 8);
+        layout.numFrames = layout.frameBytes > 0 ? juce::jmax((juce::int64)0, dataSize) / layout.frameBytes : 0;
+        return layout.frameBytes > 0;
+    }
+
+    void writeWavHeader(juce::OutputStream& out, const PcmLayout& layout, juce::int64 dataBytes)
+    {
+        const auto fmtBytes = (juce::int64)layout.formatChunk.getSize();
+        const auto riffBytes = 4 + 8 + fmtBytes + (fmtBytes & 1) + 8 + dataBytes + (dataBytes & 1);
+
+        out.write("RIFF", 4);
+        out.writeInt((int)(juce::uint32)riffBytes);
+        out.write("WAVE", 4);
+        out.write("fmt ", 4);
+        out.writeInt((int)fmtBytes);
+        out << layout.formatChunk;
+
+        if ((fmtBytes & 1) != 0)
+            out.writeByte(0);
+
+        out.write("data", 4);
+        out.writeInt((int)(juce::uint32)dataBytes);
+    }
+
+    void writeAiffHeader(juce::OutputStream& out, const PcmLayout& layout, juce::int64 numFrames, juce::int64 dataBytes)
+    {
+        // Only the frame count in COMM changes; everything else describes the
+        // same samples as before.
+        juce::MemoryBlock comm(layout.formatChunk);
+        juce::ByteOrder::writeBigEndianInt(static_cast<char*>(comm.getData()) + 2, (juce::uint32)numFrames);
+
+        const auto commBytes = (juce::int64)comm.getSize();
+        auto formBytes = 4 + 8 + commBytes + (commBytes & 1) + 8 + 8 + dataBytes + (dataBytes & 1);
+
+        if (layout.isAifc)
+            formBytes += 12;
+
+        out.write("FORM", 4);
+        out.writeIntBigEndian((int)(juce::uint32)formBytes);
+        out.write(layout.isAifc ? "AIFC" : "AIFF", 4);
+
+        if (layout.isAifc)
+        {
+            // AIFC requires a version chunk; this is the only version there is.
+            out.write("FVER", 4);
+            out.writeIntBigEndian(4);
+            out.writeIntBigEndian((int)0xa2805140);
+        }
+
+        out.write("COMM", 4);
+        out.writeIntBigEndian((int)commBytes);
+        out << comm;
+
+        if ((commBytes & 1) != 0)
+            out.writeByte(0);
+
+        out.write("SSND", 4);
+        out.writeIntBigEndian((int)(juce::uint32)(8 + dataBytes));
+        out.writeIntBigEndian(0);
+        out.writeIntBigEndian(0);
+    }
+}
+
+SliceExportJob::SliceExportJob(ReaderFactory readerFactory, juce::int64 start,
+    juce::int64 length, const juce::File& destinationFile, std::function<void(const Result&)> callback)
+    : juce::ThreadPoolJob("Export " + destinationFile.getFileName()),
+    createReader(std::move(readerFactory)),
+    startSample(start),
+    numSamples(length),
+    destination(destinationFile),
+    onFinished(std::move(callback))
+{
+}
+
+bool SliceExportJob::canPassThrough(const juce::File& source, const juce::String& extension)
+{
+    const auto container = getContainer(source.getFileExtension());
+
+    return container == getContainer(extension)
+        && (container == "wav" || container == "aiff" || container == "mp3");
+}
+
+juce::ThreadPoolJob::JobStatus SliceExportJob::runJob()
+{
+    if (createReader != nullptr && !shouldExit())
+        reader.reset(createReader());
+
+    const auto result = exportRange();
+    reader.reset();
+
+    if (onFinished != nullptr)
+        onFinished(result);
+
+    return jobHasFinished;
+}
+
+SliceExportJob::Result SliceExportJob::exportRange()
+{
+    Result result;
+    result.file = destination;
+
+    if (shouldExit())
+    {
+        result.cancelled = true;
+        return result;
+    }
+
+    if (numSamples <= 0)
+    {
+        result.error = "Nothing to export";
+        return result;
+    }
+
+    if (reader == nullptr)
+    {
+        result.error = "Could not open the source file";
+        return result;
+    }
+
+    juce::TemporaryFile temp(destination);
+    std::unique_ptr<juce::FileOutputStream> stream(temp.getFile().createOutputStream());
+
+    if (stream == nullptr)
+    {
+        result.error = "Could not create " + temp.getFile().getFullPathName();
+        return result;
+    }
+
+    if (passThroughSource.existsAsFile() && canPassThrough(passThroughSource, destination.getFileExtension()))
+    {
+        juce::FileInputStream in(passThroughSource);
+
+        // A false return with no error means the file is laid out in a way
+        // that can't be copied directly, and nothing has been written yet.
+        if (in.openedOk())
+            result.passThrough = passThroughSource.hasFileExtension("mp3")
+                ? copyMp3Frames(in, *stream, result)
+                : copyPcmFrames(in, *stream, result);
+
+        if (result.cancelled || result.error.isNotEmpty())
+            return result;
+    }
+
+    if (result.passThrough)
+    {
+        stream->flush();
+
+        if (stream->getStatus().failed())
+        {
+            result.error = stream->getStatus().getErrorMessage();
+            return result;
+        }
+
+        stream.reset();
+    }
+    else if (destination.hasFileExtension("mp3"))
+    {
+        result.error = "MP3 slices are cut from the MP3 frames; none could be found in "
+            + passThroughSource.getFileName();
+        return result;
+    }
+    else if (!decodeRange(std::move(stream), result))
+    {
+        return result;
+    }
+
+    if (!temp.overwriteTargetFileWithTemporary())
+    {
+        result.error = "Could not write " + destination.getFullPathName();
+        return result;
+    }
+
+    result.succeeded = true;
+    return result;
+}
+
+bool SliceExportJob::decodeRange(std::unique_ptr<juce::OutputStream> stream, Result& result)
+{
+    const int numChannels = (int)reader->numChannels;
+    std::unique_ptr<juce::AudioFormat> format;
+
+    if (destination.hasFileExtension("aif;aiff"))
+        format = std::make_unique<juce::AiffAudioFormat>();
+    else
+        format = std::make_unique<juce::WavAudioFormat>();
+
+    // Keep the source's resolution; decoded float streams get 24 bits, which
+    // is beyond what any lossy source carries.
+    int bitDepth = reader->usesFloatingPointData ? 24 : (int)reader->bitsPerSample;
+    if (!format->getPossibleBitDepths().contains(bitDepth))
+        bitDepth = 24;
+
+    std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), reader->sampleRate,
+        (unsigned int)numChannels, bitDepth, juce::StringPairArray(), 0));
+
+    if (writer == nullptr)
+    {
+        result.error = "Could not create a " + format->getFormatName() + " writer";
+        return false;
+    }
+
+    stream.release();
+
+    juce::AudioBuffer<float> chunk(numChannels, (int)juce::jmin((juce::int64)chunkSize, numSamples));
+
+    for (juce::int64 done = 0; done < numSamples;)
+    {
+        if (shouldExit())
+        {
+            result.cancelled = true;
+            return false;
+        }
+
+        const int numThisTime = (int)juce::jmin((juce::int64)chunk.getNumSamples(), numSamples - done);
+
+        if (!reader->read(&chunk, 0, numThisTime, startSample + done, true, true)
+            || !writer->writeFromAudioSampleBuffer(chunk, 0, numThisTime))
+        {
+            result.error = "Reading or writing audio failed";
+            return false;
+        }
+
+        done += numThisTime;
+        progress = (float)((double)done / (double)numSamples);
+    }
+
+    // Deleting the writer finalises the header and closes the file.
+    writer.reset();
+    return true;
+}
+
+bool SliceExportJob::copyPcmFrames(juce::InputStream& in, juce::OutputStream& out, Result& result)
+{
+    PcmLayout layout;
+    const bool isAiff = getContainer(passThroughSource.getFileExtension()) == "aiff";
+
+    if (!(isAiff ? parseAiff(in, layout) : parseWav(in, layout)))
+        return false;
+
+    const auto firstFrame = juce::jlimit((juce::int64)0, layout.numFrames, startSample);
+    const auto numFrames = juce::jmin(numSamples, layout.numFrames - firstFrame);
+
+    if (numFrames <= 0)
+    {
+        result.error = "The slice lies outside the audio data";
+        return false;
+    }
+
+    const auto dataBytes = numFrames * layout.frameBytes;
+
+    if (isAiff)
+        writeAiffHeader(out, layout, numFrames, dataBytes);
+    else
+        writeWavHeader(out, layout, dataBytes);
+
+    if (!in.setPosition(layout.dataStart + firstFrame * layout.frameBytes) || !copyBytes(in, out, dataBytes, result))
+    {
+        if (!result.cancelled && result.error.isEmpty())
+            result.error = "Could not read " + passThroughSource.getFullPathName();
+
+        return false;
+    }
+
+    if ((dataBytes & 1) != 0)
+        out.writeByte(0);
+
+    return true;
+}
+
+bool SliceExportJob::copyMp3Frames(juce::InputStream& in, juce::OutputStream& out, Result& result)
+{
+    // The reader's sample 0 is the first sample after the encoder delay; the
+    // frames count from the first decoded sample.
+    const auto leadingSamples = GaplessInfo::readFromFile(passThroughSource).leadingSamples;
+    const auto index = SeekIndex::loadFromCache(passThroughSource);
+    SeekIndex::Mp3FrameRange range;
+
+    {
+        juce::BufferedInputStream buffered(in, 1 << 16);
+
+        if (!SeekIndex::findMp3FrameRange(buffered, index.get(), startSample + leadingSamples,
+            startSample + leadingSamples + numSamples, range))
+            return false;
+    }
+
+    // The cut widens to whole frames. The first one may borrow bits from a
+    // frame that was left behind, which decoders play as a frame of silence:
+    // the usual price of cutting MP3 without re-encoding it.
+    if (!in.setPosition(range.startByte) || !copyBytes(in, out, range.endByte - range.startByte, result))
+    {
+        if (!result.cancelled && result.error.isEmpty())
+            result.error = "Could not read " + passThroughSource.getFullPathName();
+
+        return false;
+    }
+
+    return true;
+}
+
+bool SliceExportJob::copyBytes(juce::InputStream& in, juce::OutputStream& out, juce::int64 numBytes, Result& result)
+{
+    constexpr int bufferBytes = 1 << 20;
+    juce::HeapBlock<char> buffer(bufferBytes);
+
+    for (juce::int64 done = 0; done < numBytes;)
+    {
+        if (shouldExit())
+        {
+            result.cancelled = true;
+            return false;
+        }
+
+        const int numThisTime = (int)juce::jmin((juce::int64)bufferBytes, numBytes - done);
+
+        if (in.read(buffer, numThisTime) != numThisTime)
+            return false;
+
+        if (!out.write(buffer, (size_t)numThisTime))
+        {
+            result.error = "Writing " + destination.getFullPathName() + " failed";
+            return false;
+        }
+
+        done += numThisTime;
+        progress = (float)((double)done / (double)numBytes);
+    }
+
+    return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Copies a range of a reader into a new file in fixed-size chunks, so memory
+// use stays the same however long the slice is. The file appears at its
+// destination only once it is complete; a cancelled or failed export leaves
+// nothing behind.
+//
+// When a pass-through source is set and the destination uses the same
+// container, the range is copied straight out of the source file instead:
+// PCM WAV and AIFF frames byte for byte at their original bit depth, MP3 as
+// whole frames. Anything else is decoded and written as WAV or AIFF.
+class SliceExportJob : public juce::ThreadPoolJob
+{
+public:
+    struct Result
+    {
+        bool succeeded = false;
+        bool cancelled = false;
+        bool passThrough = false;
+        juce::File file;
+        juce::String error;
+    };
+
+    static constexpr int chunkSize = 65536;
+
+    // Called on the worker thread when the job starts, so a batch of queued
+    // jobs holds no open files. The job owns the reader it returns.
+    using ReaderFactory = std::function<juce::AudioFormatReader*()>;
+
+    // onFinished is called on the worker thread.
+    SliceExportJob(ReaderFactory createReader, juce::int64 startSample,
+        juce::int64 numSamples, const juce::File& destination, std::function<void(const Result&)> onFinished);
+
+    // The file the reader was opened from; sample positions are in the
+    // reader's timeline, so MP3 gapless trimming is accounted for.
+    void setPassThroughSource(const juce::File& source) { passThroughSource = source; }
+
+    // True if a slice of source saved with this extension can be copied
+    // without decoding.
+    static bool canPassThrough(const juce::File& source, const juce::String& extension);
+
+    float getProgress() const { return progress.load(); }
+    const juce::File& getDestination() const { return destination; }
+
+    JobStatus runJob() override;
+
+private:
+    ReaderFactory createReader;
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    const juce::int64 startSample;
+    const juce::int64 numSamples;
+    const juce::File destination;
+    juce::File passThroughSource;
+    std::function<void(const Result&)> onFinished;
+    std::atomic<float> progress{ 0.0f };
+
+    Result exportRange();
+    bool decodeRange(std::unique_ptr<juce::OutputStream> stream, Result& result);
+    bool copyPcmFrames(juce::InputStream& in, juce::OutputStream& out, Result& result);
+    bool copyMp3Frames(juce::InputStream& in, juce::OutputStream& out, Result& result);
+    bool copyBytes(juce::InputStream& in, juce::OutputStream& out, juce::int64 numBytes, Result& result);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SliceExportJob)
+};
@@ -0,0 +1,175 @@
+#include "SpectrumAnalyser.h"
+#include "SimdKernels.h"
+
+SpectrumAnalyser::SpectrumAnalyser()
+    : juce::Thread("Spectrum analyser")
+{
+    startThread(juce::Thread::Priority::low);
+}
+
+SpectrumAnalyser::~SpectrumAnalyser()
+{
+    setSource(nullptr);
+    signalThreadShouldExit();
+    notify();
+    stopThread(2000);
+}
+
+void SpectrumAnalyser::setSource(AudioTap* newSource)
+{
+    auto* oldSource = source.exchange(newSource);
+
+    if (oldSource != nullptr && oldSource != newSource)
+        oldSource->setEnabled(false);
+
+    if (newSource != nullptr)
+        newSource->setEnabled(true);
+}
+
+void SpectrumAnalyser::setFftOrder(int newOrder)
+{
+    fftOrder.store(juce::jlimit(minOrder, maxOrder, newOrder));
+}
+
+void SpectrumAnalyser::setOverlap(int newOverlap)
+{
+    overlap.store(juce::jlimit(1, maxOverlap, juce::nextPowerOfTwo(juce::jmax(1, newOverlap))));
+}
+
+bool SpectrumAnalyser::readLatest(Frame& frame)
+{
+    if (!latest.update())
+        return false;
+
+    frame = latest.getReadBuffer();
+    return true;
+}
+
+int SpectrumAnalyser::readFrames(Frame* dest, int maxFrames)
+{
+    const auto scope = frameFifo.read(juce::jmin(maxFrames, frameFifo.getNumReady()));
+    int numCopied = 0;
+    scope.forEach([&](int index) { dest[numCopied++] = frameQueue[(size_t)index]; });
+    return numCopied;
+}
+
+float SpectrumAnalyser::getBandFrequency(float band) const
+{
+    const float nyquist = (float)getSampleRate() * 0.5f;
+    return minFrequency * std::pow(nyquist / minFrequency, (band + 0.5f) / (float)numBands);
+}
+
+void SpectrumAnalyser::configure()
+{
+    currentOrder = fftOrder.load();
+    currentSampleRate = sampleRate.load();
+
+    fft = std::make_unique<RealFft>(currentOrder);
+    const int size = fft->getSize();
+    const int numBins = fft->getNumBins();
+    currentHop = size / overlap.load();
+
+    window.resize((size_t)size);
+    float windowSum = 0.0f;
+
+    for (int i = 0; i < size; ++i)
+    {
+        window[(size_t)i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float)i / (float)size);
+        windowSum += window[(size_t)i];
+    }
+
+    // A full-scale sine at the centre of a bin reads 0 dB.
+    powerScale = 4.0f / (windowSum * windowSum);
+
+    history.assign((size_t)size, 0.0f);
+    windowed.resize((size_t)size);
+    spectrum.resize((size_t)(2 * numBins));
+    power.resize((size_t)numBins);
+    numFilled = 0;
+
+    // Each band takes the strongest bin between its edges; the narrow bands
+    // at the bottom, less than a bin wide, take the bin they fall in.
+    const double binWidth = currentSampleRate / size;
+    const double nyquist = currentSampleRate * 0.5;
+
+    for (int band = 0; band < numBands; ++band)
+    {
+        const double low = minFrequency * std::pow(nyquist / minFrequency, (double)band / numBands);
+        const double high = minFrequency * std::pow(nyquist / minFrequency, (double)(band + 1) / numBands);
+
+        const int start = juce::jlimit(0, numBins - 1, (int)std::lround(low / binWidth));
+        bandStart[(size_t)band] = start;
+        bandEnd[(size_t)band] = juce::jlimit(start + 1, numBins, (int)std::lround(high / binWidth));
+    }
+}
+
+void SpectrumAnalyser::analyse()
+{
+    const int size = fft->getSize();
+
+    juce::FloatVectorOperations::multiply(windowed.data(), history.data(), window.data(), size);
+    fft->perform(windowed.data(), spectrum.data());
+    SimdKernels::powerSpectrum(spectrum.data(), power.data(), fft->getNumBins());
+
+    auto& frame = latest.getWriteBuffer();
+
+    for (int band = 0; band < numBands; ++band)
+    {
+        const float* first = power.data() + bandStart[(size_t)band];
+        const float strongest = juce::FloatVectorOperations::findMaximum(first, bandEnd[(size_t)band] - bandStart[(size_t)band]);
+        frame.db[(size_t)band] = juce::jmax(floorDb, 10.0f * std::log10(strongest * powerScale + 1.0e-12f));
+    }
+
+    const auto scope = frameFifo.write(1);
+    if (scope.blockSize1 > 0)
+        frameQueue[(size_t)scope.startIndex1] = frame;
+
+    latest.publish();
+}
+
+void SpectrumAnalyser::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+
+        auto* tap = source.load();
+        if (tap == nullptr)
+        {
+            currentSource = nullptr;
+            continue;
+        }
+
+        if (fft == nullptr || currentOrder != fftOrder.load() || currentHop != fft->getSize() / overlap.load()
+            || currentSampleRate != sampleRate.load())
+            configure();
+
+        const int size = fft->getSize();
+
+        // A new source, or audio left over from while nobody was watching:
+        // start from what has just arrived.
+        if (tap != currentSource || tap->getNumReady() > juce::jmax(2 * size, (int)(currentSampleRate * 0.25)))
+        {
+            currentSource = tap;
+            tap->discard(juce::jmax(0, tap->getNumReady() - size));
+            numFilled = 0;
+        }
+
+        for (;;)
+        {
+            const int needed = numFilled < size ? size - numFilled : currentHop;
+            if (tap->getNumReady() < needed || threadShouldExit())
+                break;
+
+            if (numFilled == size)
+            {
+                std::copy(history.begin() + currentHop, history.end(), history.begin());
+                numFilled = size - currentHop;
+            }
+
+            tap->read(history.data() + numFilled, needed);
+            numFilled = size;
+            analyse();
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+#include "AudioTap.h"
+#include "RealFft.h"
+#include "TripleBuffer.h"
+
+// Short-time spectrum of whichever AudioTap is selected, worked out on a
+// thread of its own. Each frame is a Hann-windowed RealFft of 2^order
+// samples, a new one every size / overlap samples, reduced to numBands
+// log-spaced bands in dB so the display doesn't depend on the FFT size.
+//
+// The thread only runs when poll() is called, once per UI update, and goes
+// through whatever audio has arrived since. The audio thread never signals
+// it, and while the UI is idle it sleeps. A backlog from while it slept is
+// skipped rather than caught up on.
+class SpectrumAnalyser : private juce::Thread
+{
+public:
+    static constexpr int numBands = 128;
+    static constexpr float minFrequency = 20.0f;
+    static constexpr float floorDb = -100.0f;
+    static constexpr int minOrder = 10;
+    static constexpr int maxOrder = 14;
+    static constexpr int maxOverlap = 8;
+
+    struct Frame
+    {
+        // Lowest band first.
+        std::array<float, numBands> db{};
+    };
+
+    SpectrumAnalyser();
+    ~SpectrumAnalyser() override;
+
+    // Message thread. The tap is enabled while it is the source and disabled
+    // again when it is replaced; nullptr stops the analysis.
+    void setSource(AudioTap* newSource);
+
+    // Any thread, typically the audio device's prepareToPlay.
+    void setSampleRate(double newSampleRate) { sampleRate.store(newSampleRate); }
+    double getSampleRate() const { return sampleRate.load(); }
+
+    // Message thread. Take effect from the next frame.
+    void setFftOrder(int newOrder);
+    int getFftOrder() const { return fftOrder.load(); }
+    void setOverlap(int newOverlap);
+    int getOverlap() const { return overlap.load(); }
+
+    // Message thread: lets the analyser work through the audio that has
+    // arrived since the last call.
+    void poll() { notify(); }
+
+    // Message thread: the newest frame, if there is one since last time.
+    bool readLatest(Frame& frame);
+
+    // Message thread: frames finished since the last call, oldest first, for
+    // the spectrogram. Returns how many were copied.
+    int readFrames(Frame* dest, int maxFrames);
+
+    // Centre frequency of a band at the current sample rate.
+    float getBandFrequency(float band) const;
+
+private:
+    std::atomic<AudioTap*> source{ nullptr };
+    std::atomic<double> sampleRate{ 44100.0 };
+    std::atomic<int> fftOrder{ 11 };
+    std::atomic<int> overlap{ 4 };
+
+    TripleBuffer<Frame> latest;
+
+    static constexpr int frameQueueSize = 256;
+    juce::AbstractFifo frameFifo{ frameQueueSize };
+    std::array<Frame, frameQueueSize> frameQueue;
+
+    // Analyser thread only.
+    AudioTap* currentSource = nullptr;
+    int currentOrder = 0;
+    int currentHop = 0;
+    double currentSampleRate = 0.0;
+    std::unique_ptr<RealFft> fft;
+    std::vector<float> window, history, windowed, spectrum, power;
+    std::array<int, numBands> bandStart{}, bandEnd{};
+    float powerScale = 1.0f;
+    int numFilled = 0;
+
+    void run() override;
+    void configure();
+    void analyse();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumAnalyser)
+};
@@ -0,0 +1,229 @@
+#include "SpectrumView.h"
+
+namespace
+{
+    constexpr float displayFloorDb = -90.0f;
+    constexpr int controlsWidth = 110;
+}
+
+SpectrumView::SpectrumView(SpectrumAnalyser& analyserToShow, const juce::Array<Source>& sourcesToOffer)
+    : analyser(analyserToShow),
+    sources(sourcesToOffer),
+    newFrames(256)
+{
+    juce::ColourGradient heat(juce::Colours::black, 0.0f, 0.0f, juce::Colours::white, 1.0f, 0.0f, false);
+    heat.addColour(0.25, juce::Colour::fromRGB(30, 20, 110));
+    heat.addColour(0.5, juce::Colour::fromRGB(150, 40, 160));
+    heat.addColour(0.75, juce::Colours::orange);
+    heat.addColour(0.9, juce::Colours::yellow);
+
+    for (size_t i = 0; i < palette.size(); ++i)
+        palette[i] = heat.getColourAtPosition((double)i / (double)(palette.size() - 1));
+
+    for (int i = 0; i < sources.size(); ++i)
+        sourceBox.addItem(sources.getReference(i).name, i + 1);
+
+    for (int order = SpectrumAnalyser::minOrder; order <= SpectrumAnalyser::maxOrder; ++order)
+        sizeBox.addItem(juce::String(1 << order) + " pt", order);
+
+    overlapBox.addItem("No overlap", 1);
+    overlapBox.addItem("50% overlap", 2);
+    overlapBox.addItem("75% overlap", 4);
+    overlapBox.addItem("87.5% overlap", 8);
+
+    for (auto* box : { &sourceBox, &sizeBox, &overlapBox })
+    {
+        box->addListener(this);
+        addAndMakeVisible(box);
+    }
+
+    setSourceIndex(0);
+}
+
+SpectrumView::~SpectrumView()
+{
+    analyser.setSource(nullptr);
+}
+
+void SpectrumView::setSourceIndex(int index)
+{
+    if (!juce::isPositiveAndBelow(index, sources.size()))
+        return;
+
+    sourceIndex = index;
+    analyser.setSource(sources.getReference(index).tap);
+    updateBoxes();
+}
+
+void SpectrumView::updateBoxes()
+{
+    sourceBox.setSelectedId(sourceIndex + 1, juce::dontSendNotification);
+    sizeBox.setSelectedId(analyser.getFftOrder(), juce::dontSendNotification);
+    overlapBox.setSelectedId(analyser.getOverlap(), juce::dontSendNotification);
+}
+
+void SpectrumView::comboBoxChanged(juce::ComboBox* box)
+{
+    if (box == &sourceBox)
+        setSourceIndex(sourceBox.getSelectedId() - 1);
+    else if (box == &sizeBox)
+        analyser.setFftOrder(sizeBox.getSelectedId());
+    else if (box == &overlapBox)
+        analyser.setOverlap(overlapBox.getSelectedId());
+
+    updateBoxes();
+}
+
+void SpectrumView::update()
+{
+    analyser.poll();
+
+    SpectrumAnalyser::Frame latest;
+
+    if (analyser.readLatest(latest))
+    {
+        const bool unchanged = hasSpectrum
+            && (latest.db == spectrum.db || (isAtFloor(latest) && isAtFloor(spectrum)));
+
+        spectrum = latest;
+        hasSpectrum = true;
+
+        if (!unchanged)
+            repaint(spectrumArea);
+    }
+
+    const int numNew = analyser.readFrames(newFrames.data(), (int)newFrames.size());
+    bool drewAny = false;
+
+    for (int i = 0; i < numNew; ++i)
+    {
+        const auto& frame = newFrames[(size_t)i];
+        const bool atFloor = isAtFloor(frame);
+
+        // Scrolling in more silence wouldn't change a single pixel.
+        if (atFloor && floorColumns >= spectrogram.getWidth())
+            continue;
+
+        drawColumn(frame);
+        drewAny = true;
+        floorColumns = atFloor ? floorColumns + 1 : 0;
+    }
+
+    if (drewAny)
+        repaint(spectrogramArea);
+}
+
+bool SpectrumView::isAtFloor(const SpectrumAnalyser::Frame& frame)
+{
+    return std::all_of(frame.db.begin(), frame.db.end(), [](float db) { return db <= displayFloorDb; });
+}
+
+float SpectrumView::dbToProportion(float db) const
+{
+    return juce::jlimit(0.0f, 1.0f, (db - displayFloorDb) / -displayFloorDb);
+}
+
+void SpectrumView::drawColumn(const SpectrumAnalyser::Frame& frame)
+{
+    if (!spectrogram.isValid())
+        return;
+
+    const int height = spectrogram.getHeight();
+    juce::Image::BitmapData pixels(spectrogram, nextColumn, 0, 1, height, juce::Image::BitmapData::writeOnly);
+
+    for (int y = 0; y < height; ++y)
+    {
+        const float db = frame.db[(size_t)(SpectrumAnalyser::numBands - 1 - y)];
+        const auto index = (size_t)juce::roundToInt(dbToProportion(db) * (float)(palette.size() - 1));
+        pixels.setPixelColour(0, y, palette[index]);
+    }
+
+    nextColumn = (nextColumn + 1) % spectrogram.getWidth();
+}
+
+void SpectrumView::resized()
+{
+    auto area = getLocalBounds();
+
+    auto controls = area.removeFromLeft(controlsWidth);
+    const int boxHeight = juce::jmin(24, controls.getHeight() / 3);
+    sourceBox.setBounds(controls.removeFromTop(boxHeight).reduced(2));
+    sizeBox.setBounds(controls.removeFromTop(boxHeight).reduced(2));
+    overlapBox.setBounds(controls.removeFromTop(boxHeight).reduced(2));
+
+    area.removeFromLeft(6);
+    spectrumArea = area.removeFromLeft(area.getWidth() * 2 / 5);
+    area.removeFromLeft(6);
+    spectrogramArea = area;
+
+    if (spectrogramArea.getWidth() > 0 && spectrogram.getWidth() != spectrogramArea.getWidth())
+    {
+        spectrogram = juce::Image(juce::Image::RGB, spectrogramArea.getWidth(), SpectrumAnalyser::numBands, true);
+        nextColumn = 0;
+
+        // Cleared to black, the floor's colour.
+        floorColumns = spectrogram.getWidth();
+    }
+}
+
+void SpectrumView::paint(juce::Graphics& g)
+{
+    g.setColour(juce::Colours::black.withAlpha(0.5f));
+    g.fillRoundedRectangle(spectrumArea.toFloat(), 4.0f);
+
+    const auto curveArea = spectrumArea.toFloat().reduced(2.0f);
+    const float nyquist = (float)analyser.getSampleRate() * 0.5f;
+
+    // Decade lines at 100 Hz, 1 kHz and 10 kHz.
+    g.setColour(juce::Colours::white.withAlpha(0.15f));
+    for (float frequency : { 100.0f, 1000.0f, 10000.0f })
+    {
+        if (frequency >= nyquist)
+            continue;
+
+        const float position = std::log(frequency / SpectrumAnalyser::minFrequency)
+            / std::log(nyquist / SpectrumAnalyser::minFrequency);
+        g.drawVerticalLine(juce::roundToInt(curveArea.getX() + position * curveArea.getWidth()),
+            curveArea.getY(), curveArea.getBottom());
+    }
+
+    if (hasSpectrum)
+    {
+        juce::Path curve;
+        curve.startNewSubPath(curveArea.getBottomLeft());
+
+        for (int band = 0; band < SpectrumAnalyser::numBands; ++band)
+        {
+            const float x = curveArea.getX() + curveArea.getWidth() * ((float)band + 0.5f) / SpectrumAnalyser::numBands;
+            const float y = curveArea.getBottom() - dbToProportion(spectrum.db[(size_t)band]) * curveArea.getHeight();
+            curve.lineTo(x, y);
+        }
+
+        curve.lineTo(curveArea.getBottomRight());
+        curve.closeSubPath();
+
+        g.setGradientFill(juce::ColourGradient(juce::Colours::orange.withAlpha(0.8f), 0.0f, curveArea.getY(),
+            juce::Colour::fromRGB(60, 40, 150).withAlpha(0.6f), 0.0f, curveArea.getBottom(), false));
+        g.fillPath(curve);
+    }
+
+    if (spectrogram.isValid())
+    {
+        // The ring's oldest columns, from nextColumn on, go on the left.
+        const int width = spectrogram.getWidth();
+        const int height = spectrogram.getHeight();
+        const int numOlder = width - nextColumn;
+        const auto area = spectrogramArea;
+
+        g.setImageResamplingQuality(juce::Graphics::lowResamplingQuality);
+
+        if (numOlder > 0)
+            g.drawImage(spectrogram, area.getX(), area.getY(), numOlder, area.getHeight(), nextColumn, 0, numOlder, height);
+
+        if (nextColumn > 0)
+            g.drawImage(spectrogram, area.getX() + numOlder, area.getY(), nextColumn, area.getHeight(), 0, 0, nextColumn, height);
+    }
+
+    g.setColour(juce::Colours::white.withAlpha(0.2f));
+    g.drawRect(spectrogramArea);
+}
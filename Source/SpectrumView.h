@@ -0,0 +1,62 @@
+#pragma once
+#include <JuceHeader.h>
+#include "SpectrumAnalyser.h"
+
+// The analyser's latest spectrum as a curve, beside a spectrogram that
+// scrolls from right to left, newest at the right. The spectrogram is kept
+// in an image used as a ring of columns: each update draws only the frames
+// that have arrived since the last into it, and painting blits the two
+// halves of the ring in order. Nothing is repainted for a curve that hasn't
+// changed, or for silence once the spectrogram is all silence.
+//
+// Combo boxes along the left pick the source and the FFT size and overlap.
+class SpectrumView : public juce::Component,
+    private juce::ComboBox::Listener
+{
+public:
+    struct Source
+    {
+        juce::String name;
+        AudioTap* tap = nullptr;
+    };
+
+    SpectrumView(SpectrumAnalyser& analyserToShow, const juce::Array<Source>& sourcesToOffer);
+    ~SpectrumView() override;
+
+    // Message thread, once per UI update. Repaints only what changed.
+    void update();
+
+    void setSourceIndex(int index);
+    int getSourceIndex() const { return sourceIndex; }
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    SpectrumAnalyser& analyser;
+    const juce::Array<Source> sources;
+    int sourceIndex = 0;
+
+    juce::ComboBox sourceBox, sizeBox, overlapBox;
+
+    juce::Rectangle<int> spectrumArea, spectrogramArea;
+
+    SpectrumAnalyser::Frame spectrum;
+    bool hasSpectrum = false;
+
+    juce::Image spectrogram;
+    int nextColumn = 0;
+
+    // How many of the newest columns are at the floor, up to the width.
+    int floorColumns = 0;
+    std::vector<SpectrumAnalyser::Frame> newFrames;
+    std::array<juce::Colour, 256> palette;
+
+    void comboBoxChanged(juce::ComboBox* box) override;
+    void updateBoxes();
+    void drawColumn(const SpectrumAnalyser::Frame& frame);
+    float dbToProportion(float db) const;
+    static bool isAtFloor(const SpectrumAnalyser::Frame& frame);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumView)
+};
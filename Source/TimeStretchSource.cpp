@@ -0,0 +1,345 @@
+#include "TimeStretchSource.h"
+#include "SimdKernels.h"
+
+namespace
+{
+    struct TierSettings
+    {
+        double frameMs;
+        double searchMs;
+        int coarseStep;
+        int correlationDivisor;
+    };
+
+    // Longer frames smear transients less audibly on tonal material; a wider,
+    // finer search finds better splice points. Both cost CPU.
+    TierSettings getTierSettings(TimeStretchSource::Quality quality)
+    {
+        switch (quality)
+        {
+        case TimeStretchSource::Quality::fast:   return { 30.0, 6.0, 4, 2 };
+        case TimeStretchSource::Quality::high:   return { 50.0, 15.0, 1, 1 };
+        case TimeStretchSource::Quality::normal: break;
+        }
+
+        return { 40.0, 10.0, 2, 1 };
+    }
+
+    constexpr double maxSampleRate = 192000.0;
+
+    int getFrameLength(const TierSettings& settings, double sampleRate)
+    {
+        return juce::jmax(64, 2 * juce::roundToInt(settings.frameMs * sampleRate / 2000.0));
+    }
+
+    int getSearchRadius(const TierSettings& settings, double sampleRate)
+    {
+        return juce::jmax(1, juce::roundToInt(settings.searchMs * sampleRate / 1000.0));
+    }
+}
+
+TimeStretchSource::TimeStretchSource(juce::AudioSource* inputSource, int numChannels)
+    : input(inputSource),
+    numberOfChannels(numChannels)
+{
+    jassert(input != nullptr);
+}
+
+void TimeStretchSource::setEnabled(bool shouldBeEnabled)
+{
+    if (enabled != shouldBeEnabled)
+    {
+        enabled = shouldBeEnabled;
+        reset();
+    }
+}
+
+void TimeStretchSource::setQuality(Quality newQuality)
+{
+    if (quality != newQuality)
+    {
+        quality = newQuality;
+        updateParameters();
+    }
+}
+
+void TimeStretchSource::setSourceSampleRate(double newSampleRate)
+{
+    if (newSampleRate > 0.0 && newSampleRate != sourceSampleRate)
+    {
+        sourceSampleRate = juce::jmin(newSampleRate, maxSampleRate);
+        updateParameters();
+    }
+}
+
+void TimeStretchSource::setSourceSampleRateAtInput(double newSampleRate, int offsetInPull)
+{
+    if (newSampleRate <= 0.0)
+        return;
+
+    if (!enabled || frameLength == 0)
+    {
+        // Passing straight through, so the change leaves at the offset it came in at.
+        if (juce::jmin(newSampleRate, maxSampleRate) != sourceSampleRate)
+        {
+            sourceSampleRate = juce::jmin(newSampleRate, maxSampleRate);
+            parametersStale = true;
+        }
+
+        if (onSourceRateChanged != nullptr)
+            onSourceRateChanged(newSampleRate, offsetInPull);
+
+        return;
+    }
+
+    pendingSampleRate = newSampleRate;
+    rateChangePosition = pullStart + juce::jmax(0, offsetInPull);
+}
+
+void TimeStretchSource::reset()
+{
+    // Frame sizes left behind by a rate change are only swapped here, where
+    // there is no overlap to carry across them.
+    if (parametersStale && window != nullptr)
+    {
+        updateParameters();
+        return;
+    }
+
+    inputCount = 0;
+    outputCount = 0;
+    outputReadPosition = 0;
+    analysisPosition = 0.0;
+    previousFramePosition = 0;
+    isFirstFrame = true;
+    rateChangePosition = -1;
+    rateChangeOutputPosition = -1;
+    overlapBuffer.clear();
+    cpuLoad = 0.0f;
+}
+
+void TimeStretchSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    const auto largest = getTierSettings(Quality::high);
+    const int maxFrameLength = getFrameLength(largest, maxSampleRate);
+    const int maxSearchRadius = getSearchRadius(largest, maxSampleRate);
+
+    inputCapacity = 3 * maxFrameLength + 4 * maxSearchRadius + 1024;
+    inputBuffer.setSize(numberOfChannels, inputCapacity);
+    monoInput.allocate((size_t)inputCapacity, true);
+    overlapBuffer.setSize(numberOfChannels, maxFrameLength);
+    outputBuffer.setSize(numberOfChannels, maxFrameLength / 2);
+    window.allocate((size_t)maxFrameLength, true);
+
+    if (sourceSampleRate <= 0.0)
+        sourceSampleRate = juce::jmin(sampleRate, maxSampleRate);
+
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    updateParameters();
+}
+
+void TimeStretchSource::releaseResources()
+{
+    input->releaseResources();
+}
+
+void TimeStretchSource::updateParameters()
+{
+    if (window == nullptr)
+        return;
+
+    parametersStale = false;
+    const auto settings = getTierSettings(quality);
+    frameLength = getFrameLength(settings, sourceSampleRate);
+    synthesisHop = frameLength / 2;
+    searchRadius = getSearchRadius(settings, sourceSampleRate);
+    coarseStep = settings.coarseStep;
+    correlationLength = synthesisHop / settings.correlationDivisor;
+
+    // Periodic Hann: at 50% overlap consecutive windows sum to exactly one.
+    for (int i = 0; i < frameLength; ++i)
+        window[i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float)i / (float)frameLength);
+
+    reset();
+}
+
+void TimeStretchSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (!enabled || frameLength == 0)
+    {
+        input->getNextAudioBlock(bufferToFill);
+        return;
+    }
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    int written = 0;
+
+    while (written < bufferToFill.numSamples)
+    {
+        if (outputReadPosition >= outputCount)
+            processFrame();
+
+        const int numToCopy = juce::jmin(outputCount - outputReadPosition, bufferToFill.numSamples - written);
+
+        if (rateChangeOutputPosition >= 0 && rateChangeOutputPosition < outputReadPosition + numToCopy)
+            finishRateChange(written + juce::jmax(0, rateChangeOutputPosition - outputReadPosition));
+
+        for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+        {
+            if (ch < numberOfChannels)
+                bufferToFill.buffer->copyFrom(ch, bufferToFill.startSample + written,
+                    outputBuffer, ch, outputReadPosition, numToCopy);
+            else
+                bufferToFill.buffer->clear(ch, bufferToFill.startSample + written, numToCopy);
+        }
+
+        outputReadPosition += numToCopy;
+        written += numToCopy;
+    }
+
+    const double elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    const double blockDuration = bufferToFill.numSamples / sourceSampleRate;
+    cpuLoad = 0.9f * cpuLoad.load() + 0.1f * (float)(elapsed / blockDuration);
+}
+
+void TimeStretchSource::finishRateChange(int offsetInBlock)
+{
+    sourceSampleRate = juce::jmin(pendingSampleRate, maxSampleRate);
+    parametersStale = true;
+    rateChangeOutputPosition = -1;
+
+    if (onSourceRateChanged != nullptr)
+        onSourceRateChanged(pendingSampleRate, offsetInBlock);
+}
+
+void TimeStretchSource::processFrame()
+{
+    const int target = (int)analysisPosition;
+    const int natural = previousFramePosition + synthesisHop;
+    const int searchEnd = isFirstFrame ? target : target + searchRadius;
+
+    if (!pullInput(juce::jmax(searchEnd, natural) + frameLength))
+    {
+        jassertfalse;
+        reset();
+        outputBuffer.clear();
+        outputCount = synthesisHop;
+        return;
+    }
+
+    const int best = isFirstFrame ? target : findBestFramePosition(target, natural);
+
+    // Within a frame, output follows input sample for sample, so the change
+    // sounds as far into this frame's hop as it sits past the frame's start.
+    if (rateChangePosition >= 0 && rateChangePosition < best + synthesisHop)
+    {
+        rateChangeOutputPosition = juce::jlimit(0, synthesisHop - 1, rateChangePosition - best);
+        rateChangePosition = -1;
+    }
+
+    for (int ch = 0; ch < numberOfChannels; ++ch)
+    {
+        auto* overlap = overlapBuffer.getWritePointer(ch);
+        SimdKernels::addWindowed(overlap, inputBuffer.getReadPointer(ch, best), window, frameLength);
+
+        outputBuffer.copyFrom(ch, 0, overlap, synthesisHop);
+        std::memmove(overlap, overlap + synthesisHop, sizeof(float) * (size_t)(frameLength - synthesisHop));
+        juce::FloatVectorOperations::clear(overlap + frameLength - synthesisHop, synthesisHop);
+    }
+
+    outputCount = synthesisHop;
+    outputReadPosition = 0;
+
+    previousFramePosition = best;
+    analysisPosition += synthesisHop * stretchRatio;
+    isFirstFrame = false;
+
+    const int firstNeeded = juce::jmin(previousFramePosition + synthesisHop, (int)analysisPosition - searchRadius);
+    if (firstNeeded > 0)
+        discardInput(firstNeeded);
+}
+
+bool TimeStretchSource::pullInput(int samplesNeeded)
+{
+    if (samplesNeeded > inputCapacity)
+        return false;
+
+    const int numToRead = samplesNeeded - inputCount;
+    if (numToRead <= 0)
+        return true;
+
+    pullStart = inputCount;
+    input->getNextAudioBlock(juce::AudioSourceChannelInfo(&inputBuffer, inputCount, numToRead));
+
+    auto* mono = monoInput.get() + inputCount;
+
+    if (numberOfChannels == 1)
+    {
+        juce::FloatVectorOperations::copy(mono, inputBuffer.getReadPointer(0, inputCount), numToRead);
+    }
+    else
+    {
+        juce::FloatVectorOperations::copyWithMultiply(mono, inputBuffer.getReadPointer(0, inputCount), 0.5f, numToRead);
+        juce::FloatVectorOperations::addWithMultiply(mono, inputBuffer.getReadPointer(1, inputCount), 0.5f, numToRead);
+    }
+
+    inputCount = samplesNeeded;
+    return true;
+}
+
+int TimeStretchSource::findBestFramePosition(int target, int natural) const
+{
+    const int lowest = juce::jmax(0, target - searchRadius);
+    const int highest = target + searchRadius;
+    const float* reference = monoInput.get() + natural;
+
+    int best = juce::jlimit(lowest, highest, target);
+    float bestScore = -std::numeric_limits<float>::max();
+
+    auto tryPosition = [&](int position)
+    {
+        const float score = SimdKernels::dotProduct(reference, monoInput.get() + position, correlationLength);
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = position;
+        }
+    };
+
+    for (int position = lowest; position <= highest; position += coarseStep)
+        tryPosition(position);
+
+    if (coarseStep > 1)
+    {
+        const int coarseBest = best;
+
+        for (int position = juce::jmax(lowest, coarseBest - coarseStep + 1);
+            position <= juce::jmin(highest, coarseBest + coarseStep - 1); ++position)
+            if (position != coarseBest)
+                tryPosition(position);
+    }
+
+    return best;
+}
+
+void TimeStretchSource::discardInput(int numSamples)
+{
+    numSamples = juce::jmin(numSamples, inputCount);
+    const int remaining = inputCount - numSamples;
+
+    for (int ch = 0; ch < numberOfChannels; ++ch)
+    {
+        auto* data = inputBuffer.getWritePointer(ch);
+        std::memmove(data, data + numSamples, sizeof(float) * (size_t)remaining);
+    }
+
+    std::memmove(monoInput.get(), monoInput.get() + numSamples, sizeof(float) * (size_t)remaining);
+
+    inputCount = remaining;
+    analysisPosition -= numSamples;
+    previousFramePosition -= numSamples;
+
+    if (rateChangePosition >= 0)
+        rateChangePosition = juce::jmax(0, rateChangePosition - numSamples);
+}
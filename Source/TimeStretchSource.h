@@ -0,0 +1,93 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Pitch-preserving time-stretch (WSOLA). Output frames are overlap-added at a
+// fixed hop, while the matching input frames advance by hop * ratio; each
+// input frame is nudged within a search window to the offset that best lines
+// up with the previous frame's natural continuation, which is what keeps the
+// waveform phase-coherent across the splice.
+//
+// Everything after prepareToPlay() runs on the audio thread and never
+// allocates: buffers are sized for the most expensive tier at 192 kHz.
+class TimeStretchSource : public juce::AudioSource
+{
+public:
+    enum class Quality
+    {
+        fast,
+        normal,
+        high
+    };
+
+    TimeStretchSource(juce::AudioSource* inputSource, int numChannels = 2);
+
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const { return enabled; }
+    void setQuality(Quality newQuality);
+    void setStretchRatio(double newRatio) { stretchRatio = juce::jlimit(0.25, 4.0, newRatio); }
+    void setSourceSampleRate(double newSampleRate);
+    void reset();
+
+    // For an input whose sample rate changes mid-block, as at a gapless
+    // splice: called from inside the input's getNextAudioBlock, with the
+    // offset of the first sample at the new rate from that call's startSample.
+    // Nothing is reset; the frame sizes catch up at the next reset(). Once the
+    // output reaches the change, onSourceRateChanged gets the offset into the
+    // block being filled.
+    void setSourceSampleRateAtInput(double newSampleRate, int offsetInPull);
+    std::function<void(double newSampleRate, int offsetInBlock)> onSourceRateChanged;
+
+    // Smoothed share of real time this stage takes, including pulling its input.
+    float getCpuLoad() const { return cpuLoad.load(); }
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+private:
+    juce::AudioSource* input;
+    const int numberOfChannels;
+
+    bool enabled = false;
+    Quality quality = Quality::normal;
+    double stretchRatio = 1.0;
+    double sourceSampleRate = 44100.0;
+
+    int frameLength = 0;
+    int synthesisHop = 0;
+    int searchRadius = 0;
+    int coarseStep = 1;
+    int correlationLength = 0;
+
+    juce::AudioBuffer<float> inputBuffer;
+    juce::HeapBlock<float> monoInput;
+    int inputCount = 0;
+    int inputCapacity = 0;
+    int pullStart = 0;
+
+    juce::AudioBuffer<float> overlapBuffer;
+    juce::AudioBuffer<float> outputBuffer;
+    int outputCount = 0;
+    int outputReadPosition = 0;
+
+    juce::HeapBlock<float> window;
+    double analysisPosition = 0.0;
+    int previousFramePosition = 0;
+    bool isFirstFrame = true;
+
+    double pendingSampleRate = 0.0;
+    int rateChangePosition = -1;
+    int rateChangeOutputPosition = -1;
+    bool parametersStale = false;
+
+    std::atomic<float> cpuLoad{ 0.0f };
+
+    void updateParameters();
+    void processFrame();
+    void finishRateChange(int offsetInBlock);
+    bool pullInput(int samplesNeeded);
+    int findBestFramePosition(int target, int natural) const;
+    void discardInput(int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TimeStretchSource)
+};
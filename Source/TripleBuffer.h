@@ -0,0 +1,46 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+
+// Hands the latest value of T from one writer thread to one reader thread.
+// Neither side waits, locks or allocates: the writer always has a slot of
+// its own to fill, and publishing swaps it with the shared middle slot; the
+// reader swaps its own slot with the middle one only when something newer
+// is there. Values the reader never got round to are simply overwritten.
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Writer only: the slot to fill before publish().
+    T& getWriteBuffer() noexcept { return buffers[(size_t)writeIndex]; }
+
+    void publish() noexcept
+    {
+        writeIndex = middle.exchange(writeIndex | freshBit, std::memory_order_acq_rel) & indexMask;
+    }
+
+    // Reader only: takes the most recently published value, if there is one
+    // newer than the last. Returns false, leaving getReadBuffer() as it was,
+    // if not.
+    bool update() noexcept
+    {
+        if ((middle.load(std::memory_order_relaxed) & freshBit) == 0)
+            return false;
+
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    const T& getReadBuffer() const noexcept { return buffers[(size_t)readIndex]; }
+
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int freshBit = 4;
+
+    std::array<T, 3> buffers{};
+    int writeIndex = 0;
+    int readIndex = 1;
+    std::atomic<int> middle{ 2 };
+
+    static_assert(std::atomic<int>::is_always_lock_free);
+};
@@ -0,0 +1,74 @@
+#include "UiUpdateScheduler.h"
+
+UiUpdateScheduler::UiUpdateScheduler(juce::Component& componentToWatch, std::function<bool()> updateFunction)
+    : juce::ComponentMovementWatcher(&componentToWatch),
+    component(componentToWatch),
+    update(std::move(updateFunction))
+{
+    component.addMouseListener(this, true);
+}
+
+UiUpdateScheduler::~UiUpdateScheduler()
+{
+    cancelPendingUpdate();
+    vblank.reset();
+    component.removeMouseListener(this);
+}
+
+void UiUpdateScheduler::wake()
+{
+    // Commands reach the audio thread a block or so later, so a play press
+    // can't be seen straight away; keep running a moment whatever the
+    // update says.
+    wakeUntilMs = juce::Time::getMillisecondCounter() + wakeHoldMs;
+
+    // While running, the next blank will pick the change up anyway.
+    if (vblank == nullptr || stopping)
+        triggerAsyncUpdate();
+}
+
+bool UiUpdateScheduler::runUpdate()
+{
+    const bool wantsMore = update();
+    return wantsMore || (int)(wakeUntilMs - juce::Time::getMillisecondCounter()) > 0;
+}
+
+bool UiUpdateScheduler::canDraw() const
+{
+    if (!component.isShowing())
+        return false;
+
+    auto* peer = component.getPeer();
+    return peer != nullptr && !peer->isMinimised();
+}
+
+void UiUpdateScheduler::handleAsyncUpdate()
+{
+    if (stopping)
+    {
+        vblank.reset();
+        stopping = false;
+    }
+
+    if (vblank != nullptr || !canDraw())
+        return;
+
+    // One update straight away so the change shows without waiting a frame,
+    // then keep going at the display rate only if it asks to.
+    if (runUpdate())
+        vblank = std::make_unique<juce::VBlankAttachment>(&component, [this] { tick(); });
+}
+
+void UiUpdateScheduler::tick()
+{
+    if (stopping)
+        return;
+
+    // The attachment can't be destroyed from inside its own callback, so it
+    // is let go of on the next message instead.
+    if (!canDraw() || !runUpdate())
+    {
+        stopping = true;
+        triggerAsyncUpdate();
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Drives the periodic parts of the UI at the display's refresh rate while
+// there is something to animate, and stops completely when there isn't.
+//
+// The update function is called once per vertical blank and returns whether
+// it wants to be called again; once it returns false, and nothing has woken
+// the scheduler in the last quarter second, it detaches from the display and
+// costs nothing until woken again. It wakes on any mouse
+// activity inside the watched component, and on wake(), which owners call
+// from change callbacks and anywhere else state can change behind the UI's
+// back. Nothing runs while the window is minimised or hidden; it wakes by
+// itself when the window is restored, or the component or one of its parents
+// is shown again.
+class UiUpdateScheduler : private juce::MouseListener,
+    private juce::ComponentMovementWatcher,
+    private juce::AsyncUpdater
+{
+public:
+    UiUpdateScheduler(juce::Component& componentToWatch, std::function<bool()> updateFunction);
+    ~UiUpdateScheduler() override;
+
+    // Asks for at least one more update. Cheap enough to call often.
+    void wake();
+
+    bool isRunning() const { return vblank != nullptr && !stopping; }
+
+private:
+    juce::Component& component;
+    const std::function<bool()> update;
+    std::unique_ptr<juce::VBlankAttachment> vblank;
+    bool stopping = false;
+
+    static constexpr juce::uint32 wakeHoldMs = 250;
+    juce::uint32 wakeUntilMs = 0;
+
+    bool canDraw() const;
+    bool runUpdate();
+    void tick();
+
+    void handleAsyncUpdate() override;
+
+    void mouseDown(const juce::MouseEvent&) override { wake(); }
+    void mouseUp(const juce::MouseEvent&) override { wake(); }
+    void mouseDrag(const juce::MouseEvent&) override { wake(); }
+    void mouseWheelMove(const juce::MouseEvent&, const juce::MouseWheelDetails&) override { wake(); }
+
+    // Minimising or restoring the window comes through as a visibility change
+    // of the top-level component, which the watcher passes on.
+    using juce::ComponentMovementWatcher::componentMovedOrResized;
+    using juce::ComponentMovementWatcher::componentVisibilityChanged;
+    void componentMovedOrResized(bool, bool) override {}
+    void componentPeerChanged() override { wake(); }
+    void componentVisibilityChanged() override { wake(); }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(UiUpdateScheduler)
+};
@@ -0,0 +1,207 @@
+#include "WaveformPyramid.h"
+#include "SidecarCache.h"
+#include "SimdKernels.h"
+
+namespace
+{
+    constexpr int cacheVersion = 1;
+}
+
+WaveformPyramid::WaveformPyramid(double sampleRateToUse, juce::int64 expectedLength)
+    : sampleRate(sampleRateToUse),
+    levels(1)
+{
+    levels[0].reserve((size_t)(expectedLength / samplesPerBucket + 1));
+}
+
+void WaveformPyramid::addSamples(const juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    for (int start = 0; start < numSamples;)
+    {
+        const int numThisTime = juce::jmin(numSamples - start, samplesPerBucket - pendingCount);
+        addToPending(buffer, start, numThisTime);
+        start += numThisTime;
+
+        if (pendingCount == samplesPerBucket)
+            flushPending();
+    }
+
+    length += numSamples;
+}
+
+void WaveformPyramid::addToPending(const juce::AudioBuffer<float>& buffer, int start, int numSamples)
+{
+    const int numChannels = buffer.getNumChannels();
+    double squares = 0.0;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float low, high;
+        squares += SimdKernels::minMaxSumSquares(buffer.getReadPointer(channel, start), numSamples, low, high);
+
+        if (pendingCount == 0 && channel == 0)
+        {
+            pendingMin = low;
+            pendingMax = high;
+        }
+        else
+        {
+            pendingMin = juce::jmin(pendingMin, low);
+            pendingMax = juce::jmax(pendingMax, high);
+        }
+    }
+
+    pendingSquares += squares / juce::jmax(1, numChannels);
+    pendingCount += numSamples;
+}
+
+void WaveformPyramid::flushPending()
+{
+    if (pendingCount == 0)
+        return;
+
+    // Rounded outwards, so a peak never draws smaller than it is.
+    Bucket bucket;
+    bucket.min = (juce::int16)juce::jlimit(-32768.0f, 32767.0f, std::floor(pendingMin * 32767.0f));
+    bucket.max = (juce::int16)juce::jlimit(-32768.0f, 32767.0f, std::ceil(pendingMax * 32767.0f));
+    bucket.meanSquare = (float)(pendingSquares / pendingCount);
+    levels[0].push_back(bucket);
+
+    pendingSquares = 0.0;
+    pendingCount = 0;
+}
+
+void WaveformPyramid::finish()
+{
+    flushPending();
+
+    while (levels.back().size() > 1)
+    {
+        const auto& below = levels.back();
+        std::vector<Bucket> level((below.size() + levelFactor - 1) / levelFactor);
+
+        for (size_t i = 0; i < level.size(); ++i)
+        {
+            const size_t first = i * levelFactor;
+            const size_t last = juce::jmin(below.size(), first + levelFactor);
+            auto& bucket = level[i];
+            bucket = below[first];
+            float squares = below[first].meanSquare;
+
+            for (size_t j = first + 1; j < last; ++j)
+            {
+                bucket.min = juce::jmin(bucket.min, below[j].min);
+                bucket.max = juce::jmax(bucket.max, below[j].max);
+                squares += below[j].meanSquare;
+            }
+
+            bucket.meanSquare = squares / (float)(last - first);
+        }
+
+        levels.push_back(std::move(level));
+    }
+}
+
+void WaveformPyramid::getColumns(double startSample, double samplesPerColumn, Range* columns, int numColumns) const
+{
+    // The coarsest level whose buckets still fit inside a column, so each
+    // column reads between one and about levelFactor + 1 of them.
+    int levelIndex = 0;
+    double bucketSize = samplesPerBucket;
+
+    while (levelIndex + 1 < (int)levels.size() && bucketSize * levelFactor <= samplesPerColumn)
+    {
+        ++levelIndex;
+        bucketSize *= levelFactor;
+    }
+
+    const auto& level = levels[(size_t)levelIndex];
+    const auto numBuckets = (juce::int64)level.size();
+
+    for (int i = 0; i < numColumns; ++i)
+    {
+        auto& column = columns[i];
+        column = {};
+
+        const double start = startSample + i * samplesPerColumn;
+        const auto first = juce::jmax((juce::int64)0, (juce::int64)std::floor(start / bucketSize));
+        const auto end = juce::jmin(numBuckets, (juce::int64)std::ceil((start + samplesPerColumn) / bucketSize));
+
+        if (first >= end)
+            continue;
+
+        int low = 32767, high = -32768;
+        float squares = 0.0f;
+
+        for (auto b = first; b < end; ++b)
+        {
+            const auto& bucket = level[(size_t)b];
+            low = juce::jmin(low, (int)bucket.min);
+            high = juce::jmax(high, (int)bucket.max);
+            squares += bucket.meanSquare;
+        }
+
+        column.min = (float)low / 32767.0f;
+        column.max = (float)high / 32767.0f;
+        column.rms = std::sqrt(squares / (float)(end - first));
+    }
+}
+
+std::shared_ptr<WaveformPyramid> WaveformPyramid::loadFromCache(const juce::File& file)
+{
+    juce::MemoryBlock data;
+    if (!SidecarCache::load(file, "waveform", data))
+        return nullptr;
+
+    juce::MemoryInputStream in(data, false);
+
+    if (in.readInt() != cacheVersion)
+        return nullptr;
+
+    const auto rate = in.readDouble();
+    const auto totalLength = in.readInt64();
+    const int numBuckets = in.readInt();
+
+    if (rate <= 0.0 || totalLength < 0 || numBuckets <= 0 || (juce::int64)numBuckets * 8 > in.getNumBytesRemaining())
+        return nullptr;
+
+    auto pyramid = std::make_shared<WaveformPyramid>(rate, totalLength);
+    auto& finest = pyramid->levels[0];
+    finest.resize((size_t)numBuckets);
+
+    for (auto& bucket : finest)
+    {
+        bucket.min = in.readShort();
+        bucket.max = in.readShort();
+        bucket.meanSquare = in.readFloat();
+    }
+
+    pyramid->length = totalLength;
+    pyramid->finish();
+    return pyramid;
+}
+
+bool WaveformPyramid::isCached(const juce::File& file)
+{
+    return SidecarCache::getCacheFile(file, "waveform").existsAsFile();
+}
+
+void WaveformPyramid::saveToCache(const juce::File& file) const
+{
+    const auto& finest = levels[0];
+
+    juce::MemoryOutputStream out((size_t)(20 + finest.size() * 8));
+    out.writeInt(cacheVersion);
+    out.writeDouble(sampleRate);
+    out.writeInt64(length);
+    out.writeInt((int)finest.size());
+
+    for (const auto& bucket : finest)
+    {
+        out.writeShort(bucket.min);
+        out.writeShort(bucket.max);
+        out.writeFloat(bucket.meanSquare);
+    }
+
+    SidecarCache::save(file, "waveform", out.getMemoryBlock());
+}
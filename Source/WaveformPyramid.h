@@ -0,0 +1,71 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+// Min/max/RMS summaries of a whole track at a ladder of resolutions: the
+// finest level has one bucket per samplesPerBucket samples and each level
+// above it one per levelFactor buckets of the one below. Any zoom down to
+// samplesPerBucket samples per pixel is drawn from the nearest level at a
+// few bucket reads per column, so the cost follows the width of the view
+// rather than the length of the track. Closer in than that, the view reads
+// the samples themselves.
+//
+// Built once per track by feeding it every sample in order; read-only and
+// safe to share between threads once finish() has been called.
+class WaveformPyramid
+{
+public:
+    static constexpr int samplesPerBucket = 64;
+    static constexpr int levelFactor = 4;
+
+    struct Range
+    {
+        float min = 0.0f;
+        float max = 0.0f;
+        float rms = 0.0f;
+    };
+
+    WaveformPyramid(double sampleRate, juce::int64 expectedLength);
+
+    // Every channel is folded into one envelope: the widest min/max and the
+    // mean power across channels.
+    void addSamples(const juce::AudioBuffer<float>& buffer, int numSamples);
+    void finish();
+
+    double getSampleRate() const { return sampleRate; }
+    juce::int64 getLengthInSamples() const { return length; }
+
+    // One Range per column, column i covering samples from
+    // startSample + i * samplesPerColumn. Below samplesPerBucket per column,
+    // each column gets the whole finest bucket it falls in, which is only good
+    // as a stand-in. Columns past either end of the track come out empty.
+    void getColumns(double startSample, double samplesPerColumn, Range* columns, int numColumns) const;
+
+    // Kept by path, size and modification time, like the disk thumbnails.
+    // Only the finest level is stored; loading rebuilds the rest.
+    static std::shared_ptr<WaveformPyramid> loadFromCache(const juce::File& file);
+    static bool isCached(const juce::File& file);
+    void saveToCache(const juce::File& file) const;
+
+private:
+    // Eight bytes a bucket keeps an hour of audio to a few tens of megabytes.
+    struct Bucket
+    {
+        juce::int16 min = 0;
+        juce::int16 max = 0;
+        float meanSquare = 0.0f;
+    };
+
+    const double sampleRate;
+    juce::int64 length = 0;
+    std::vector<std::vector<Bucket>> levels;
+
+    float pendingMin = 0.0f, pendingMax = 0.0f;
+    double pendingSquares = 0.0;
+    int pendingCount = 0;
+
+    void addToPending(const juce::AudioBuffer<float>& buffer, int start, int numSamples);
+    void flushPending();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformPyramid)
+};
@@ -0,0 +1,669 @@
+#include "WaveformView.h"
+
+namespace
+{
+    // The closest zoom: this many pixels between neighbouring samples.
+    constexpr double maxPixelsPerSample = 8.0;
+
+    // Sample dots appear once samples are this far apart.
+    constexpr double dotPixelsPerSample = 5.0;
+
+    constexpr float verticalZoom = 0.85f;
+}
+
+// Reads one window of samples for the view, opening a reader if the
+// window didn't bring one.
+class WaveformView::SampleFetchJob : public juce::ThreadPoolJob
+{
+public:
+    SampleFetchJob(WaveformView& ownerToUse, std::unique_ptr<SampleWindow> windowToFill)
+        : juce::ThreadPoolJob("Waveform samples"),
+        owner(ownerToUse),
+        window(std::move(windowToFill))
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        auto& target = *window;
+
+        if (target.reader == nullptr)
+            target.reader.reset(owner.player.createSharedReader(target.file));
+
+        if (target.reader != nullptr && !shouldExit())
+        {
+            const int numToRead = (int)juce::jlimit((juce::int64)0, (juce::int64)target.numSamples,
+                target.reader->lengthInSamples - target.start);
+
+            target.samples.setSize(juce::jlimit(1, 2, (int)target.reader->numChannels), juce::jmax(1, numToRead));
+            target.samples.clear();
+            target.numSamples = numToRead;
+            target.succeeded = numToRead == 0
+                || target.reader->read(&target.samples, 0, numToRead, target.start, true, true);
+        }
+
+        // Always reported, so the view knows it can ask again.
+        owner.samplesFetched(std::move(window));
+        return jobHasFinished;
+    }
+
+private:
+    WaveformView& owner;
+    std::unique_ptr<SampleWindow> window;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleFetchJob)
+};
+
+class WaveformView::ThumbnailReaderJob : public juce::ThreadPoolJob
+{
+public:
+    ThumbnailReaderJob(WaveformView& ownerToUse, const juce::File& fileToOpen)
+        : juce::ThreadPoolJob("Thumbnail reader"),
+        owner(ownerToUse),
+        file(fileToOpen)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        // A track with a cached pyramid is drawn from that as soon as the deck
+        // has read it back, so it needs no thumbnail decoding it again. The
+        // thumbnail reads every block once, so it goes past the shared cache.
+        auto source = std::make_unique<ThumbnailSource>();
+        source->file = file;
+
+        if (!WaveformPyramid::isCached(file))
+            source->reader.reset(owner.player.createWholeTrackReader(file));
+
+        if (!shouldExit())
+            owner.thumbnailReaderOpened(std::move(source));
+
+        return jobHasFinished;
+    }
+
+private:
+    WaveformView& owner;
+    const juce::File file;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ThumbnailReaderJob)
+};
+
+WaveformView::WaveformView(PlayerAudio& playerToShow, juce::AudioThumbnail& thumbnailToUse, const juce::String& deckName,
+    juce::Colour startColourToUse, juce::Colour endColourToUse)
+    : player(playerToShow),
+    thumbnail(thumbnailToUse),
+    name(deckName),
+    startColour(startColourToUse),
+    endColour(endColourToUse)
+{
+}
+
+WaveformView::~WaveformView()
+{
+    fetchJobs.removeAll();
+    thumbnailJobs.removeAll();
+    cancelPendingUpdate();
+}
+
+void WaveformView::trackChanged(const juce::File& file)
+{
+    // The old waveform goes at once; a reader still opening for an earlier
+    // file is dropped when it reports.
+    thumbnailJobs.signalAll();
+    thumbnail.clear();
+    thumbnailFile = file;
+
+    if (file != juce::File())
+        thumbnailJobs.add(new ThumbnailReaderJob(*this, file));
+
+    visibleStart = 0.0;
+    visibleLength = 0.0;
+    reader.reset();
+    readerFile = juce::File();
+    samplesStart = -1;
+    numSamplesLoaded = 0;
+    failedStart = -1;
+    repaint();
+}
+
+double WaveformView::getVisibleLength() const
+{
+    return visibleLength > 0.0 ? visibleLength : getTrackLength();
+}
+
+void WaveformView::setVisibleRange(double startSeconds, double lengthSeconds)
+{
+    const double trackLength = getTrackLength();
+    const double sampleRate = player.getSourceSampleRate();
+
+    if (trackLength <= 0.0 || sampleRate <= 0.0 || getWidth() <= 0)
+    {
+        visibleStart = 0.0;
+        visibleLength = 0.0;
+        repaint();
+        return;
+    }
+
+    const double minLength = getWidth() / (maxPixelsPerSample * sampleRate);
+    lengthSeconds = juce::jmax(minLength, lengthSeconds);
+
+    if (lengthSeconds >= trackLength)
+    {
+        visibleStart = 0.0;
+        visibleLength = 0.0;
+    }
+    else
+    {
+        visibleLength = lengthSeconds;
+        visibleStart = juce::jlimit(0.0, trackLength - lengthSeconds, startSeconds);
+    }
+
+    repaint();
+}
+
+void WaveformView::updatePlayhead()
+{
+    const double position = player.getCurrentPosition();
+    const bool playing = player.isPlaying();
+
+    if (isZoomedIn() && !dragging && playing
+        && (position < visibleStart || position >= visibleStart + visibleLength))
+    {
+        setVisibleRange(position - 0.05 * visibleLength, visibleLength);
+        lastPlayheadX = juce::roundToInt(timeToX(position));
+        lastPlayheadPlaying = playing;
+        return;
+    }
+
+    const int x = getTrackLength() > 0.0 ? juce::roundToInt(timeToX(position)) : -1;
+
+    if (x == lastPlayheadX && playing == lastPlayheadPlaying)
+        return;
+
+    repaintPlayheadStrip(lastPlayheadX);
+    repaintPlayheadStrip(x);
+    lastPlayheadX = x;
+    lastPlayheadPlaying = playing;
+}
+
+void WaveformView::repaintPlayheadStrip(int x)
+{
+    // Wide enough for the two-pixel line on either side of its rounding.
+    if (x >= -2 && x <= getWidth() + 2)
+        repaint(x - 3, 0, 7, getHeight());
+}
+
+double WaveformView::xToTime(float x) const
+{
+    return visibleStart + (double)x / juce::jmax(1, getWidth()) * getVisibleLength();
+}
+
+float WaveformView::timeToX(double time) const
+{
+    const double length = getVisibleLength();
+    return length > 0.0 ? (float)((time - visibleStart) / length * getWidth()) : 0.0f;
+}
+
+void WaveformView::zoomAround(double factor, double anchorTime)
+{
+    const double length = getVisibleLength();
+    if (length <= 0.0)
+        return;
+
+    const double anchorFraction = (anchorTime - visibleStart) / length;
+    const double newLength = length * factor;
+    setVisibleRange(anchorTime - anchorFraction * newLength, newLength);
+}
+
+void WaveformView::paint(juce::Graphics& g)
+{
+    const auto bounds = getLocalBounds();
+
+    g.setColour(juce::Colours::black.withAlpha(0.5f));
+    g.fillRoundedRectangle(bounds.toFloat(), 4.0f);
+
+    const double trackLength = getTrackLength();
+
+    if (trackLength <= 0.0 && thumbnail.getTotalLength() <= 0.0)
+    {
+        g.setColour(juce::Colours::white.withAlpha(0.4f));
+        g.setFont(14.0f);
+        g.drawText("Load " + name, bounds, juce::Justification::centred);
+        return;
+    }
+
+    g.setGradientFill(juce::ColourGradient(startColour.withAlpha(0.8f), 0.0f, (float)bounds.getCentreY(),
+        endColour.withAlpha(0.8f), (float)bounds.getRight(), (float)bounds.getCentreY(), false));
+
+    const double sampleRate = player.getSourceSampleRate();
+    const double samplesPerPixel = getVisibleLength() * sampleRate / juce::jmax(1, getWidth());
+    const auto pyramid = player.getWaveform();
+
+    if (samplesPerPixel > 0.0 && samplesPerPixel < WaveformPyramid::samplesPerBucket)
+        drawFromSamples(g);
+    else if (pyramid != nullptr)
+        drawFromPyramid(g, *pyramid);
+    else
+        thumbnail.drawChannel(g, bounds, visibleStart, visibleStart + getVisibleLength(), 0, verticalZoom);
+
+    if (trackLength > 0.0)
+    {
+        drawLoopRegion(g);
+        drawBeatGrid(g);
+        drawMarkers(g, player.getOnsetMarkers(), true);
+        drawMarkers(g, player.getMarkers(), false);
+        drawPlayhead(g);
+    }
+
+    g.setColour(juce::Colours::white.withAlpha(0.8f));
+    g.setFont(12.0f);
+    g.drawText(name + ": " + player.getMetadata().title, bounds, juce::Justification::topLeft);
+}
+
+void WaveformView::drawFromPyramid(juce::Graphics& g, const WaveformPyramid& pyramid)
+{
+    const int width = getWidth();
+    const double sampleRate = pyramid.getSampleRate();
+    const double samplesPerPixel = getVisibleLength() * sampleRate / width;
+
+    // Only the columns being repainted, which for a moving playhead is a
+    // narrow strip.
+    const auto clip = g.getClipBounds();
+    const int firstColumn = juce::jmax(0, clip.getX());
+    const int numColumns = juce::jmin(width, clip.getRight()) - firstColumn;
+
+    if (numColumns <= 0)
+        return;
+
+    columns.resize((size_t)numColumns);
+    pyramid.getColumns((visibleStart * sampleRate) + firstColumn * samplesPerPixel, samplesPerPixel,
+        columns.data(), numColumns);
+
+    const float centre = getHeight() * 0.5f;
+    const float scale = centre * verticalZoom;
+    juce::RectangleList<float> peaks, body;
+
+    for (int x = firstColumn; x < firstColumn + numColumns; ++x)
+    {
+        const auto& column = columns[(size_t)(x - firstColumn)];
+        const float top = centre - column.max * scale;
+        const float bottom = centre - column.min * scale;
+
+        if (bottom <= top && column.max == 0.0f)
+            continue;
+
+        peaks.addWithoutMerging({ (float)x, top, 1.0f, juce::jmax(1.0f, bottom - top) });
+
+        const float rmsTop = juce::jmax(top, centre - column.rms * scale);
+        const float rmsBottom = juce::jmin(bottom, centre + column.rms * scale);
+
+        if (rmsBottom > rmsTop)
+            body.addWithoutMerging({ (float)x, rmsTop, 1.0f, rmsBottom - rmsTop });
+    }
+
+    g.fillRectList(peaks);
+    g.setColour(juce::Colours::white.withAlpha(0.35f));
+    g.fillRectList(body);
+}
+
+bool WaveformView::hasSamples(juce::int64 start, int numSamples) const
+{
+    return samplesStart >= 0 && readerFile == player.getCurrentFile()
+        && start >= samplesStart && start + numSamples <= samplesStart + numSamplesLoaded;
+}
+
+void WaveformView::requestSamples(juce::int64 start, int numSamples)
+{
+    // Whatever is in flight lands first; the repaint it triggers asks for
+    // the window that is on screen by then.
+    if (fetching)
+        return;
+
+    // A screen either side as well, so scrolling a little doesn't read again.
+    const auto file = player.getCurrentFile();
+    const auto loadStart = juce::jmax((juce::int64)0, start - numSamples);
+
+    if (file == juce::File() || loadStart == failedStart)
+        return;
+
+    auto window = std::make_unique<SampleWindow>();
+    window->file = file;
+    window->start = loadStart;
+    window->numSamples = numSamples * 3;
+
+    if (readerFile == file)
+        window->reader = std::move(reader);
+
+    fetching = true;
+    fetchJobs.add(new SampleFetchJob(*this, std::move(window)));
+}
+
+void WaveformView::samplesFetched(std::unique_ptr<SampleWindow> window)
+{
+    // Called on the worker thread.
+    {
+        const juce::ScopedLock sl(fetchLock);
+        fetchedWindow = std::move(window);
+    }
+
+    triggerAsyncUpdate();
+}
+
+void WaveformView::thumbnailReaderOpened(std::unique_ptr<ThumbnailSource> source)
+{
+    // Called on the worker thread.
+    {
+        const juce::ScopedLock sl(fetchLock);
+        openedThumbnail = std::move(source);
+    }
+
+    triggerAsyncUpdate();
+}
+
+void WaveformView::handleAsyncUpdate()
+{
+    std::unique_ptr<SampleWindow> window;
+    std::unique_ptr<ThumbnailSource> thumbnailSource;
+
+    {
+        const juce::ScopedLock sl(fetchLock);
+        window = std::move(fetchedWindow);
+        thumbnailSource = std::move(openedThumbnail);
+    }
+
+    if (thumbnailSource != nullptr && thumbnailSource->file == thumbnailFile)
+    {
+        if (thumbnailSource->reader != nullptr)
+            thumbnail.setReader(thumbnailSource->reader.release(), DecodedBlockCache::makeFileKey(thumbnailFile));
+        else
+            thumbnail.clear();
+    }
+
+    if (window != nullptr)
+        fetching = false;
+
+    // Samples of a track that has since been replaced are dropped.
+    if (window != nullptr && window->file == player.getCurrentFile())
+    {
+        readerFile = window->file;
+        reader = std::move(window->reader);
+
+        if (window->succeeded)
+        {
+            samples = std::move(window->samples);
+            samplesStart = window->start;
+            numSamplesLoaded = window->numSamples;
+        }
+        else
+        {
+            failedStart = window->start;
+        }
+    }
+
+    repaint();
+}
+
+void WaveformView::drawFromSamples(juce::Graphics& g)
+{
+    const int width = getWidth();
+    const double sampleRate = player.getSourceSampleRate();
+    const double samplesPerPixel = getVisibleLength() * sampleRate / width;
+    const double startSample = visibleStart * sampleRate;
+
+    const auto first = juce::jmax((juce::int64)0, (juce::int64)std::floor(startSample) - 1);
+    const int count = (int)std::ceil(width * samplesPerPixel) + 3;
+
+    if (!hasSamples(first, count))
+    {
+        requestSamples(first, count);
+
+        if (const auto pyramid = player.getWaveform())
+            drawFromPyramid(g, *pyramid);
+        else
+            thumbnail.drawChannel(g, getLocalBounds(), visibleStart, visibleStart + getVisibleLength(), 0, verticalZoom);
+
+        return;
+    }
+
+    const float centre = getHeight() * 0.5f;
+    const float scale = centre * verticalZoom;
+    const int numChannels = samples.getNumChannels();
+    const auto offset = (int)(first - samplesStart);
+    const int available = juce::jmin(count, numSamplesLoaded - offset);
+
+    if (samplesPerPixel > 1.0)
+    {
+        // Still more than one sample per column: the same min/max bars as the
+        // pyramid, taken straight from the samples.
+        juce::RectangleList<float> peaks;
+        const auto clip = g.getClipBounds();
+
+        for (int x = juce::jmax(0, clip.getX()); x < juce::jmin(width, clip.getRight()); ++x)
+        {
+            const int from = (int)(startSample + x * samplesPerPixel - (double)first);
+            const int to = juce::jmin(available, (int)std::ceil(startSample + (x + 1) * samplesPerPixel - (double)first));
+
+            if (from < 0 || from >= to)
+                continue;
+
+            auto range = juce::FloatVectorOperations::findMinAndMax(samples.getReadPointer(0, offset + from), to - from);
+
+            for (int channel = 1; channel < numChannels; ++channel)
+                range = range.getUnionWith(juce::FloatVectorOperations::findMinAndMax(samples.getReadPointer(channel, offset + from), to - from));
+
+            const float top = centre - range.getEnd() * scale;
+            const float bottom = centre - range.getStart() * scale;
+            peaks.addWithoutMerging({ (float)x, top, 1.0f, juce::jmax(1.0f, bottom - top) });
+        }
+
+        g.fillRectList(peaks);
+        return;
+    }
+
+    // Individual samples, joined up; the second channel fainter behind.
+    const double pixelsPerSample = 1.0 / samplesPerPixel;
+
+    for (int channel = numChannels; --channel >= 0;)
+    {
+        const float* data = samples.getReadPointer(channel, offset);
+        juce::Path path;
+
+        for (int i = 0; i < available; ++i)
+        {
+            const float x = (float)(((double)(first + i) - startSample) * pixelsPerSample);
+            const float y = centre - data[i] * scale;
+
+            if (i == 0)
+                path.startNewSubPath(x, y);
+            else
+                path.lineTo(x, y);
+        }
+
+        if (channel > 0)
+            g.setColour(endColour.withAlpha(0.4f));
+
+        g.strokePath(path, juce::PathStrokeType(1.5f));
+
+        if (channel == 0 && pixelsPerSample >= dotPixelsPerSample)
+        {
+            g.setColour(juce::Colours::white.withAlpha(0.8f));
+
+            for (int i = 0; i < available; ++i)
+            {
+                const float x = (float)(((double)(first + i) - startSample) * pixelsPerSample);
+                g.fillEllipse(x - 2.0f, centre - data[i] * scale - 2.0f, 4.0f, 4.0f);
+            }
+        }
+
+        if (channel > 0)
+            g.setGradientFill(juce::ColourGradient(startColour.withAlpha(0.8f), 0.0f, centre,
+                endColour.withAlpha(0.8f), (float)width, centre, false));
+    }
+}
+
+void WaveformView::drawLoopRegion(juce::Graphics& g)
+{
+    if (!player.hasMarkers())
+        return;
+
+    const float start = juce::jmax(0.0f, timeToX(player.getMarkerA()));
+    const float end = juce::jmin((float)getWidth(), timeToX(player.getMarkerB()));
+
+    if (end <= start)
+        return;
+
+    g.setColour(juce::Colours::white.withAlpha(player.isSegmentLooping() ? 0.12f : 0.06f));
+    g.fillRect(start, 0.0f, end - start, (float)getHeight());
+}
+
+void WaveformView::drawBeatGrid(juce::Graphics& g)
+{
+    const auto& grid = player.getBeatGrid();
+    const double length = getVisibleLength();
+
+    if (!grid.isValid() || length <= 0.0 || getWidth() <= 0)
+        return;
+
+    // Every beat when they are far enough apart to tell from each other,
+    // otherwise only the bars, and nothing once even those would smear.
+    constexpr float minBeatSpacing = 4.0f;
+    const float pixelsPerBeat = (float)(grid.getBeatLength() / length * getWidth());
+    const int step = pixelsPerBeat >= minBeatSpacing ? 1 : BeatGrid::beatsPerBar;
+
+    if (pixelsPerBeat * step < minBeatSpacing)
+        return;
+
+    int beat = grid.getBeatIndexAtOrAfter(visibleStart);
+    beat = (beat + step - 1) / step * step;
+
+    const double end = juce::jmin(getTrackLength(), visibleStart + length);
+
+    for (;; beat += step)
+    {
+        const double time = grid.getBeatTime(beat);
+        if (time >= end)
+            break;
+
+        g.setColour(juce::Colours::white.withAlpha(grid.isBarStart(beat) ? 0.35f : 0.15f));
+        g.drawVerticalLine(juce::roundToInt(timeToX(time)), 0.0f, (float)getHeight());
+    }
+}
+
+void WaveformView::drawMarkers(juce::Graphics& g, const MarkerIndex& markers, bool isOnsetLayer)
+{
+    const double length = getVisibleLength();
+
+    if (markers.isEmpty() || length <= 0.0 || getWidth() <= 0)
+        return;
+
+    // One lookup per pixel column rather than one line per marker, so a dense
+    // set of onset markers costs no more to draw than the width of the view.
+    const double secondsPerPixel = length / getWidth();
+    const float bottom = (float)getHeight();
+
+    for (int index = markers.indexAtOrAfter(visibleStart); index < markers.size();)
+    {
+        const double time = markers.getReference(index).time;
+        const int column = (int)((time - visibleStart) / secondsPerPixel);
+
+        if (column >= getWidth())
+            break;
+
+        const float xPos = timeToX(time);
+
+        if (isOnsetLayer)
+        {
+            // Detected onsets are a hint, drawn as short ticks under the user's markers.
+            g.setColour(juce::Colours::cyan.withAlpha(0.5f));
+            g.drawVerticalLine(juce::roundToInt(xPos), bottom - 12.0f, bottom);
+        }
+        else
+        {
+            g.setColour(juce::Colours::yellow);
+            g.drawLine(xPos, 0.0f, xPos, bottom, 2.0f);
+
+            g.setColour(juce::Colours::orange);
+            g.fillEllipse(xPos - 3.0f, bottom - 8.0f, 6.0f, 6.0f);
+        }
+
+        index = juce::jmax(index + 1, markers.indexAtOrAfter(visibleStart + (column + 1) * secondsPerPixel));
+    }
+}
+
+void WaveformView::drawPlayhead(juce::Graphics& g)
+{
+    const float x = timeToX(player.getCurrentPosition());
+
+    if (x < 0.0f || x > (float)getWidth())
+        return;
+
+    g.setColour(player.isPlaying() ? juce::Colours::white : juce::Colours::white.withAlpha(0.5f));
+    g.drawLine(x, 0.0f, x, (float)getHeight(), 2.0f);
+}
+
+void WaveformView::mouseDown(const juce::MouseEvent&)
+{
+    dragStartVisibleStart = visibleStart;
+    dragging = false;
+}
+
+void WaveformView::mouseDrag(const juce::MouseEvent& event)
+{
+    if (!isZoomedIn())
+        return;
+
+    if (event.getDistanceFromDragStart() > 3)
+        dragging = true;
+
+    if (dragging)
+        setVisibleRange(dragStartVisibleStart - event.getDistanceFromDragStartX() * visibleLength / getWidth(),
+            visibleLength);
+}
+
+void WaveformView::mouseUp(const juce::MouseEvent& event)
+{
+    if (dragging)
+    {
+        dragging = false;
+        return;
+    }
+
+    const double trackLength = getTrackLength();
+    if (trackLength <= 0.0)
+        return;
+
+    const double time = juce::jlimit(0.0, trackLength, xToTime(event.position.x));
+
+    if (event.mods.isAltDown())
+        player.addMarker(time);
+    else
+        player.setPosition(time);
+
+    repaint();
+}
+
+void WaveformView::mouseDoubleClick(const juce::MouseEvent&)
+{
+    setVisibleRange(0.0, 0.0);
+}
+
+void WaveformView::mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel)
+{
+    if (getTrackLength() <= 0.0)
+        return;
+
+    const bool sideways = event.mods.isShiftDown() || std::abs(wheel.deltaX) > std::abs(wheel.deltaY);
+
+    if (sideways)
+    {
+        if (isZoomedIn())
+        {
+            const float delta = wheel.deltaX != 0.0f ? wheel.deltaX : wheel.deltaY;
+            setVisibleRange(visibleStart - delta * visibleLength, visibleLength);
+        }
+
+        return;
+    }
+
+    zoomAround(std::pow(2.0, -wheel.deltaY * 4.0), xToTime(event.position.x));
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <JuceHeader.h>
+#include "BackgroundThreadPool.h"
+#include "PlayerAudio.h"
+#include "PooledJobs.h"
+#include "WaveformPyramid.h"
+
+// One deck's waveform, with its beat grid, markers, A-B loop and playhead.
+// It shows the whole track until zoomed with the mouse wheel; dragging or
+// scrolling sideways then moves along it. Drawing comes from the deck's
+// WaveformPyramid down to WaveformPyramid::samplesPerBucket samples per
+// pixel and from the samples themselves closer in, down to single samples,
+// so markers and loop points can be placed exactly. The thumbnail stands in
+// while the deck's first analysis pass builds the pyramid, and the pyramid
+// until the samples on screen have been read in the background.
+//
+// Click moves the playhead, alt-click adds a marker and a double-click shows
+// the whole track again.
+class WaveformView : public juce::Component,
+    private juce::AsyncUpdater
+{
+public:
+    WaveformView(PlayerAudio& playerToShow, juce::AudioThumbnail& thumbnailToUse, const juce::String& deckName,
+        juce::Colour startColour, juce::Colour endColour);
+    ~WaveformView() override;
+
+    // Call when the deck has been given a different file. The thumbnail's
+    // reader is opened on the background pool and handed over when ready.
+    void trackChanged(const juce::File& file);
+
+    // Moves the playhead, repainting only the strips it left and entered,
+    // and keeps it on screen while zoomed in, a page at a time.
+    void updatePlayhead();
+
+    void setVisibleRange(double startSeconds, double lengthSeconds);
+    double getVisibleStart() const { return visibleStart; }
+    double getVisibleLength() const;
+    bool isZoomedIn() const { return visibleLength > 0.0; }
+
+    void paint(juce::Graphics& g) override;
+    void mouseDown(const juce::MouseEvent& event) override;
+    void mouseDrag(const juce::MouseEvent& event) override;
+    void mouseUp(const juce::MouseEvent& event) override;
+    void mouseDoubleClick(const juce::MouseEvent& event) override;
+    void mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel) override;
+
+private:
+    PlayerAudio& player;
+    juce::AudioThumbnail& thumbnail;
+    const juce::String name;
+    const juce::Colour startColour, endColour;
+
+    // Seconds; a length of 0 means the whole track.
+    double visibleStart = 0.0;
+    double visibleLength = 0.0;
+
+    double dragStartVisibleStart = 0.0;
+    bool dragging = false;
+
+    // Where the playhead was last drawn, in pixels.
+    int lastPlayheadX = -1;
+    bool lastPlayheadPlaying = false;
+
+    std::vector<WaveformPyramid::Range> columns;
+
+    // The samples on screen when zoomed in past the pyramid, read through
+    // the deck's shared cache on the background pool. One read is in flight
+    // at a time; the reader travels with it and comes back for the next.
+    class SampleFetchJob;
+
+    struct SampleWindow
+    {
+        juce::File file;
+        juce::int64 start = 0;
+        int numSamples = 0;
+        bool succeeded = false;
+        juce::AudioBuffer<float> samples;
+        std::unique_ptr<juce::AudioFormatReader> reader;
+    };
+
+    // Opens the thumbnail's reader, so probing the file's header stays off
+    // the message thread.
+    class ThumbnailReaderJob;
+
+    struct ThumbnailSource
+    {
+        juce::File file;
+        std::unique_ptr<juce::AudioFormatReader> reader;
+    };
+
+    juce::SharedResourcePointer<BackgroundThreadPool> backgroundPool;
+    PooledJobs<SampleFetchJob> fetchJobs{ *backgroundPool };
+    PooledJobs<ThumbnailReaderJob> thumbnailJobs{ *backgroundPool };
+    juce::CriticalSection fetchLock;
+    std::unique_ptr<SampleWindow> fetchedWindow;
+    std::unique_ptr<ThumbnailSource> openedThumbnail;
+    juce::File thumbnailFile;
+    bool fetching = false;
+
+    juce::File readerFile;
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    juce::AudioBuffer<float> samples;
+    juce::int64 samplesStart = -1;
+    int numSamplesLoaded = 0;
+
+    // A window that couldn't be read isn't asked for again.
+    juce::int64 failedStart = -1;
+
+    double getTrackLength() const { return player.getLengthInSeconds(); }
+    double xToTime(float x) const;
+    float timeToX(double time) const;
+    void zoomAround(double factor, double anchorTime);
+    void repaintPlayheadStrip(int x);
+
+    void drawFromPyramid(juce::Graphics& g, const WaveformPyramid& pyramid);
+    void drawFromSamples(juce::Graphics& g);
+    bool hasSamples(juce::int64 start, int numSamples) const;
+    void requestSamples(juce::int64 start, int numSamples);
+    void samplesFetched(std::unique_ptr<SampleWindow> window);
+    void thumbnailReaderOpened(std::unique_ptr<ThumbnailSource> source);
+    void handleAsyncUpdate() override;
+    void drawLoopRegion(juce::Graphics& g);
+    void drawBeatGrid(juce::Graphics& g);
+    void drawMarkers(juce::Graphics& g, const MarkerIndex& markers, bool isOnsetLayer);
+    void drawPlayhead(juce::Graphics& g);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformView)
+};